@@ -0,0 +1,223 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+// our headers
+#include "opengm/toy_models.hpp"
+#include "opengm/minimizer/bp.hpp"
+#include "opengm/minimizer/icm.hpp"
+#include "opengm/minimizer/trws.hpp"
+
+
+namespace{
+
+    // range(0) is the size of the model in the generator specific unit
+    template<class MODEL_FACTORY>
+    void bp_on_model(benchmark::State& state, MODEL_FACTORY && model_factory, const std::size_t num_threads = 1)
+    {
+        const auto gm = model_factory(state.range(0));
+        using gm_type = std::decay_t<decltype(gm)>;
+        using minimizer_type = opengm::BeliefPropergation<gm_type>;
+        typename minimizer_type::settings_type settings;
+        settings.num_iterations = 10;
+        settings.convergence = 0;
+        settings.num_threads = num_threads;
+
+        while (state.KeepRunning())
+        {
+            minimizer_type minimizer(gm, settings);
+            minimizer.minimize();
+            benchmark::DoNotOptimize(minimizer.best_energy());
+        }
+        state.SetItemsProcessed(state.iterations() * settings.num_iterations * gm.num_factors());
+    }
+
+    // runs until convergence with messages stored in MESSAGE_TYPE,
+    // the counters report the effect on the convergence and the energy
+    template<class MESSAGE_TYPE, class MODEL_FACTORY>
+    void bp_messages_on_model(benchmark::State& state, MODEL_FACTORY && model_factory)
+    {
+        const auto gm = model_factory(state.range(0));
+        using gm_type = std::decay_t<decltype(gm)>;
+        using minimizer_type = opengm::BeliefPropergation<gm_type, MESSAGE_TYPE>;
+        typename minimizer_type::settings_type settings;
+        settings.num_iterations = 100;
+        settings.damping = 0.5;
+
+        std::size_t iterations = 0;
+        double energy = 0;
+        while (state.KeepRunning())
+        {
+            minimizer_type minimizer(gm, settings);
+            minimizer.minimize();
+            iterations = minimizer.iteration();
+            energy = minimizer.best_energy();
+            benchmark::DoNotOptimize(energy);
+        }
+        state.counters["iterations"] = iterations;
+        state.counters["energy"] = energy;
+        state.counters["message_bytes"] = minimizer_type::estimate_memory(opengm::model_statistics(gm)).buffers.at("messages");
+        state.SetItemsProcessed(state.iterations() * iterations * gm.num_factors());
+    }
+
+    // runs until convergence, synchronous or with the active set
+    // schedule, the counters report the iterations and the energy
+    template<class MODEL_FACTORY>
+    void bp_active_set_on_model(benchmark::State& state, MODEL_FACTORY && model_factory, const bool active_set)
+    {
+        const auto gm = model_factory(state.range(0));
+        using gm_type = std::decay_t<decltype(gm)>;
+        using minimizer_type = opengm::BeliefPropergation<gm_type>;
+        typename minimizer_type::settings_type settings;
+        settings.num_iterations = 100;
+        settings.damping = 0.5;
+        if(active_set){
+            settings.schedule = minimizer_type::Schedule::active_set;
+        }
+
+        std::size_t iterations = 0;
+        double energy = 0;
+        while (state.KeepRunning())
+        {
+            minimizer_type minimizer(gm, settings);
+            minimizer.minimize();
+            iterations = minimizer.iteration();
+            energy = minimizer.best_energy();
+            benchmark::DoNotOptimize(energy);
+        }
+        state.counters["iterations"] = iterations;
+        state.counters["energy"] = energy;
+    }
+
+    // fixed number of iterations, each one is a forward and
+    // a backward pass followed by the evaluation of the bound
+    template<class MODEL_FACTORY>
+    void trws_on_model(benchmark::State& state, MODEL_FACTORY && model_factory)
+    {
+        const auto gm = model_factory(state.range(0));
+        using gm_type = std::decay_t<decltype(gm)>;
+        using minimizer_type = opengm::TrwS<gm_type>;
+        typename minimizer_type::settings_type settings;
+        settings.num_iterations = 10;
+        settings.absolute_gap = -1;
+        settings.convergence = -1;
+
+        while (state.KeepRunning())
+        {
+            minimizer_type minimizer(gm, settings);
+            minimizer.minimize();
+            benchmark::DoNotOptimize(minimizer.lower_bound());
+        }
+        state.SetItemsProcessed(state.iterations() * settings.num_iterations * gm.num_factors());
+    }
+
+    template<class MODEL_FACTORY>
+    void icm_on_model(benchmark::State& state, MODEL_FACTORY && model_factory)
+    {
+        const auto gm = model_factory(state.range(0));
+        using gm_type = std::decay_t<decltype(gm)>;
+        using minimizer_type = opengm::Icm<gm_type>;
+
+        while (state.KeepRunning())
+        {
+            minimizer_type minimizer(gm);
+            minimizer.minimize();
+            benchmark::DoNotOptimize(minimizer.best_energy());
+        }
+        state.SetItemsProcessed(state.iterations() * gm.num_variables());
+    }
+
+    void grid_args(benchmark::internal::Benchmark * b){
+        for(auto n : {64, 256, 1024}){
+            b->Arg(n);
+        }
+    }
+    void volume_args(benchmark::internal::Benchmark * b){
+        for(auto n : {16, 32, 64}){
+            b->Arg(n);
+        }
+    }
+    void chain_args(benchmark::internal::Benchmark * b){
+        for(auto n : {1 << 12, 1 << 16, 1 << 20}){
+            b->Arg(n);
+        }
+    }
+    // range(1) is the number of threads
+    void threads_args(benchmark::internal::Benchmark * b){
+        for(auto t : {1, 2, 4, 8, 16}){
+            b->Args({64, t});
+        }
+    }
+    void dense_args(benchmark::internal::Benchmark * b){
+        for(auto n : {8, 16, 32}){
+            b->Arg(n);
+        }
+    }
+
+    auto stereo = [](std::size_t n){ return opengm::StereoGrid(n, n, 64)(); };
+    auto volume = [](std::size_t n){ return opengm::PottsVolume(n, n, n)(); };
+    auto pattern = [](std::size_t n){ return opengm::PatternGrid(n, n)(); };
+    auto chain = [](std::size_t n){ return opengm::DenoisingChain(n)(); };
+    auto dense = [](std::size_t n){ return opengm::DenseRandomModel(n, 8)(); };
+}
+
+
+static void BM_BpStereoGrid(benchmark::State& state){ bp_on_model(state, stereo); }
+BENCHMARK(BM_BpStereoGrid)->Apply(grid_args);
+
+static void BM_BpPottsVolume(benchmark::State& state){ bp_on_model(state, volume); }
+BENCHMARK(BM_BpPottsVolume)->Apply(volume_args);
+
+static void BM_BpPottsVolumeThreads(benchmark::State& state){ bp_on_model(state, volume, state.range(1)); }
+BENCHMARK(BM_BpPottsVolumeThreads)->Apply(threads_args)->UseRealTime();
+
+static void BM_BpPatternGrid(benchmark::State& state){ bp_on_model(state, pattern); }
+BENCHMARK(BM_BpPatternGrid)->Apply(grid_args);
+
+static void BM_BpDenoisingChain(benchmark::State& state){ bp_on_model(state, chain); }
+BENCHMARK(BM_BpDenoisingChain)->Apply(chain_args);
+
+static void BM_BpDenseRandomModel(benchmark::State& state){ bp_on_model(state, dense); }
+BENCHMARK(BM_BpDenseRandomModel)->Apply(dense_args);
+
+static void BM_BpMessagesFloatStereoGrid(benchmark::State& state){ bp_messages_on_model<float>(state, stereo); }
+BENCHMARK(BM_BpMessagesFloatStereoGrid)->Arg(64)->Arg(256);
+
+static void BM_BpMessagesFloat16StereoGrid(benchmark::State& state){ bp_messages_on_model<opengm::float16>(state, stereo); }
+BENCHMARK(BM_BpMessagesFloat16StereoGrid)->Arg(64)->Arg(256);
+
+static void BM_BpMessagesBFloat16StereoGrid(benchmark::State& state){ bp_messages_on_model<opengm::bfloat16>(state, stereo); }
+BENCHMARK(BM_BpMessagesBFloat16StereoGrid)->Arg(64)->Arg(256);
+
+static void BM_BpMessagesFloatPottsVolume(benchmark::State& state){ bp_messages_on_model<float>(state, volume); }
+BENCHMARK(BM_BpMessagesFloatPottsVolume)->Arg(16)->Arg(32);
+
+static void BM_BpMessagesFloat16PottsVolume(benchmark::State& state){ bp_messages_on_model<opengm::float16>(state, volume); }
+BENCHMARK(BM_BpMessagesFloat16PottsVolume)->Arg(16)->Arg(32);
+
+static void BM_BpMessagesBFloat16PottsVolume(benchmark::State& state){ bp_messages_on_model<opengm::bfloat16>(state, volume); }
+BENCHMARK(BM_BpMessagesBFloat16PottsVolume)->Arg(16)->Arg(32);
+
+static void BM_BpConvergedStereoGrid(benchmark::State& state){ bp_active_set_on_model(state, stereo, false); }
+BENCHMARK(BM_BpConvergedStereoGrid)->Arg(64)->Arg(256);
+
+static void BM_BpActiveSetStereoGrid(benchmark::State& state){ bp_active_set_on_model(state, stereo, true); }
+BENCHMARK(BM_BpActiveSetStereoGrid)->Arg(64)->Arg(256);
+
+static void BM_BpConvergedPottsVolume(benchmark::State& state){ bp_active_set_on_model(state, volume, false); }
+BENCHMARK(BM_BpConvergedPottsVolume)->Arg(16)->Arg(32);
+
+static void BM_BpActiveSetPottsVolume(benchmark::State& state){ bp_active_set_on_model(state, volume, true); }
+BENCHMARK(BM_BpActiveSetPottsVolume)->Arg(16)->Arg(32);
+
+static void BM_TrwsStereoGrid(benchmark::State& state){ trws_on_model(state, stereo); }
+BENCHMARK(BM_TrwsStereoGrid)->Apply(grid_args);
+
+static void BM_TrwsPottsVolume(benchmark::State& state){ trws_on_model(state, volume); }
+BENCHMARK(BM_TrwsPottsVolume)->Apply(volume_args);
+
+static void BM_IcmStereoGrid(benchmark::State& state){ icm_on_model(state, stereo); }
+BENCHMARK(BM_IcmStereoGrid)->Apply(grid_args);
+
+static void BM_IcmPottsVolume(benchmark::State& state){ icm_on_model(state, volume); }
+BENCHMARK(BM_IcmPottsVolume)->Apply(volume_args);
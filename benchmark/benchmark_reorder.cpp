@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// our headers
+#include "opengm/toy_models.hpp"
+#include "opengm/reorder.hpp"
+#include "opengm/minimizer/bp.hpp"
+#include "opengm/minimizer/icm.hpp"
+
+
+namespace{
+
+    using gm_type = decltype(opengm::RandomPottsGrid(1, 1, 2)());
+    using reordered_type = opengm::ReorderedGm<gm_type>;
+
+    // range(1): 0 = shuffled, 1 = reverse Cuthill-McKee, 2 = bfs
+    std::unique_ptr<reordered_type> make_model(const std::size_t n, const std::size_t order){
+        const auto gm = opengm::RandomPottsGrid(n, n, 5)();
+        std::vector<std::size_t> permutation(gm.num_variables());
+        std::iota(permutation.begin(), permutation.end(), 0);
+        std::shuffle(permutation.begin(), permutation.end(), std::mt19937(42));
+        auto shuffled = std::make_unique<reordered_type>(gm, permutation);
+        if(order == 0){
+            return shuffled;
+        }
+        return std::make_unique<reordered_type>(shuffled->gm(),
+            order == 1 ? opengm::ReorderMethod::reverse_cuthill_mckee : opengm::ReorderMethod::bfs);
+    }
+
+    void reorder_args(benchmark::internal::Benchmark * b){
+        for(auto n : {64, 256}){
+            for(auto order : {0, 1, 2}){
+                b->Args({n, order});
+            }
+        }
+    }
+}
+
+
+static void BM_BpReordered(benchmark::State& state)
+{
+    const auto model = make_model(state.range(0), state.range(1));
+    const auto & gm = model->gm();
+
+    using minimizer_type = opengm::BeliefPropergation<gm_type>;
+    typename minimizer_type::settings_type settings;
+    settings.num_iterations = 10;
+    settings.convergence = 0;
+
+    while (state.KeepRunning())
+    {
+        minimizer_type minimizer(gm, settings);
+        minimizer.minimize();
+        benchmark::DoNotOptimize(minimizer.best_energy());
+    }
+    state.SetItemsProcessed(state.iterations() * settings.num_iterations * gm.num_factors());
+}
+BENCHMARK(BM_BpReordered)->Apply(reorder_args);
+
+
+static void BM_IcmReordered(benchmark::State& state)
+{
+    const auto model = make_model(state.range(0), state.range(1));
+    const auto & gm = model->gm();
+
+    using minimizer_type = opengm::Icm<gm_type>;
+
+    while (state.KeepRunning())
+    {
+        minimizer_type minimizer(gm);
+        minimizer.minimize();
+        benchmark::DoNotOptimize(minimizer.best_energy());
+    }
+    state.SetItemsProcessed(state.iterations() * gm.num_variables());
+}
+BENCHMARK(BM_IcmReordered)->Apply(reorder_args);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <new>
+#include <vector>
+#include <cstddef>
+
+namespace opengm{
+
+    // allocator returning memory aligned to ALIGNMENT bytes
+    // st. rows of padded blocks start on a cache line / simd boundary
+    template<class T, std::size_t ALIGNMENT = 64>
+    class AlignedAllocator{
+    public:
+        using value_type = T;
+
+        template<class U>
+        struct rebind{
+            using other = AlignedAllocator<U, ALIGNMENT>;
+        };
+
+        AlignedAllocator() noexcept = default;
+
+        template<class U>
+        AlignedAllocator(const AlignedAllocator<U, ALIGNMENT> &) noexcept{
+        }
+
+        T * allocate(const std::size_t n){
+            return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(ALIGNMENT)));
+        }
+        void deallocate(T * p, const std::size_t) noexcept{
+            ::operator delete(p, std::align_val_t(ALIGNMENT));
+        }
+
+        template<class U>
+        bool operator==(const AlignedAllocator<U, ALIGNMENT> &)const noexcept{
+            return true;
+        }
+        template<class U>
+        bool operator!=(const AlignedAllocator<U, ALIGNMENT> &)const noexcept{
+            return false;
+        }
+    };
+
+    template<class T, std::size_t ALIGNMENT = 64>
+    using aligned_vector = std::vector<T, AlignedAllocator<T, ALIGNMENT>>;
+
+    // number of elements of type T per row st. each
+    // row of a padded block spans a multiple of ALIGNMENT bytes
+    template<class T, std::size_t ALIGNMENT = 64>
+    constexpr std::size_t padded_size(const std::size_t n){
+        constexpr std::size_t per_line = ALIGNMENT / sizeof(T) > 0 ? ALIGNMENT / sizeof(T) : 1;
+        return ((n + per_line - 1) / per_line) * per_line;
+    }
+
+    // number of elements of type T per row st. rows of at least
+    // ALIGNMENT bytes span a multiple of ALIGNMENT bytes and shorter
+    // rows a power of two elements. Rows stored at multiples of their
+    // size within an aligned block then never straddle an ALIGNMENT
+    // boundary, small rows are not inflated to a full line.
+    template<class T, std::size_t ALIGNMENT = 64>
+    constexpr std::size_t packed_row_size(const std::size_t n){
+        if(n * sizeof(T) >= ALIGNMENT){
+            return padded_size<T, ALIGNMENT>(n);
+        }
+        std::size_t size = 1;
+        while(size < n){
+            size *= 2;
+        }
+        return size;
+    }
+}
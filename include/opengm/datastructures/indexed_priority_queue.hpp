@@ -0,0 +1,153 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <utility>
+#include <functional>
+
+namespace opengm {
+
+
+    // Binary heap over the indices [0, size) where the priority of
+    // each contained index can be changed in O(log size).
+    // The index with the largest priority (w.r.t. COMPARE) is on top.
+    template<class T, class COMPARE = std::less<T>>
+    class IndexedPriorityQueue{
+    public:
+        using priority_type = T;
+
+        explicit IndexedPriorityQueue(const std::size_t size = 0, const COMPARE & compare = COMPARE())
+        :   m_heap(),
+            m_position(size, none),
+            m_priority(size),
+            m_compare(compare){
+        }
+
+        void resize(const std::size_t size){
+            this->clear();
+            m_position.assign(size, none);
+            m_priority.resize(size);
+        }
+
+        bool empty()const{
+            return m_heap.empty();
+        }
+        std::size_t size()const{
+            return m_heap.size();
+        }
+        bool contains(const std::size_t i)const{
+            return m_position[i] != none;
+        }
+        const priority_type & priority(const std::size_t i)const{
+            return m_priority[i];
+        }
+
+        std::size_t top()const{
+            return m_heap.front();
+        }
+        const priority_type & top_priority()const{
+            return m_priority[m_heap.front()];
+        }
+
+        // insert i or change its priority
+        void push(const std::size_t i, const priority_type & priority){
+            if(!this->contains(i)){
+                m_position[i] = m_heap.size();
+                m_heap.push_back(i);
+                m_priority[i] = priority;
+                this->sift_up(m_position[i]);
+            }
+            else{
+                const auto increased = m_compare(m_priority[i], priority);
+                m_priority[i] = priority;
+                if(increased){
+                    this->sift_up(m_position[i]);
+                }
+                else{
+                    this->sift_down(m_position[i]);
+                }
+            }
+        }
+
+        std::size_t pop(){
+            const auto i = m_heap.front();
+            this->erase(i);
+            return i;
+        }
+
+        void erase(const std::size_t i){
+            if(!this->contains(i)){
+                return;
+            }
+            const auto pos = m_position[i];
+            const auto last = m_heap.back();
+            m_heap.pop_back();
+            m_position[i] = none;
+            if(last != i){
+                m_heap[pos] = last;
+                m_position[last] = pos;
+                this->sift_up(pos);
+                this->sift_down(m_position[last]);
+            }
+        }
+
+        void clear(){
+            for(auto i : m_heap){
+                m_position[i] = none;
+            }
+            m_heap.clear();
+        }
+
+        std::size_t memory_usage()const{
+            return m_heap.capacity() * sizeof(std::size_t) + m_position.capacity() * sizeof(std::size_t) +
+                m_priority.capacity() * sizeof(priority_type);
+        }
+
+    private:
+        static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+        void sift_up(std::size_t pos){
+            const auto i = m_heap[pos];
+            while(pos > 0){
+                const auto parent = (pos - 1) / 2;
+                if(!m_compare(m_priority[m_heap[parent]], m_priority[i])){
+                    break;
+                }
+                this->place(pos, m_heap[parent]);
+                pos = parent;
+            }
+            this->place(pos, i);
+        }
+
+        void sift_down(std::size_t pos){
+            const auto i = m_heap[pos];
+            const auto n = m_heap.size();
+            while(true){
+                auto child = 2 * pos + 1;
+                if(child >= n){
+                    break;
+                }
+                if(child + 1 < n && m_compare(m_priority[m_heap[child]], m_priority[m_heap[child + 1]])){
+                    ++child;
+                }
+                if(!m_compare(m_priority[i], m_priority[m_heap[child]])){
+                    break;
+                }
+                this->place(pos, m_heap[child]);
+                pos = child;
+            }
+            this->place(pos, i);
+        }
+
+        void place(const std::size_t pos, const std::size_t i){
+            m_heap[pos] = i;
+            m_position[i] = pos;
+        }
+
+        std::vector<std::size_t> m_heap;
+        std::vector<std::size_t> m_position;
+        std::vector<priority_type> m_priority;
+        COMPARE m_compare;
+    };
+
+}
@@ -65,6 +65,14 @@ namespace opengm {
             this->derived_cast().tensor()->add_values(out);
         }
 
+        void batch_add_values(
+            const label_type * labels,
+            const std::size_t num_labelings,
+            value_type * out
+        )const{
+            this->derived_cast().tensor()->batch_add_values(labels, num_labelings, out);
+        }
+
 
 
         void factor_to_variable_messages(
@@ -4,6 +4,7 @@
 #include <memory>
 #include <utility>
 
+#include <gsl-lite/gsl-lite.hpp>
 
 #include "opengm/factor_base.hpp"
 #include "opengm/factors.hpp"
@@ -30,12 +31,13 @@ namespace opengm{
         using label_type = std::size_t;
         using value_type = T;
 
-        template<class ITER>
-        VFactor(const TensorBase<T> *  tensor, ITER var_begin, ITER var_end)
+        // the variable indices are not owned by the factor,
+        // they live in the index pool of the graphical model
+        VFactor(const TensorBase<T> *  tensor, const std::size_t * variables, const std::size_t num_variables)
         :   m_tensor(tensor),
-            m_variables(var_begin, var_end){
+            m_variables(variables, num_variables){
         }
-        const auto & variables()const{
+        gsl::span<const std::size_t> variables()const{
             return m_variables;
         }
 
@@ -56,6 +58,6 @@ namespace opengm{
 
     private:
         const TensorBase<T> * m_tensor;
-        std::vector<std::size_t> m_variables;
+        gsl::span<const std::size_t> m_variables;
     };
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include <vector>
 
+#include "opengm/memory_stats.hpp"
+
 namespace opengm{
 
 
@@ -23,14 +25,17 @@ namespace opengm{
                 ++factor_index;
             }
         }
+        std::size_t memory_usage()const{
+            return detail::heap_bytes(static_cast<const base_type &>(*this));
+        }
     };
 
 
 
     namespace detail{
         struct HigherOrderAndUnaryFactorsOfVariablesValueType{
-            auto unaries()const{return m_unaries;}
-            auto higher_order()const{return m_higher_order;}
+            const auto & unaries()const{return m_unaries;}
+            const auto & higher_order()const{return m_higher_order;}
             std::vector<std::size_t> m_unaries;
             std::vector<std::size_t> m_higher_order;
         };
@@ -57,6 +62,13 @@ namespace opengm{
                 ++factor_index;
             }
         }
+        std::size_t memory_usage()const{
+            auto bytes = this->capacity() * sizeof(typename base_type::value_type);
+            for(auto && factors : *this){
+                bytes += detail::heap_bytes(factors.m_unaries) + detail::heap_bytes(factors.m_higher_order);
+            }
+            return bytes;
+        }
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace opengm{
+
+
+namespace detail{
+
+    inline std::uint32_t float_bits(const float value){
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+    inline float bits_float(const std::uint32_t bits){
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+
+    // IEEE 754 binary16 storage type, converted with round to nearest
+    // even (by the F16C instructions where available). Values beyond
+    // +-65504 become infinity, arithmetic is done in float. Only meant
+    // for compact storage, e.g. of messages.
+    struct float16{
+        std::uint16_t bits{0};
+
+        float16() = default;
+        explicit float16(const float value)
+        :   bits(from_float(value)){
+        }
+        operator float()const{
+            return to_float(bits);
+        }
+
+        static std::uint16_t from_float(const float value){
+#if defined(__F16C__)
+            return _cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT);
+#else
+            const auto f32_infinity = std::uint32_t(255) << 23;
+            const auto f16_max = std::uint32_t(127 + 16) << 23;
+            const auto denorm_magic = std::uint32_t((127 - 15) + (23 - 10) + 1) << 23;
+
+            auto bits = detail::float_bits(value);
+            const auto sign = bits & 0x80000000u;
+            bits ^= sign;
+
+            std::uint32_t result;
+            if(bits >= f16_max){
+                // overflow to infinity, nan stays a (quiet) nan
+                result = bits > f32_infinity ? 0x7e00 : 0x7c00;
+            }
+            else if(bits < (std::uint32_t(113) << 23)){
+                // subnormal or zero, the float addition does the rounding
+                result = detail::float_bits(detail::bits_float(bits) + detail::bits_float(denorm_magic)) - denorm_magic;
+            }
+            else{
+                const auto mantissa_odd = (bits >> 13) & 1;
+                bits += (std::uint32_t(15 - 127) << 23) + 0xfff;
+                bits += mantissa_odd;
+                result = bits >> 13;
+            }
+            return std::uint16_t(result | (sign >> 16));
+#endif
+        }
+
+        static float to_float(const std::uint16_t half){
+#if defined(__F16C__)
+            return _cvtsh_ss(half);
+#else
+            const auto shifted_exponent = std::uint32_t(0x7c00) << 13;
+            auto bits = std::uint32_t(half & 0x7fff) << 13;
+            const auto exponent = shifted_exponent & bits;
+            bits += std::uint32_t(127 - 15) << 23;
+            if(exponent == shifted_exponent){
+                // infinity or nan
+                bits += std::uint32_t(128 - 16) << 23;
+            }
+            else if(exponent == 0){
+                // zero or subnormal
+                bits += std::uint32_t(1) << 23;
+                bits = detail::float_bits(detail::bits_float(bits) - detail::bits_float(std::uint32_t(113) << 23));
+            }
+            return detail::bits_float(bits | (std::uint32_t(half & 0x8000) << 16));
+#endif
+        }
+    };
+
+
+    // the upper half of a float: the range of float with 8 bits of
+    // mantissa, converted with round to nearest even
+    struct bfloat16{
+        std::uint16_t bits{0};
+
+        bfloat16() = default;
+        explicit bfloat16(const float value)
+        :   bits(from_float(value)){
+        }
+        operator float()const{
+            return detail::bits_float(std::uint32_t(bits) << 16);
+        }
+
+        static std::uint16_t from_float(const float value){
+            const auto bits = detail::float_bits(value);
+            const auto rounded = (bits + 0x7fff + ((bits >> 16) & 1)) >> 16;
+            // keep nan a (quiet) nan, a select st. loops vectorize
+            const auto quiet_nan = (bits >> 16) | 0x40;
+            return std::uint16_t((bits & 0x7fffffffu) > 0x7f800000u ? quiet_nan : rounded);
+        }
+    };
+
+
+    // convert size values, e.g. a row of messages, the float16
+    // overloads convert 8 values at once with F16C where available
+    template<class S, class D>
+    inline void convert(const S * in, const std::size_t size, D * out){
+        for(std::size_t i=0; i<size; ++i){
+            out[i] = D(in[i]);
+        }
+    }
+    inline void convert(const float16 * in, const std::size_t size, float * out){
+        std::size_t i = 0;
+#if defined(__F16C__)
+        for(; i + 8 <= size; i += 8){
+            _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i))));
+        }
+#endif
+        for(; i<size; ++i){
+            out[i] = float(in[i]);
+        }
+    }
+    inline void convert(const float * in, const std::size_t size, float16 * out){
+        std::size_t i = 0;
+#if defined(__F16C__)
+        for(; i + 8 <= size; i += 8){
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+        }
+#endif
+        for(; i<size; ++i){
+            out[i] = float16(in[i]);
+        }
+    }
+
+}
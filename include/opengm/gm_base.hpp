@@ -2,10 +2,130 @@
 
 #include <array>
 #include <vector>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
 #include "opengm/crtp_base.hpp"
+#include "opengm/meta.hpp"
+#include "opengm/memory_stats.hpp"
 
 namespace opengm {
 
+    namespace detail{
+        // models with an implicit structure can provide
+        //  gm.conditional_energies(vi, labels, out)
+        // which writes the energy of all factors connected to vi
+        // for each label of vi while all other variables
+        // are fixed to labels
+        template<class GM>
+        using conditional_energies_t = decltype(
+            std::declval<const GM &>().conditional_energies(
+                std::size_t(),
+                std::declval<const typename GM::labels_vector_type &>(),
+                std::declval<typename GM::value_type *>()
+            )
+        );
+    }
+
+    template<class GM>
+    using has_conditional_energies = meta::is_detected<detail::conditional_energies_t, GM>;
+
+    namespace detail{
+        struct pairwise_tensor_visitor{
+            template<class TENSOR>
+            void operator()(const std::size_t, const TENSOR &)const{}
+        };
+
+        // models with an implicit structure can provide
+        //  gm.for_each_pairwise_tensor(e_begin, e_end, f)
+        // which calls f(num_variables + e, tensor) for e in [e_begin, e_end)
+        // with a lightweight tensor of the pairwise factor num_variables + e.
+        // Such models have exactly one unary per variable, all of them in
+        // the dense unary block, followed by the pairwise factors
+        template<class GM>
+        using pairwise_tensors_t = decltype(
+            std::declval<const GM &>().for_each_pairwise_tensor(
+                std::size_t(),
+                std::size_t(),
+                std::declval<pairwise_tensor_visitor>()
+            )
+        );
+    }
+
+    template<class GM>
+    using has_pairwise_tensors = meta::is_detected<detail::pairwise_tensors_t, GM>;
+
+
+    // view of a dense (num_variables x stride) row major unary block.
+    // The unary factor of variable vi is the factor factor_begin + vi
+    // and its values are (*this)[vi][0, num_labels(vi)).
+    // Rows may be padded, solvers can read them with simd.
+    template<class T>
+    struct DenseUnaries{
+        const T * data{nullptr};
+        std::size_t stride{0};
+        std::size_t factor_begin{0};
+        std::size_t num_variables{0};
+
+        explicit operator bool()const{
+            return data != nullptr;
+        }
+        const T * operator[](const std::size_t vi)const{
+            return data + vi * stride;
+        }
+        bool contains_factor(const std::size_t fi)const{
+            return data != nullptr && fi >= factor_begin && fi - factor_begin < num_variables;
+        }
+    };
+
+    namespace detail{
+        template<class GM>
+        using dense_unaries_t = decltype(std::declval<const GM &>().dense_unaries());
+    }
+
+    template<class GM>
+    using has_dense_unaries = meta::is_detected<detail::dense_unaries_t, GM>;
+
+    // the dense unary block of gm or an empty view if the
+    // model has none
+    template<class GM>
+    DenseUnaries<typename GM::value_type> dense_unaries_of(const GM & gm){
+        if constexpr(has_dense_unaries<GM>::value){
+            return gm.dense_unaries();
+        }
+        else{
+            return DenseUnaries<typename GM::value_type>();
+        }
+    }
+
+
+    namespace detail{
+        // out-of-core models can provide
+        //  gm.prefetch_factors(fi_begin, fi_end)
+        // to load the tensors of factors ahead of their access
+        template<class GM>
+        using prefetch_factors_t = decltype(
+            std::declval<const GM &>().prefetch_factors(
+                std::declval<const std::size_t *>(),
+                std::declval<const std::size_t *>()
+            )
+        );
+    }
+
+    template<class GM>
+    using has_prefetch_factors = meta::is_detected<detail::prefetch_factors_t, GM>;
+
+    // hint that the factors in [fi_begin, fi_end) are accessed soon,
+    // solvers pass the factors of their next step.
+    // A no-op for models which are held in memory
+    template<class GM, class ITER>
+    void prefetch_factors(const GM & gm, ITER fi_begin, ITER fi_end){
+        if constexpr(has_prefetch_factors<GM>::value){
+            gm.prefetch_factors(fi_begin, fi_end);
+        }
+    }
+
 
     template<class derived>
     class GmTraits;
@@ -33,6 +153,30 @@ namespace opengm {
             }
         }
 
+        // call f(fi, factor) for all factors of arity ARITY. The factor
+        // still reports its arity at runtime, but the caller knows that
+        // it is ARITY, e.g. to use std::array buffers (see BP).
+        // Models which group their factors by arity only
+        // visit the matching factors.
+        template<std::size_t ARITY, class F>
+        void for_each_factor_of_arity(F && f)const{
+            this->derived_cast().for_each_factor([&](auto fi, auto && factor){
+                if(factor.arity() == ARITY){
+                    f(fi, factor);
+                }
+            });
+        }
+
+        // call f(fi, factor) for all factors with arity >= MIN_ARITY
+        template<std::size_t MIN_ARITY, class F>
+        void for_each_factor_of_min_arity(F && f)const{
+            this->derived_cast().for_each_factor([&](auto fi, auto && factor){
+                if(factor.arity() >= MIN_ARITY){
+                    f(fi, factor);
+                }
+            });
+        }
+
         std::size_t size()const{
             return this->derived_cast().space().size();
         }
@@ -55,6 +199,14 @@ namespace opengm {
             return this->derived_cast().max_arity();
         }
 
+        // models which store factors or tensors
+        // extend this by their own storage
+        MemoryStats memory_stats()const{
+            MemoryStats stats;
+            stats.space = this->derived_cast().space().memory_usage();
+            return stats;
+        }
+
 
 
 
@@ -106,6 +258,41 @@ namespace opengm {
             return energy;
 
         }
+
+        // evaluate many labelings at once.
+        // The loop is factor-major: each factor and its variables
+        // are loaded once and all labelings are evaluated
+        // against it with a single batched tensor call.
+        template<class LABELINGS, class ENERGIES>
+        void evaluate_many(const LABELINGS & labelings, ENERGIES & out_energies)const{
+
+            const auto num_labelings = std::size_t(std::distance(std::begin(labelings), std::end(labelings)));
+            if(std::size_t(std::distance(std::begin(out_energies), std::end(out_energies))) < num_labelings)
+            {
+                throw std::runtime_error("out_energies.size() < number of labelings");
+            }
+
+            // value buffer st. we can work on raw pointers even if
+            // out_energies is not contiguous
+            std::vector<value_type> energies(num_labelings, value_type(0));
+
+            // row-major (num_labelings x arity) label matrix of one factor
+            std::vector<label_type> label_buffer(num_labelings * this->derived_cast().arity_upper_bound());
+
+            for(auto && factor : this->derived_cast()){
+                auto && variables = factor.variables();
+                const auto arity = variables.size();
+                auto labels_ptr = label_buffer.data();
+                for(auto && labels : labelings){
+                    for(std::size_t i=0; i<arity; ++i){
+                        labels_ptr[i] = labels[variables[i]];
+                    }
+                    labels_ptr += arity;
+                }
+                factor.batch_add_values(label_buffer.data(), num_labelings, energies.data());
+            }
+            std::copy(energies.begin(), energies.end(), std::begin(out_energies));
+        }
     };
 
 
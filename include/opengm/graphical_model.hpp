@@ -4,6 +4,8 @@
 #include <vector>
 #include <memory>
 #include <utility>
+#include <algorithm>
+#include <stdexcept>
 
 #include "opengm/factor_base.hpp"
 #include "opengm/factors.hpp"
@@ -11,6 +13,7 @@
 #include "opengm/gm_base.hpp"
 #include "opengm/tensors.hpp"
 #include "opengm/tensor_view_gm.hpp"
+#include "opengm/aligned_allocator.hpp"
 
 namespace opengm{
 
@@ -39,22 +42,39 @@ namespace opengm{
         using virtual_tensor_base_type = TensorBase<T>;
         using tensor_type = virtual_tensor_base_type;
         using unique_tensor_ptr = std::unique_ptr<tensor_type>;
+        using value_type = T;
+        using dense_unaries_type = DenseUnaries<T>;
 
         template<class ... ARGS>
         GraphicalModel(ARGS && ... args)
         :   base_type(std::forward<ARGS>(args)...),
-            m_tensors()
+            m_tensors(),
+            m_dense_unaries(),
+            m_dense_unaries_storage(),
+            m_storage()
         {
 
         }
 
         GraphicalModel(space_type && space)
         :   base_type(std::forward<space_type>(space)),
-            m_tensors()
+            m_tensors(),
+            m_dense_unaries(),
+            m_dense_unaries_storage(),
+            m_storage()
         {
 
         }
 
+        void reserve(const std::size_t num_factors, const std::size_t num_index_entries, const std::size_t num_tensors){
+            base_type::reserve(num_factors, num_index_entries);
+            m_tensors.reserve(num_tensors);
+        }
+
+        std::size_t num_tensors()const{
+            return m_tensors.size();
+        }
+
         auto add_tensor(unique_tensor_ptr tensor){
             const auto tid = m_tensors.size();
             m_tensors.push_back(std::move(tensor));
@@ -103,11 +123,154 @@ namespace opengm{
         }
 
 
+        // add one unary factor per variable with the values stored in a
+        // dense (num_variables x stride) block owned by the model.
+        // The rows are padded to full cache lines and initialized with zero.
+        // Returns the id of the first unary factor, the unary of vi is
+        // the factor first + vi.
+        auto add_dense_unaries(){
+            const auto stride = padded_size<value_type>(this->space().max_num_labels());
+            m_dense_unaries_storage.assign(this->num_variables() * stride, value_type(0));
+            return this->add_dense_unaries(m_dense_unaries_storage.data(), stride);
+        }
+
+        // zero copy: the unaries view the external row major
+        // (num_variables x stride) buffer which needs to outlive the model.
+        // Only the values are pooled, every unary is still a small
+        // heap allocated UnaryViewTensor in the tensor table st. it
+        // behaves like any other factor of the model.
+        auto add_dense_unaries(value_type * data, const std::size_t stride){
+            if(m_dense_unaries){
+                throw std::runtime_error("model has already a dense unary block");
+            }
+            if(stride < this->space().max_num_labels()){
+                throw std::runtime_error("stride must be at least the max. number of labels");
+            }
+            const auto num_variables = this->num_variables();
+            const auto first_tid = m_tensors.size();
+            this->reserve(
+                this->num_factors() + num_variables,
+                this->num_index_entries() + num_variables,
+                m_tensors.size() + num_variables
+            );
+            for(std::size_t vi=0; vi<num_variables; ++vi){
+                this->add_tensor(std::make_unique<UnaryViewTensor<T>>(data + vi * stride, this->num_labels(vi)));
+            }
+            const auto factor_begin = this->num_factors();
+            for(std::size_t vi=0; vi<num_variables; ++vi){
+                this->add_unary_factor(first_tid + vi, vi);
+            }
+            m_dense_unaries = dense_unaries_type{data, stride, std::size_t(factor_begin), num_variables};
+            m_dense_unaries_data = data;
+            return factor_begin;
+        }
+
+        // zero copy view of a 2D row major array with
+        // data() and shape(), e.g. xtensor or a numpy buffer
+        template<class ARRAY>
+        auto add_dense_unaries_view(ARRAY & array){
+            auto && shape = array.shape();
+            if(shape.size() != 2 || std::size_t(shape[0]) != this->num_variables()){
+                throw std::runtime_error("array must have the shape (num_variables, num_labels)");
+            }
+            return this->add_dense_unaries(array.data(), std::size_t(shape[1]));
+        }
+
+        // move a pool of values or shapes into the model st. view tensors
+        // added afterwards, e.g. ExplicitViewTensor, can point into it.
+        // The returned data stays valid as long as the model lives.
+        template<class V>
+        const V * add_storage(std::vector<V> && storage){
+            auto owned = std::make_shared<std::vector<V>>(std::move(storage));
+            const V * data = owned->data();
+            m_storage_bytes += detail::heap_bytes(*owned);
+            m_storage.push_back(std::move(owned));
+            return data;
+        }
+
+        // keep an external owner of data viewed by tensors alive as
+        // long as the model lives, e.g. a memory mapping.
+        // bytes is reported in the memory statistics
+        void add_storage(std::shared_ptr<const void> owner, const std::size_t bytes = 0){
+            m_storage_bytes += bytes;
+            m_storage.push_back(std::move(owner));
+        }
+
+        dense_unaries_type dense_unaries()const{
+            return m_dense_unaries;
+        }
+        // mutable access to the dense unary block
+        gsl::span<value_type> dense_unaries_block(){
+            return gsl::span<value_type>(m_dense_unaries_data, m_dense_unaries.num_variables * m_dense_unaries.stride);
+        }
+        gsl::span<value_type> dense_unaries_block(const std::size_t vi){
+            return gsl::span<value_type>(m_dense_unaries_data + vi * m_dense_unaries.stride, this->num_labels(vi));
+        }
+
+        // the version is incremented by every value update.
+        // Only the values change, the structure of the model and
+        // therefore all index structures of minimizers stay valid.
+        std::size_t version()const{
+            return m_version;
+        }
+
+        // modify the values of tensor tid in place with f(tensor).
+        // TENSOR is the concrete type of the tensor, the shape
+        // must not be changed. Returns the new version.
+        template<class TENSOR, class F>
+        std::size_t update_tensor(const std::size_t tid, F && f){
+            auto tensor = dynamic_cast<TENSOR *>(m_tensors.at(tid).get());
+            if(tensor == nullptr){
+                throw std::runtime_error("tensor has not the requested type");
+            }
+            f(*tensor);
+            return ++m_version;
+        }
+
+        // overwrite the row of vi in the dense unary block with
+        // num_labels(vi) values. Returns the new version.
+        template<class ITER>
+        std::size_t update_dense_unaries(const std::size_t vi, ITER values_begin){
+            if(!m_dense_unaries){
+                throw std::runtime_error("model has no dense unary block");
+            }
+            auto row = this->dense_unaries_block(vi);
+            std::copy_n(values_begin, row.size(), row.begin());
+            return ++m_version;
+        }
+
+        MemoryStats memory_stats()const{
+            auto stats = base_type::memory_stats();
+            for(auto && tensor : m_tensors){
+                stats.tensors[tensor->name()] += tensor->memory_usage();
+            }
+            if(!m_dense_unaries_storage.empty()){
+                stats.tensors["DenseUnaryBlock"] += detail::heap_bytes(m_dense_unaries_storage);
+            }
+            if(!m_storage.empty()){
+                stats.tensors["Storage"] += m_storage_bytes;
+            }
+            return stats;
+        }
+
         void clear(){
             base_type::clear();
             m_tensors.clear();
+            m_dense_unaries = dense_unaries_type();
+            m_dense_unaries_data = nullptr;
+            m_dense_unaries_storage.clear();
+            m_storage.clear();
+            m_storage_bytes = 0;
+            ++m_version;
         }
     private:
         std::vector<unique_tensor_ptr> m_tensors;
+        dense_unaries_type m_dense_unaries;
+        value_type * m_dense_unaries_data{nullptr};
+        aligned_vector<value_type> m_dense_unaries_storage;
+        // pools viewed by tensors, see add_storage
+        std::vector<std::shared_ptr<const void>> m_storage;
+        std::size_t m_storage_bytes{0};
+        std::size_t m_version{0};
     };
 }
\ No newline at end of file
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <stdexcept>
+#include <initializer_list>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "opengm/tensors.hpp"
+#include "opengm/graphical_model.hpp"
+
+namespace opengm{
+
+
+    // Collects tensors and factors without a graphical model.
+    // A builder is not thread safe, but several builders (shards)
+    // can be filled concurrently, one per thread, and merged
+    // into a single GraphicalModel with merge_builders.
+    // Tensor ids and factor ids are local to the builder.
+    template<class T>
+    class GraphicalModelBuilder{
+    public:
+        using value_type = T;
+        using tensor_type = TensorBase<T>;
+        using unique_tensor_ptr = std::unique_ptr<tensor_type>;
+
+        GraphicalModelBuilder()
+        :   m_tensors(),
+            m_variable_indices(),
+            m_factor_offsets(1, 0),
+            m_tensor_ids(){
+        }
+
+        void reserve(const std::size_t num_factors, const std::size_t num_index_entries, const std::size_t num_tensors){
+            m_factor_offsets.reserve(num_factors + 1);
+            m_tensor_ids.reserve(num_factors);
+            m_variable_indices.reserve(num_index_entries);
+            m_tensors.reserve(num_tensors);
+        }
+
+        std::size_t num_factors()const{
+            return m_tensor_ids.size();
+        }
+        std::size_t num_index_entries()const{
+            return m_variable_indices.size();
+        }
+        std::size_t num_tensors()const{
+            return m_tensors.size();
+        }
+
+        std::size_t add_tensor(unique_tensor_ptr tensor){
+            const auto tid = m_tensors.size();
+            m_tensors.push_back(std::move(tensor));
+            return tid;
+        }
+
+        template<class ITER>
+        std::size_t add_factor(const std::size_t tid, ITER var_begin, ITER var_end){
+            const auto fid = m_tensor_ids.size();
+            m_variable_indices.insert(m_variable_indices.end(), var_begin, var_end);
+            m_factor_offsets.push_back(m_variable_indices.size());
+            m_tensor_ids.push_back(tid);
+            return fid;
+        }
+
+        template<class VAR_T>
+        std::size_t add_factor(const std::size_t tid, std::initializer_list<VAR_T> vars){
+            return this->add_factor(tid, vars.begin(), vars.end());
+        }
+
+        // add tensor_ids.size() factors of the same arity at once.
+        // variable_indices is a row major (num_factors x arity) matrix.
+        // Returns the id of the first added factor.
+        std::size_t add_factors(
+            const std::size_t arity,
+            gsl::span<const std::size_t> variable_indices,
+            gsl::span<const std::size_t> tensor_ids
+        ){
+            const auto num_factors = std::size_t(tensor_ids.size());
+            if(std::size_t(variable_indices.size()) != num_factors * arity){
+                throw std::runtime_error("variable_indices must have num_factors * arity entries");
+            }
+            // no exact reserve here: the range inserts grow geometrically,
+            // an exact reserve would reallocate on each call
+            const auto fid = m_tensor_ids.size();
+            m_variable_indices.insert(m_variable_indices.end(), variable_indices.begin(), variable_indices.end());
+            auto offset = m_factor_offsets.back();
+            for(std::size_t i=0; i<num_factors; ++i){
+                offset += arity;
+                m_factor_offsets.push_back(offset);
+            }
+            m_tensor_ids.insert(m_tensor_ids.end(), tensor_ids.begin(), tensor_ids.end());
+            return fid;
+        }
+
+        // same as above but all factors share the tensor tid
+        std::size_t add_factors(
+            const std::size_t arity,
+            gsl::span<const std::size_t> variable_indices,
+            const std::size_t tid
+        ){
+            const std::vector<std::size_t> tensor_ids(arity == 0 ? 0 : variable_indices.size() / arity, tid);
+            return this->add_factors(arity, variable_indices, gsl::span<const std::size_t>(tensor_ids.data(), tensor_ids.size()));
+        }
+
+        // move all tensors and factors into gm and clear the builder.
+        // The tensor ids / factor ids are shifted by the number of
+        // tensors / factors gm had before.
+        template<class SPACE>
+        void append_to(GraphicalModel<SPACE, T> & gm){
+            gm.reserve(
+                gm.num_factors() + this->num_factors(),
+                gm.num_index_entries() + this->num_index_entries(),
+                gm.num_tensors() + this->num_tensors()
+            );
+            const auto tid_offset = gm.num_tensors();
+            for(auto & tensor : m_tensors){
+                gm.add_tensor(std::move(tensor));
+            }
+            const auto indices = m_variable_indices.data();
+            for(std::size_t fi=0; fi<m_tensor_ids.size(); ++fi){
+                gm.add_factor(
+                    tid_offset + m_tensor_ids[fi],
+                    indices + m_factor_offsets[fi],
+                    indices + m_factor_offsets[fi + 1]
+                );
+            }
+            this->clear();
+        }
+
+        void clear(){
+            m_tensors.clear();
+            m_variable_indices.clear();
+            m_factor_offsets.assign(1, 0);
+            m_tensor_ids.clear();
+        }
+
+    private:
+        std::vector<unique_tensor_ptr> m_tensors;
+        // CSR layout of the variable indices of the factors
+        std::vector<std::size_t> m_variable_indices;
+        std::vector<std::size_t> m_factor_offsets;
+        std::vector<std::size_t> m_tensor_ids;
+    };
+
+
+    // merge several builder shards into gm with a single allocation.
+    // The shards are appended in order, therefore the resulting
+    // factor order is deterministic no matter which thread filled which shard.
+    template<class SPACE, class T, class BUILDERS>
+    void merge_builders(GraphicalModel<SPACE, T> & gm, BUILDERS & builders){
+        auto num_factors = gm.num_factors();
+        auto num_index_entries = gm.num_index_entries();
+        auto num_tensors = gm.num_tensors();
+        for(auto && builder : builders){
+            num_factors += builder.num_factors();
+            num_index_entries += builder.num_index_entries();
+            num_tensors += builder.num_tensors();
+        }
+        gm.reserve(num_factors, num_index_entries, num_tensors);
+        for(auto && builder : builders){
+            builder.append_to(gm);
+        }
+    }
+
+}
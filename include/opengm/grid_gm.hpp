@@ -0,0 +1,784 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <variant>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/container/small_vector.hpp>
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "opengm/opengm_config.hpp"
+#include "opengm/space.hpp"
+#include "opengm/gm_base.hpp"
+#include "opengm/factor_base.hpp"
+#include "opengm/factors_of_variables.hpp"
+#include "opengm/tensors.hpp"
+
+namespace opengm{
+
+
+    // the kind of pairwise function shared by all
+    // edges of a GridGm. The edges only differ in their weight
+    enum class GridPairwiseKind{
+        potts,
+        l1,
+        truncated_l1
+    };
+
+
+    template<class T, std::size_t DIM>
+    class GridGm;
+
+    template<class T>
+    class GridFactor;
+
+    template<class T, std::size_t DIM>
+    class GmTraits<GridGm<T, DIM>>{
+    public:
+        using space_type = UniformSpace<std::size_t>;
+        using label_type = typename SpaceTraits<space_type>::label_type;
+        using value_type = T;
+    };
+
+    template<class T>
+    class FactorTraits<GridFactor<T>>{
+    public:
+        using value_type = T;
+        using label_type = std::size_t;
+    };
+
+
+namespace detail{
+
+    constexpr std::size_t grid_num_neighbours(const std::size_t dim){
+        std::size_t n = 1;
+        for(std::size_t d=0; d<dim; ++d){
+            n *= 3;
+        }
+        return n - 1;
+    }
+
+    // the variables of a grid factor (one or two),
+    // returned by value st. they outlive the factor proxy
+    class GridFactorVariables{
+    public:
+        GridFactorVariables(const std::size_t v0)
+        :   m_variables{v0, v0},
+            m_size(1){
+        }
+        GridFactorVariables(const std::size_t v0, const std::size_t v1)
+        :   m_variables{v0, v1},
+            m_size(2){
+        }
+        std::size_t size()const{
+            return m_size;
+        }
+        std::size_t operator[](const std::size_t i)const{
+            return m_variables[i];
+        }
+        auto begin()const{
+            return m_variables.begin();
+        }
+        auto end()const{
+            return m_variables.begin() + m_size;
+        }
+    private:
+        std::array<std::size_t, 2> m_variables;
+        std::size_t m_size;
+    };
+
+    struct GridPottsFunction{
+        template<class T>
+        T operator()(const std::size_t l0, const std::size_t l1, const T weight, const T)const{
+            return l0 == l1 ? T(0) : weight;
+        }
+    };
+
+    struct GridL1Function{
+        template<class T>
+        T operator()(const std::size_t l0, const std::size_t l1, const T weight, const T)const{
+            return weight * T(abs_diff(l0, l1));
+        }
+    };
+
+    struct GridTruncatedL1Function{
+        template<class T>
+        T operator()(const std::size_t l0, const std::size_t l1, const T weight, const T truncation)const{
+            return weight * std::min(T(abs_diff(l0, l1)), truncation);
+        }
+    };
+}
+
+
+    // factor proxy of a GridGm, created on the fly by GridGm::operator[].
+    // The factor owns a lightweight tensor by value, therefore
+    // tensor() is only valid as long as the factor is alive and the
+    // pointer identifies no tensor of the model: factors sharing values
+    // do not share a tensor and the address of a destroyed proxy is
+    // reused by the next one. Code deduplicating tensors by address
+    // must check that gm[fi] returns a reference.
+    template<class T>
+    class GridFactor : public FactorBase<GridFactor<T>>{
+    public:
+        using base_type = FactorBase<GridFactor<T>>;
+        using base_type::operator();
+        using base_type::operator[];
+        using label_type = std::size_t;
+        using value_type = T;
+        using variables_type = detail::GridFactorVariables;
+        using tensor_variant_type = std::variant<
+            UnaryViewTensor<T>,
+            Potts2Tensor<T>,
+            L1Tensor<T>,
+            TruncatedL1Tensor<T>
+        >;
+
+        GridFactor(const std::size_t vi, const value_type * values, const label_type num_labels)
+        :   m_variables(vi),
+            m_tensor(std::in_place_type<UnaryViewTensor<T>>, values, num_labels){
+        }
+
+        template<class TENSOR>
+        GridFactor(const std::size_t v0, const std::size_t v1, TENSOR && tensor)
+        :   m_variables(v0, v1),
+            m_tensor(std::forward<TENSOR>(tensor)){
+        }
+
+        variables_type variables()const{
+            return m_variables;
+        }
+        std::size_t arity()const{
+            return m_variables.size();
+        }
+        std::size_t shape(const std::size_t i)const{
+            return this->tensor()->shape(i);
+        }
+
+        // the members below dispatch on the variant with a qualified call
+        // st. no virtual call is needed
+        value_type operator[](const label_type * labels)const{
+            return std::visit([&](auto && tensor){
+                using tensor_t = std::decay_t<decltype(tensor)>;
+                return tensor.tensor_t::operator[](labels);
+            }, m_tensor);
+        }
+        void add_values(value_type * out)const{
+            std::visit([&](auto && tensor){
+                using tensor_t = std::decay_t<decltype(tensor)>;
+                tensor.tensor_t::add_values(out);
+            }, m_tensor);
+        }
+        void batch_add_values(
+            const label_type * labels,
+            const std::size_t num_labelings,
+            value_type * out
+        )const{
+            std::visit([&](auto && tensor){
+                using tensor_t = std::decay_t<decltype(tensor)>;
+                tensor.tensor_t::batch_add_values(labels, num_labelings, out);
+            }, m_tensor);
+        }
+        void factor_to_variable_messages(
+            const value_type ** in_messages,
+            value_type ** out_messages
+        )const{
+            std::visit([&](auto && tensor){
+                using tensor_t = std::decay_t<decltype(tensor)>;
+                tensor.tensor_t::factor_to_variable_messages(in_messages, out_messages);
+            }, m_tensor);
+        }
+
+        const TensorBase<T> * tensor() const{
+            return std::visit([](auto && tensor) -> const TensorBase<T> *{
+                return &tensor;
+            }, m_tensor);
+        }
+
+    private:
+        variables_type m_variables;
+        tensor_variant_type m_tensor;
+    };
+
+
+
+    // Graphical model on a 2D / 3D grid with implicit topology.
+    //
+    // Factors [0, num_variables) are the unaries, stored as dense
+    // (num_variables x num_labels) block. The remaining factors are
+    // the edges, grouped in one layer per forward offset of the
+    // neighbourhood. All edges share one pairwise kind and only differ
+    // in their weight, stored in one flat array.
+    // No variable indices are stored: factors are proxies
+    // created on the fly. evaluate, Icm (conditional_energies) and
+    // BeliefPropergation (for_each_pairwise_tensor) bypass the proxies.
+    template<class T, std::size_t DIM>
+    class GridGm : public GmBase<GridGm<T, DIM>>{
+    public:
+        static_assert(DIM == 2 || DIM == 3, "GridGm is only implemented for 2D and 3D grids");
+
+        using base_type = GmBase<GridGm<T, DIM>>;
+        using value_type = T;
+        using label_type = std::size_t;
+        using space_type = UniformSpace<label_type>;
+        using labels_vector_type = typename base_type::labels_vector_type;
+        using factor_type = GridFactor<T>;
+        using shape_type = std::array<std::size_t, DIM>;
+        using offset_type = std::array<std::ptrdiff_t, DIM>;
+
+        static constexpr std::size_t max_num_neighbours = detail::grid_num_neighbours(DIM);
+
+        using base_type::evaluate;
+
+        class const_iterator{
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = factor_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = factor_type;
+
+            const_iterator(const GridGm * gm = nullptr, const std::size_t fi = 0)
+            :   m_gm(gm),
+                m_fi(fi){
+            }
+            reference operator*()const{
+                return (*m_gm)[m_fi];
+            }
+            reference operator[](const difference_type i)const{
+                return (*m_gm)[m_fi + i];
+            }
+            const_iterator & operator++(){
+                ++m_fi;
+                return *this;
+            }
+            const_iterator operator++(int){
+                auto ret = *this;
+                ++m_fi;
+                return ret;
+            }
+            const_iterator & operator--(){
+                --m_fi;
+                return *this;
+            }
+            const_iterator & operator+=(const difference_type n){
+                m_fi += n;
+                return *this;
+            }
+            const_iterator operator+(const difference_type n)const{
+                return const_iterator(m_gm, m_fi + n);
+            }
+            difference_type operator-(const const_iterator & other)const{
+                return difference_type(m_fi) - difference_type(other.m_fi);
+            }
+            bool operator==(const const_iterator & other)const{
+                return m_fi == other.m_fi;
+            }
+            bool operator!=(const const_iterator & other)const{
+                return m_fi != other.m_fi;
+            }
+            bool operator<(const const_iterator & other)const{
+                return m_fi < other.m_fi;
+            }
+        private:
+            const GridGm * m_gm;
+            std::size_t m_fi;
+        };
+
+        // neighbourhood must be 4 or 8 in 2D and 6 or 26 in 3D
+        GridGm(
+            const shape_type & shape,
+            const label_type num_labels,
+            const std::size_t neighbourhood = 2 * DIM,
+            const GridPairwiseKind pairwise_kind = GridPairwiseKind::potts,
+            const value_type truncation = value_type(1)
+        )
+        :   m_shape(shape),
+            m_strides(),
+            m_space(),
+            m_pairwise_kind(pairwise_kind),
+            m_truncation(truncation),
+            m_layers(),
+            m_unaries(),
+            m_weights()
+        {
+            if(neighbourhood != 2 * DIM && neighbourhood != max_num_neighbours)
+            {
+                throw std::runtime_error("neighbourhood must be 2*DIM or 3^DIM-1");
+            }
+
+            std::size_t num_variables = 1;
+            for(std::size_t d=DIM; d-- > 0;){
+                m_strides[d] = num_variables;
+                num_variables *= m_shape[d];
+            }
+            m_space = space_type(num_variables, num_labels);
+
+            // forward offsets: the first non-zero entry is positive
+            // st. each edge is represented exactly once
+            offset_type offset;
+            std::fill(offset.begin(), offset.end(), -1);
+            for(;;){
+                std::size_t num_nonzero = 0;
+                std::ptrdiff_t first_nonzero = 0;
+                for(auto o : offset){
+                    if(o != 0){
+                        first_nonzero = num_nonzero == 0 ? o : first_nonzero;
+                        ++num_nonzero;
+                    }
+                }
+                if(first_nonzero > 0 && (neighbourhood == max_num_neighbours || num_nonzero == 1)){
+                    this->add_layer(offset);
+                }
+                // next offset in {-1,0,1}^DIM
+                std::size_t d = DIM;
+                while(d > 0 && offset[d-1] == 1){
+                    offset[d-1] = -1;
+                    --d;
+                }
+                if(d == 0){
+                    break;
+                }
+                ++offset[d-1];
+            }
+
+            m_unaries.resize(num_variables * num_labels, value_type(0));
+            m_weights.resize(this->num_edges(), value_type(1));
+        }
+
+        const auto & space()const{
+            return m_space;
+        }
+        const shape_type & shape()const{
+            return m_shape;
+        }
+        GridPairwiseKind pairwise_kind()const{
+            return m_pairwise_kind;
+        }
+        value_type truncation()const{
+            return m_truncation;
+        }
+
+        std::size_t num_edges()const{
+            return m_layers.empty() ? 0 : m_layers.back().begin + m_layers.back().size;
+        }
+        std::size_t num_factors()const{
+            return this->num_variables() + this->num_edges();
+        }
+        std::size_t max_arity()const{
+            return this->num_edges() > 0 ? 2 : 1;
+        }
+
+        // number of forward offsets / edge layers
+        std::size_t num_offsets()const{
+            return m_layers.size();
+        }
+        const offset_type & offset(const std::size_t k)const{
+            return m_layers[k].offset;
+        }
+
+        // dense (num_variables x num_labels) unary block
+        gsl::span<value_type> unaries(){
+            return gsl::span<value_type>(m_unaries.data(), m_unaries.size());
+        }
+        gsl::span<const value_type> unaries()const{
+            return gsl::span<const value_type>(m_unaries.data(), m_unaries.size());
+        }
+        gsl::span<value_type> unaries(const std::size_t vi){
+            const auto nl = m_space.max_num_labels();
+            return gsl::span<value_type>(m_unaries.data() + vi * nl, nl);
+        }
+        gsl::span<const value_type> unaries(const std::size_t vi)const{
+            const auto nl = m_space.max_num_labels();
+            return gsl::span<const value_type>(m_unaries.data() + vi * nl, nl);
+        }
+
+        // the unary block in the format solvers detect, see DenseUnaries
+        DenseUnaries<value_type> dense_unaries()const{
+            return DenseUnaries<value_type>{m_unaries.data(), m_space.max_num_labels(), 0, this->num_variables()};
+        }
+
+        // weights of all edges, ordered by edge index
+        gsl::span<value_type> weights(){
+            return gsl::span<value_type>(m_weights.data(), m_weights.size());
+        }
+        gsl::span<const value_type> weights()const{
+            return gsl::span<const value_type>(m_weights.data(), m_weights.size());
+        }
+        // weights of the edges of a single layer
+        gsl::span<value_type> layer_weights(const std::size_t k){
+            return gsl::span<value_type>(m_weights.data() + m_layers[k].begin, m_layers[k].size);
+        }
+        gsl::span<const value_type> layer_weights(const std::size_t k)const{
+            return gsl::span<const value_type>(m_weights.data() + m_layers[k].begin, m_layers[k].size);
+        }
+
+        // the topology is implicit, only the unaries,
+        // the edge weights and the edge layers are stored
+        MemoryStats memory_stats()const{
+            MemoryStats stats;
+            stats.tensors["GridUnaries"] = detail::heap_bytes(m_unaries);
+            stats.tensors["GridWeights"] = detail::heap_bytes(m_weights);
+            stats.factors = detail::heap_bytes(m_layers);
+            stats.space = m_space.memory_usage();
+            return stats;
+        }
+
+        // the two variables of edge e
+        std::pair<std::size_t, std::size_t> edge(const std::size_t e)const{
+            const auto & layer = m_layers[this->layer_of_edge(e)];
+            auto local = e - layer.begin;
+            std::size_t v0 = 0;
+            for(std::size_t d=DIM; d-- > 0;){
+                v0 += (layer.lo[d] + local % layer.extent[d]) * m_strides[d];
+                local /= layer.extent[d];
+            }
+            return std::make_pair(v0, std::size_t(std::ptrdiff_t(v0) + layer.delta));
+        }
+
+        factor_type operator[](const std::size_t fi)const{
+            const auto num_variables = this->num_variables();
+            const auto num_labels = m_space.max_num_labels();
+            if(fi < num_variables){
+                return factor_type(fi, m_unaries.data() + fi * num_labels, num_labels);
+            }
+            const auto e = fi - num_variables;
+            const auto [v0, v1] = this->edge(e);
+            const auto w = m_weights[e];
+            switch(m_pairwise_kind){
+                case GridPairwiseKind::potts:
+                    return factor_type(v0, v1, Potts2Tensor<value_type>(num_labels, w));
+                case GridPairwiseKind::l1:
+                    return factor_type(v0, v1, L1Tensor<value_type>(num_labels, w));
+                default:
+                    return factor_type(v0, v1, TruncatedL1Tensor<value_type>(num_labels, w, m_truncation));
+            }
+        }
+
+        // unaries are the factors [0, num_variables),
+        // the edges the factors [num_variables, num_factors)
+        template<std::size_t ARITY, class F>
+        void for_each_factor_of_arity(F && f)const{
+            if constexpr(ARITY == 1){
+                this->for_each_factor_in_range(0, this->num_variables(), f);
+            }
+            else if constexpr(ARITY == 2){
+                this->for_each_factor_in_range(this->num_variables(), this->num_factors(), f);
+            }
+        }
+        template<std::size_t MIN_ARITY, class F>
+        void for_each_factor_of_min_arity(F && f)const{
+            if constexpr(MIN_ARITY <= 2){
+                this->for_each_factor_in_range(MIN_ARITY <= 1 ? 0 : this->num_variables(), this->num_factors(), f);
+            }
+        }
+
+        const_iterator begin()const{
+            return const_iterator(this, 0);
+        }
+        const_iterator end()const{
+            return const_iterator(this, this->num_factors());
+        }
+        const_iterator cbegin()const{
+            return this->begin();
+        }
+        const_iterator cend()const{
+            return this->end();
+        }
+
+        // fast path: stream over the unary block and
+        // the edge layers row by row
+        template<class ITER>
+        value_type evaluate(ITER labels_begin, ITER)const{
+            const auto num_labels = m_space.max_num_labels();
+            auto energy = value_type(0);
+            for(std::size_t vi=0; vi<this->num_variables(); ++vi){
+                energy += m_unaries[vi * num_labels + labels_begin[vi]];
+            }
+            this->with_pairwise_function([&](auto && pairwise_function){
+                for(std::size_t k=0; k<m_layers.size(); ++k){
+                    const auto delta = m_layers[k].delta;
+                    this->for_each_edge_row(k, [&](const std::size_t v_begin, const std::size_t e_begin, const std::size_t row_size){
+                        for(std::size_t i=0; i<row_size; ++i){
+                            const auto v0 = v_begin + i;
+                            energy += pairwise_function(
+                                labels_begin[v0], labels_begin[std::ptrdiff_t(v0) + delta],
+                                m_weights[e_begin + i], m_truncation
+                            );
+                        }
+                    });
+                }
+            });
+            return energy;
+        }
+
+        // fast path for Icm: energies of all factors of vi for all
+        // labels of vi, while all other variables are fixed to labels
+        template<class LABELS>
+        void conditional_energies(const std::size_t vi, const LABELS & labels, value_type * out)const{
+            const auto num_labels = m_space.max_num_labels();
+            std::copy(m_unaries.data() + vi * num_labels, m_unaries.data() + (vi + 1) * num_labels, out);
+            this->with_pairwise_function([&](auto && pairwise_function){
+                this->for_each_neighbour(vi, [&](const std::size_t other_vi, const std::size_t e){
+                    const auto other_label = labels[other_vi];
+                    const auto w = m_weights[e];
+                    for(label_type l=0; l<num_labels; ++l){
+                        out[l] += pairwise_function(l, other_label, w, m_truncation);
+                    }
+                });
+            });
+        }
+
+        // fast path for BeliefPropergation: f(fi, tensor) for the edge
+        // factors fi = num_variables + e, e in [e_begin, e_end), where
+        // tensor is a lightweight tensor of the pairwise kind built
+        // from the weight of e. The weights are streamed in layer
+        // order and the variables of the edges are never decoded
+        template<class F>
+        void for_each_pairwise_tensor(const std::size_t e_begin, const std::size_t e_end, F && f)const{
+            const auto num_labels = m_space.max_num_labels();
+            const auto fi_offset = this->num_variables();
+            auto stream_weights = [&](auto && make_tensor){
+                for(auto e=e_begin; e<e_end; ++e){
+                    f(fi_offset + e, make_tensor(m_weights[e]));
+                }
+            };
+            switch(m_pairwise_kind){
+                case GridPairwiseKind::potts:
+                    stream_weights([&](const value_type w){
+                        return Potts2Tensor<value_type>(num_labels, w);
+                    });
+                    break;
+                case GridPairwiseKind::l1:
+                    stream_weights([&](const value_type w){
+                        return L1Tensor<value_type>(num_labels, w);
+                    });
+                    break;
+                default:
+                    stream_weights([&](const value_type w){
+                        return TruncatedL1Tensor<value_type>(num_labels, w, m_truncation);
+                    });
+            }
+        }
+
+        // call f(other_vi, e) for all neighbours of vi
+        // where e is the index of the connecting edge
+        template<class F>
+        void for_each_neighbour(const std::size_t vi, F && f)const{
+            std::array<std::ptrdiff_t, DIM> coordinate;
+            auto rest = vi;
+            for(std::size_t d=0; d<DIM; ++d){
+                coordinate[d] = std::ptrdiff_t(rest / m_strides[d]);
+                rest %= m_strides[d];
+            }
+            for(auto && layer : m_layers){
+                // vi as first variable of the edge
+                std::size_t local_e;
+                if(this->in_layer(layer, coordinate, 0, local_e)){
+                    f(std::size_t(std::ptrdiff_t(vi) + layer.delta), layer.begin + local_e);
+                }
+                // vi as second variable of the edge
+                if(this->in_layer(layer, coordinate, -1, local_e)){
+                    f(std::size_t(std::ptrdiff_t(vi) - layer.delta), layer.begin + local_e);
+                }
+            }
+        }
+
+        // iterate over the edges of layer k in contiguous runs:
+        // f(v_begin, e_begin, size) where the edges
+        // [e_begin, e_begin+size) connect v_begin+i and v_begin+i+delta
+        template<class F>
+        void for_each_edge_row(const std::size_t k, F && f)const{
+            const auto & layer = m_layers[k];
+            if(layer.size == 0){
+                return;
+            }
+            const auto row_size = layer.extent[DIM-1];
+            const auto num_rows = layer.size / row_size;
+            std::array<std::size_t, DIM> coordinate = layer.lo;
+            for(std::size_t r=0; r<num_rows; ++r){
+                std::size_t v_begin = 0;
+                for(std::size_t d=0; d<DIM; ++d){
+                    v_begin += coordinate[d] * m_strides[d];
+                }
+                f(v_begin, layer.begin + r * row_size, row_size);
+
+                // next row
+                for(std::size_t d=DIM-1; d-- > 0;){
+                    if(++coordinate[d] < layer.lo[d] + layer.extent[d]){
+                        break;
+                    }
+                    coordinate[d] = layer.lo[d];
+                }
+            }
+        }
+
+    private:
+
+        template<class F>
+        void for_each_factor_in_range(const std::size_t begin, const std::size_t end, F && f)const{
+            for(auto fi=begin; fi<end; ++fi){
+                f(fi, (*this)[fi]);
+            }
+        }
+
+        struct Layer{
+            offset_type offset;
+            // linear index difference between the two variables of an edge
+            std::ptrdiff_t delta;
+            // box of the first variables of the edges
+            shape_type lo;
+            shape_type extent;
+            // edge index range
+            std::size_t begin;
+            std::size_t size;
+        };
+
+        void add_layer(const offset_type & offset){
+            Layer layer;
+            layer.offset = offset;
+            layer.delta = 0;
+            layer.size = 1;
+            layer.begin = this->num_edges();
+            for(std::size_t d=0; d<DIM; ++d){
+                const auto lo = std::max(std::ptrdiff_t(0), -offset[d]);
+                const auto hi = std::ptrdiff_t(m_shape[d]) - std::max(std::ptrdiff_t(0), offset[d]);
+                layer.lo[d] = std::size_t(lo);
+                layer.extent[d] = hi > lo ? std::size_t(hi - lo) : 0;
+                layer.delta += offset[d] * std::ptrdiff_t(m_strides[d]);
+                layer.size *= layer.extent[d];
+            }
+            m_layers.push_back(layer);
+        }
+
+        // the layers differ in size, the layer of e
+        // is found by bisection of the layer ends
+        std::size_t layer_of_edge(const std::size_t e)const{
+            const auto layer = std::upper_bound(m_layers.begin(), m_layers.end(), e, [](const std::size_t e, const Layer & layer){
+                return e < layer.begin + layer.size;
+            });
+            return std::size_t(std::distance(m_layers.begin(), layer));
+        }
+
+        // check if coordinate + sign*offset is the first variable of an
+        // edge of layer and compute the local edge index
+        bool in_layer(
+            const Layer & layer,
+            const std::array<std::ptrdiff_t, DIM> & coordinate,
+            const std::ptrdiff_t sign,
+            std::size_t & local_e
+        )const{
+            local_e = 0;
+            for(std::size_t d=0; d<DIM; ++d){
+                const auto c = coordinate[d] + sign * layer.offset[d] - std::ptrdiff_t(layer.lo[d]);
+                if(c < 0 || c >= std::ptrdiff_t(layer.extent[d])){
+                    return false;
+                }
+                local_e = local_e * layer.extent[d] + std::size_t(c);
+            }
+            return true;
+        }
+
+        template<class F>
+        void with_pairwise_function(F && f)const{
+            switch(m_pairwise_kind){
+                case GridPairwiseKind::potts:
+                    f(detail::GridPottsFunction());
+                    break;
+                case GridPairwiseKind::l1:
+                    f(detail::GridL1Function());
+                    break;
+                default:
+                    f(detail::GridTruncatedL1Function());
+            }
+        }
+
+        shape_type m_shape;
+        shape_type m_strides;
+        space_type m_space;
+        GridPairwiseKind m_pairwise_kind;
+        value_type m_truncation;
+        std::vector<Layer> m_layers;
+        std::vector<value_type> m_unaries;
+        std::vector<value_type> m_weights;
+    };
+
+
+
+    // implicit factors of variables of a grid: nothing is stored
+    template<class T, std::size_t DIM>
+    class FactorsOfVariables<GridGm<T, DIM>>{
+    public:
+        using gm_type = GridGm<T, DIM>;
+        using value_type = boost::container::small_vector<std::size_t, gm_type::max_num_neighbours + 1>;
+
+        FactorsOfVariables(const gm_type & gm)
+        :   m_gm(gm){
+        }
+        value_type operator[](const std::size_t vi)const{
+            value_type factors;
+            factors.push_back(vi);
+            m_gm.for_each_neighbour(vi, [&](auto, const std::size_t e){
+                factors.push_back(m_gm.num_variables() + e);
+            });
+            std::sort(factors.begin() + 1, factors.end());
+            return factors;
+        }
+        std::size_t size()const{
+            return m_gm.num_variables();
+        }
+        std::size_t memory_usage()const{
+            return 0;
+        }
+    private:
+        const gm_type & m_gm;
+    };
+
+
+namespace detail{
+    template<std::size_t N>
+    struct GridHigherOrderAndUnaryFactorsOfVariablesValueType{
+        using factors_type = boost::container::small_vector<std::size_t, N>;
+        // the entries are computed on the fly, operator[] returns them
+        // by value: bind the entry to a named local before taking
+        // unaries() / higher_order() of it
+        const auto & unaries()const &{return m_unaries;}
+        const auto & higher_order()const &{return m_higher_order;}
+        void unaries()const && = delete;
+        void higher_order()const && = delete;
+        boost::container::small_vector<std::size_t, 1> m_unaries;
+        factors_type m_higher_order;
+    };
+}
+
+    template<class T, std::size_t DIM>
+    class HigherOrderAndUnaryFactorsOfVariables<GridGm<T, DIM>>{
+    public:
+        using gm_type = GridGm<T, DIM>;
+        using value_type = detail::GridHigherOrderAndUnaryFactorsOfVariablesValueType<gm_type::max_num_neighbours>;
+
+        HigherOrderAndUnaryFactorsOfVariables(const gm_type & gm)
+        :   m_gm(gm){
+        }
+        value_type operator[](const std::size_t vi)const{
+            value_type factors;
+            factors.m_unaries.push_back(vi);
+            m_gm.for_each_neighbour(vi, [&](auto, const std::size_t e){
+                factors.m_higher_order.push_back(m_gm.num_variables() + e);
+            });
+            std::sort(factors.m_higher_order.begin(), factors.m_higher_order.end());
+            return factors;
+        }
+        std::size_t size()const{
+            return m_gm.num_variables();
+        }
+        std::size_t memory_usage()const{
+            return 0;
+        }
+    private:
+        const gm_type & m_gm;
+    };
+
+}
@@ -0,0 +1,397 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <fstream>
+#include <type_traits>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "opengm/tensors.hpp"
+
+namespace opengm{
+namespace io{
+
+
+    // Binary model format, version 1.
+    //
+    // All integers are little endian uint64 unless noted otherwise,
+    // the values are stored with the value_type of the writer
+    // (value_size bytes). Each section starts at a multiple of
+    // binary_model_alignment bytes st. it can be used in place
+    // from a memory mapping. Readers only rely on the section offsets
+    // in the header, write_binary_model writes the sections in the
+    // order below, BinaryModelStreamWriter puts the tensor pool first:
+    //
+    //  header          BinaryModelHeader
+    //  space           num_variables x number of labels
+    //  factor offsets  (num_factors + 1) x offset into the indices (CSR)
+    //  indices         num_index_entries x variable index
+    //  factor tensors  num_factors x tensor id
+    //  tensor table    num_tensors x BinaryTensorRecord
+    //  tensor pool     shape (arity x uint64) followed by the c-order
+    //                  values of each explicit tensor, 8 byte aligned
+    constexpr std::array<char, 8> binary_model_magic{{'O', 'P', 'E', 'N', 'G', 'M', 'B', '\0'}};
+    constexpr std::uint32_t binary_model_version = 1;
+    constexpr std::size_t binary_model_alignment = 64;
+
+    enum class BinaryTensorKind : std::uint32_t{
+        // values in the tensor pool
+        explicit_values = 0,
+        // analytic tensors, parameters = {beta, truncation}
+        potts2 = 1,
+        l1 = 2,
+        truncated_l1 = 3
+    };
+
+    struct BinaryTensorRecord{
+        std::uint32_t kind;
+        std::uint32_t arity;
+        // explicit: byte offset of the shape in the tensor pool
+        std::uint64_t offset;
+        // analytic: number of labels of each variable
+        std::uint64_t num_labels;
+        double parameters[2];
+    };
+    static_assert(sizeof(BinaryTensorRecord) == 40, "unexpected padding of BinaryTensorRecord");
+
+    struct BinaryModelHeader{
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t value_size;
+        std::uint64_t num_variables;
+        std::uint64_t num_factors;
+        std::uint64_t num_index_entries;
+        std::uint64_t num_tensors;
+        std::uint64_t max_num_labels;
+        std::uint64_t max_arity;
+        // byte offsets of the sections from the begin of the file
+        std::uint64_t space_offset;
+        std::uint64_t factor_offsets_offset;
+        std::uint64_t indices_offset;
+        std::uint64_t factor_tensors_offset;
+        std::uint64_t tensor_table_offset;
+        std::uint64_t tensor_pool_offset;
+        std::uint64_t tensor_pool_size;
+        std::uint64_t file_size;
+    };
+    static_assert(sizeof(BinaryModelHeader) == 128, "unexpected padding of BinaryModelHeader");
+    static_assert(sizeof(std::size_t) == sizeof(std::uint64_t), "the binary model format needs 64 bit std::size_t");
+
+    inline bool is_little_endian(){
+        const std::uint32_t one = 1;
+        char first;
+        std::memcpy(&first, &one, 1);
+        return first == 1;
+    }
+
+    inline std::uint64_t align_up(const std::uint64_t offset, const std::uint64_t alignment){
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    [[noreturn]] inline void throw_corrupted_binary_model(){
+        throw std::runtime_error("binary model is truncated or corrupted");
+    }
+
+    // throws if the header does not describe a valid
+    // model with values of value_size bytes in a file of file_size bytes.
+    // The section sizes are compared by division st. huge counts
+    // cannot overflow. The contents of the sections are checked
+    // per factor on access (see MmapGm)
+    inline void check_binary_model_header(const BinaryModelHeader & header, const std::size_t value_size, const std::size_t file_size){
+        if(!is_little_endian()){
+            throw std::runtime_error("the binary model format is only supported on little endian hosts");
+        }
+        if(header.magic != binary_model_magic){
+            throw std::runtime_error("not a binary opengm model");
+        }
+        if(header.version != binary_model_version){
+            throw std::runtime_error("unsupported binary model version " + std::to_string(header.version));
+        }
+        if(header.value_size != value_size){
+            throw std::runtime_error("binary model stores values with " + std::to_string(header.value_size) +
+                " bytes, expected " + std::to_string(value_size));
+        }
+        // count elements of element_size bytes starting at offset
+        auto check_section = [&](const std::uint64_t offset, const std::uint64_t count, const std::uint64_t element_size){
+            if(offset % 8 != 0 || offset > file_size || count > (file_size - offset) / element_size){
+                throw_corrupted_binary_model();
+            }
+        };
+        if(header.num_factors == std::numeric_limits<std::uint64_t>::max()){
+            throw_corrupted_binary_model();
+        }
+        check_section(header.space_offset, header.num_variables, 8);
+        check_section(header.factor_offsets_offset, header.num_factors + 1, 8);
+        check_section(header.indices_offset, header.num_index_entries, 8);
+        check_section(header.factor_tensors_offset, header.num_factors, 8);
+        check_section(header.tensor_table_offset, header.num_tensors, sizeof(BinaryTensorRecord));
+        check_section(header.tensor_pool_offset, header.tensor_pool_size, 1);
+        if(header.file_size != file_size){
+            throw_corrupted_binary_model();
+        }
+    }
+
+
+    // buffered sequential writer which keeps track of the
+    // position st. sections can be aligned
+    class BinarySectionWriter{
+    public:
+        explicit BinarySectionWriter(const std::string & path, const std::size_t buffer_size = 1 << 20)
+        :   m_out(path, std::ios::binary | std::ios::trunc),
+            m_buffer(),
+            m_position(0)
+        {
+            if(!m_out){
+                throw std::runtime_error("cannot open " + path + " for writing");
+            }
+            m_buffer.reserve(buffer_size);
+        }
+
+        ~BinarySectionWriter(){
+            // errors are only reported by an explicit close
+            if(m_out.is_open()){
+                try{
+                    this->flush();
+                }
+                catch(...){
+                }
+            }
+        }
+
+        std::uint64_t position()const{
+            return m_position;
+        }
+
+        void write(const void * data, const std::size_t size){
+            const auto bytes = static_cast<const char *>(data);
+            if(m_buffer.size() + size > m_buffer.capacity()){
+                this->flush();
+                if(size > m_buffer.capacity()){
+                    m_out.write(bytes, size);
+                    m_position += size;
+                    return;
+                }
+            }
+            m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+            m_position += size;
+        }
+
+        template<class V>
+        void write_value(const V & value){
+            static_assert(std::is_trivially_copyable<V>::value, "only trivially copyable values can be written");
+            this->write(&value, sizeof(V));
+        }
+
+        // pad with zeros to a multiple of alignment
+        void align(const std::size_t alignment = binary_model_alignment){
+            static const std::array<char, binary_model_alignment> zeros{};
+            auto padding = align_up(m_position, alignment) - m_position;
+            while(padding > 0){
+                const auto n = std::min<std::uint64_t>(padding, zeros.size());
+                this->write(zeros.data(), n);
+                padding -= n;
+            }
+        }
+
+        // overwrite already written bytes, e.g. the header
+        void write_at(const std::uint64_t position, const void * data, const std::size_t size){
+            this->flush();
+            m_out.seekp(std::streamoff(position));
+            m_out.write(static_cast<const char *>(data), size);
+            m_out.seekp(std::streamoff(m_position));
+        }
+
+        void flush(){
+            if(!m_buffer.empty()){
+                m_out.write(m_buffer.data(), m_buffer.size());
+                m_buffer.clear();
+            }
+            if(!m_out){
+                throw std::runtime_error("writing the binary model failed");
+            }
+        }
+
+        void close(){
+            this->flush();
+            m_out.close();
+            if(!m_out){
+                throw std::runtime_error("writing the binary model failed");
+            }
+        }
+
+    private:
+        std::ofstream m_out;
+        std::vector<char> m_buffer;
+        std::uint64_t m_position;
+    };
+
+
+namespace detail{
+
+    // the record of tensor, explicit tensors get the pool
+    // offset pool_size which is advanced by their size
+    template<class T>
+    BinaryTensorRecord binary_tensor_record(const TensorBase<T> * tensor, std::uint64_t & pool_size){
+        BinaryTensorRecord record{};
+        record.arity = std::uint32_t(tensor->arity());
+        if(auto potts = dynamic_cast<const Potts2Tensor<T> *>(tensor)){
+            record.kind = std::uint32_t(BinaryTensorKind::potts2);
+            record.num_labels = potts->num_labels();
+            record.parameters[0] = double(potts->beta());
+        }
+        else if(auto l1 = dynamic_cast<const L1Tensor<T> *>(tensor)){
+            record.kind = std::uint32_t(BinaryTensorKind::l1);
+            record.num_labels = l1->num_labels();
+            record.parameters[0] = double(l1->beta());
+        }
+        else if(auto tl1 = dynamic_cast<const TruncatedL1Tensor<T> *>(tensor)){
+            record.kind = std::uint32_t(BinaryTensorKind::truncated_l1);
+            record.num_labels = tl1->num_labels();
+            record.parameters[0] = double(tl1->beta());
+            record.parameters[1] = double(tl1->truncation());
+        }
+        else{
+            record.kind = std::uint32_t(BinaryTensorKind::explicit_values);
+            record.offset = pool_size;
+            std::uint64_t size = 1;
+            for(std::size_t d=0; d<tensor->arity(); ++d){
+                size *= tensor->shape(d);
+            }
+            pool_size += align_up(tensor->arity() * 8 + size * sizeof(T), 8);
+        }
+        return record;
+    }
+
+    // write shape and values of an explicit tensor to the pool
+    template<class T>
+    void write_binary_tensor_values(BinarySectionWriter & writer, const TensorBase<T> * tensor, std::vector<T> & buffer){
+        std::uint64_t size = 1;
+        for(std::size_t d=0; d<tensor->arity(); ++d){
+            const std::uint64_t shape = tensor->shape(d);
+            writer.write_value(shape);
+            size *= shape;
+        }
+        buffer.resize(size);
+        tensor->copy_corder(buffer.data());
+        writer.write(buffer.data(), size * sizeof(T));
+        writer.align(8);
+    }
+}
+
+
+    // write any model to the binary model format.
+    // Tensors shared by several factors are stored once if the
+    // factors of the model are stable references, for models with
+    // factor proxies each factor gets its own tensor.
+    template<class GM>
+    void write_binary_model(const GM & gm, const std::string & path){
+        using value_type = typename GM::value_type;
+        using tensor_type = TensorBase<value_type>;
+        constexpr bool stable_tensors = std::is_reference<decltype(gm[std::size_t(0)])>::value;
+
+        if(!is_little_endian()){
+            throw std::runtime_error("the binary model format is only supported on little endian hosts");
+        }
+
+        const std::uint64_t num_variables = gm.num_variables();
+        const std::uint64_t num_factors = gm.num_factors();
+
+        // tensor ids, each tensor is identified by its first factor
+        std::vector<std::uint64_t> factor_tensors(num_factors);
+        std::vector<std::uint64_t> tensor_first_factor;
+        std::unordered_map<const tensor_type *, std::uint64_t> tensor_ids;
+        std::uint64_t num_index_entries = 0;
+        std::uint64_t max_arity = 0;
+        gm.for_each_factor([&](auto fi, auto && factor){
+            const std::uint64_t arity = factor.variables().size();
+            num_index_entries += arity;
+            max_arity = std::max(max_arity, arity);
+            if(stable_tensors){
+                auto inserted = tensor_ids.emplace(factor.tensor(), tensor_first_factor.size());
+                if(inserted.second){
+                    tensor_first_factor.push_back(fi);
+                }
+                factor_tensors[fi] = inserted.first->second;
+            }
+            else{
+                factor_tensors[fi] = tensor_first_factor.size();
+                tensor_first_factor.push_back(fi);
+            }
+        });
+        const std::uint64_t num_tensors = tensor_first_factor.size();
+
+        std::vector<BinaryTensorRecord> records(num_tensors);
+        std::uint64_t pool_size = 0;
+        for(std::uint64_t ti=0; ti<num_tensors; ++ti){
+            auto && factor = gm[tensor_first_factor[ti]];
+            records[ti] = detail::binary_tensor_record<value_type>(factor.tensor(), pool_size);
+        }
+
+        BinaryModelHeader header{};
+        header.magic = binary_model_magic;
+        header.version = binary_model_version;
+        header.value_size = sizeof(value_type);
+        header.num_variables = num_variables;
+        header.num_factors = num_factors;
+        header.num_index_entries = num_index_entries;
+        header.num_tensors = num_tensors;
+        header.max_num_labels = num_variables > 0 ? gm.space().max_num_labels() : 0;
+        header.max_arity = max_arity;
+
+        BinarySectionWriter writer(path);
+        writer.write_value(header);
+
+        writer.align();
+        header.space_offset = writer.position();
+        for(std::uint64_t vi=0; vi<num_variables; ++vi){
+            writer.write_value(std::uint64_t(gm.num_labels(vi)));
+        }
+
+        writer.align();
+        header.factor_offsets_offset = writer.position();
+        std::uint64_t offset = 0;
+        writer.write_value(offset);
+        for(auto && factor : gm){
+            offset += factor.variables().size();
+            writer.write_value(offset);
+        }
+
+        writer.align();
+        header.indices_offset = writer.position();
+        for(auto && factor : gm){
+            for(auto vi : factor.variables()){
+                writer.write_value(std::uint64_t(vi));
+            }
+        }
+
+        writer.align();
+        header.factor_tensors_offset = writer.position();
+        writer.write(factor_tensors.data(), factor_tensors.size() * 8);
+
+        writer.align();
+        header.tensor_table_offset = writer.position();
+        writer.write(records.data(), records.size() * sizeof(BinaryTensorRecord));
+
+        writer.align();
+        header.tensor_pool_offset = writer.position();
+        header.tensor_pool_size = pool_size;
+        std::vector<value_type> buffer;
+        for(std::uint64_t ti=0; ti<num_tensors; ++ti){
+            if(records[ti].kind == std::uint32_t(BinaryTensorKind::explicit_values)){
+                auto && factor = gm[tensor_first_factor[ti]];
+                detail::write_binary_tensor_values<value_type>(writer, factor.tensor(), buffer);
+            }
+        }
+
+        header.file_size = writer.position();
+        writer.write_at(0, &header, sizeof(header));
+        writer.close();
+    }
+
+}
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <utility>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <initializer_list>
+
+#include "opengm/tensors.hpp"
+#include "opengm/io/binary_model.hpp"
+
+namespace opengm{
+namespace io{
+
+
+    // Writes a model in the binary model format while it is produced.
+    //
+    // Explicit tensors are appended to the tensor pool of the output
+    // file as soon as they are added. The space, the factor indices,
+    // the factor tensor ids and the tensor table are spilled to
+    // temporary files next to the output and appended as sections
+    // by close(). Memory is bounded by the write buffers, the shape
+    // of each tensor and one entry per run of variables with the same
+    // number of labels, st. models larger than the RAM of the producer
+    // can be written. Factors may only use variables and tensors which
+    // have been added before and must match the shape of their tensor.
+    template<class T>
+    class BinaryModelStreamWriter{
+    public:
+        using value_type = T;
+        using tensor_type = TensorBase<T>;
+
+        explicit BinaryModelStreamWriter(const std::string & path, const std::size_t buffer_size = 1 << 20)
+        :   m_path(path),
+            m_header(),
+            m_writer(path, buffer_size),
+            m_space(path + ".space.tmp", buffer_size),
+            m_factor_offsets(path + ".factor_offsets.tmp", buffer_size),
+            m_indices(path + ".indices.tmp", buffer_size),
+            m_factor_tensors(path + ".factor_tensors.tmp", buffer_size),
+            m_tensor_table(path + ".tensor_table.tmp", buffer_size),
+            m_label_runs(),
+            m_tensor_shape_offsets(1, 0),
+            m_tensor_shapes(),
+            m_values_buffer(),
+            m_variables_buffer(),
+            m_closed(false)
+        {
+            if(!is_little_endian()){
+                throw std::runtime_error("the binary model format is only supported on little endian hosts");
+            }
+            m_header.magic = binary_model_magic;
+            m_header.version = binary_model_version;
+            m_header.value_size = sizeof(value_type);
+            m_writer.write_value(m_header);
+            m_writer.align();
+            m_header.tensor_pool_offset = m_writer.position();
+            m_factor_offsets.write_value(std::uint64_t(0));
+        }
+
+        BinaryModelStreamWriter(const BinaryModelStreamWriter &) = delete;
+        BinaryModelStreamWriter & operator=(const BinaryModelStreamWriter &) = delete;
+
+        // like std::ofstream the model is finalized on destruction,
+        // errors are only reported by an explicit close
+        ~BinaryModelStreamWriter(){
+            if(!m_closed){
+                try{
+                    this->close();
+                }
+                catch(...){
+                }
+            }
+        }
+
+        std::size_t num_variables()const{
+            return m_header.num_variables;
+        }
+        std::size_t num_factors()const{
+            return m_header.num_factors;
+        }
+        std::size_t num_tensors()const{
+            return m_header.num_tensors;
+        }
+
+        // add n variables with num_labels labels,
+        // returns the index of the first one
+        std::size_t add_variables(const std::size_t n, const std::size_t num_labels){
+            this->check_open();
+            const auto first = m_header.num_variables;
+            for(std::size_t i=0; i<n; ++i){
+                m_space.write_value(std::uint64_t(num_labels));
+            }
+            if(n > 0 && (m_label_runs.empty() || m_label_runs.back().second != num_labels)){
+                m_label_runs.emplace_back(first, num_labels);
+            }
+            m_header.num_variables += n;
+            m_header.max_num_labels = std::max<std::uint64_t>(m_header.max_num_labels, n > 0 ? num_labels : 0);
+            return first;
+        }
+
+        // add one variable per number of labels in [begin, end)
+        template<class ITER, class = typename std::iterator_traits<ITER>::iterator_category>
+        std::size_t add_variables(ITER num_labels_begin, ITER num_labels_end){
+            const auto first = m_header.num_variables;
+            for(; num_labels_begin != num_labels_end; ++num_labels_begin){
+                this->add_variables(1, *num_labels_begin);
+            }
+            return first;
+        }
+
+        // store the tensor and return its id, explicit
+        // tensors are written to the pool immediately
+        std::size_t add_tensor(const tensor_type & tensor){
+            this->check_open();
+            const auto tid = m_header.num_tensors;
+            const auto record = detail::binary_tensor_record<value_type>(&tensor, m_header.tensor_pool_size);
+            if(record.kind == std::uint32_t(BinaryTensorKind::explicit_values)){
+                detail::write_binary_tensor_values<value_type>(m_writer, &tensor, m_values_buffer);
+            }
+            m_tensor_table.write_value(record);
+            for(std::size_t d=0; d<tensor.arity(); ++d){
+                m_tensor_shapes.push_back(tensor.shape(d));
+            }
+            m_tensor_shape_offsets.push_back(m_tensor_shapes.size());
+            ++m_header.num_tensors;
+            return tid;
+        }
+
+        template<class ITER>
+        std::size_t add_factor(const std::size_t tid, ITER var_begin, ITER var_end){
+            this->check_open();
+            if(tid >= m_header.num_tensors){
+                throw std::runtime_error("tensor id out of range");
+            }
+            // validate the whole factor before anything is
+            // written st. a rejected factor leaves no indices
+            m_variables_buffer.clear();
+            for(; var_begin != var_end; ++var_begin){
+                const std::uint64_t vi = *var_begin;
+                if(vi >= m_header.num_variables){
+                    throw std::runtime_error("variable index out of range");
+                }
+                m_variables_buffer.push_back(vi);
+            }
+            const std::uint64_t arity = m_variables_buffer.size();
+            const auto shape = m_tensor_shapes.data() + m_tensor_shape_offsets[tid];
+            if(arity != m_tensor_shape_offsets[tid + 1] - m_tensor_shape_offsets[tid]){
+                throw std::runtime_error("number of variables does not match the arity of the tensor");
+            }
+            for(std::size_t d=0; d<arity; ++d){
+                if(shape[d] != this->num_labels(m_variables_buffer[d])){
+                    throw std::runtime_error("number of labels does not match the shape of the tensor");
+                }
+            }
+            for(auto vi : m_variables_buffer){
+                m_indices.write_value(vi);
+            }
+            const auto fi = m_header.num_factors;
+            m_header.num_index_entries += arity;
+            m_header.max_arity = std::max(m_header.max_arity, arity);
+            m_factor_offsets.write_value(std::uint64_t(m_header.num_index_entries));
+            m_factor_tensors.write_value(std::uint64_t(tid));
+            ++m_header.num_factors;
+            return fi;
+        }
+
+        template<class VAR_T>
+        std::size_t add_factor(const std::size_t tid, std::initializer_list<VAR_T> vars){
+            return this->add_factor(tid, vars.begin(), vars.end());
+        }
+
+        // write the index sections and the header
+        void close(){
+            this->check_open();
+            m_closed = true;
+            m_header.space_offset = this->append(m_space, "space");
+            m_header.factor_offsets_offset = this->append(m_factor_offsets, "factor_offsets");
+            m_header.indices_offset = this->append(m_indices, "indices");
+            m_header.factor_tensors_offset = this->append(m_factor_tensors, "factor_tensors");
+            m_header.tensor_table_offset = this->append(m_tensor_table, "tensor_table");
+            m_header.file_size = m_writer.position();
+            m_writer.write_at(0, &m_header, sizeof(m_header));
+            m_writer.close();
+        }
+
+    private:
+
+        std::uint64_t num_labels(const std::uint64_t vi)const{
+            // the last run starting at or before vi
+            auto run = std::upper_bound(m_label_runs.begin(), m_label_runs.end(), vi,
+                [](const std::uint64_t v, const auto & r){ return v < r.first; }
+            );
+            return std::prev(run)->second;
+        }
+
+        void check_open()const{
+            if(m_closed){
+                throw std::runtime_error("BinaryModelStreamWriter is already closed");
+            }
+        }
+
+        // append a spilled section to the output
+        // and return its offset
+        std::uint64_t append(BinarySectionWriter & spill, const std::string & name){
+            spill.close();
+            const auto spill_path = m_path + "." + name + ".tmp";
+            m_writer.align();
+            const auto offset = m_writer.position();
+            {
+                // the spill file is kept if anything went wrong
+                std::ifstream in(spill_path, std::ios::binary);
+                if(!in){
+                    throw std::runtime_error("cannot open " + spill_path + " for reading");
+                }
+                std::vector<char> buffer(1 << 20);
+                while(in){
+                    in.read(buffer.data(), buffer.size());
+                    m_writer.write(buffer.data(), std::size_t(in.gcount()));
+                }
+                if(in.bad() || m_writer.position() - offset != spill.position()){
+                    throw std::runtime_error("reading " + spill_path + " failed");
+                }
+                m_writer.flush();
+            }
+            std::remove(spill_path.c_str());
+            return offset;
+        }
+
+        std::string m_path;
+        BinaryModelHeader m_header;
+        BinarySectionWriter m_writer;
+        BinarySectionWriter m_space;
+        BinarySectionWriter m_factor_offsets;
+        BinarySectionWriter m_indices;
+        BinarySectionWriter m_factor_tensors;
+        BinarySectionWriter m_tensor_table;
+        // the only state which grows with the model:
+        // (first variable, number of labels) per run and
+        // the shapes of all tensors, pooled
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> m_label_runs;
+        std::vector<std::uint64_t> m_tensor_shape_offsets;
+        std::vector<std::uint64_t> m_tensor_shapes;
+        std::vector<value_type> m_values_buffer;
+        std::vector<std::uint64_t> m_variables_buffer;
+        bool m_closed;
+    };
+
+}
+}
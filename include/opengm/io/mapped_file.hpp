@@ -0,0 +1,134 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace opengm{
+namespace io{
+
+
+    // RAII wrapper of a posix memory mapping of a whole file.
+    // Read only mappings are shared between all processes
+    // which map the same file via the page cache.
+    class MappedFile{
+    public:
+        enum class Mode{
+            read_only,
+            read_write,
+            // writable private mapping, written pages are copied
+            // and the changes never reach the file
+            copy_on_write
+        };
+
+        MappedFile()
+        :   m_data(nullptr),
+            m_size(0){
+        }
+
+        explicit MappedFile(const std::string & path, const Mode mode = Mode::read_only)
+        :   MappedFile()
+        {
+            const auto writable = mode == Mode::read_write;
+            const int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+            if(fd < 0){
+                throw std::runtime_error("cannot open " + path);
+            }
+            struct stat st;
+            if(::fstat(fd, &st) != 0){
+                ::close(fd);
+                throw std::runtime_error("cannot stat " + path);
+            }
+            m_size = std::size_t(st.st_size);
+            if(m_size > 0){
+                const int prot = mode == Mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+                const int flags = mode == Mode::copy_on_write ? MAP_PRIVATE : MAP_SHARED;
+                void * data = ::mmap(nullptr, m_size, prot, flags, fd, 0);
+                if(data == MAP_FAILED){
+                    ::close(fd);
+                    throw std::runtime_error("cannot map " + path);
+                }
+                m_data = static_cast<char *>(data);
+            }
+            // the mapping stays valid after closing the descriptor
+            ::close(fd);
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile & operator=(const MappedFile &) = delete;
+
+        MappedFile(MappedFile && other)
+        :   m_data(std::exchange(other.m_data, nullptr)),
+            m_size(std::exchange(other.m_size, 0)){
+        }
+        MappedFile & operator=(MappedFile && other){
+            if(this != &other){
+                this->unmap();
+                m_data = std::exchange(other.m_data, nullptr);
+                m_size = std::exchange(other.m_size, 0);
+            }
+            return *this;
+        }
+
+        ~MappedFile(){
+            this->unmap();
+        }
+
+        const char * data()const{
+            return m_data;
+        }
+        char * data(){
+            return m_data;
+        }
+        std::size_t size()const{
+            return m_size;
+        }
+
+        // hints for the kernel, offsets are rounded to whole pages.
+        // They do not change the contents of read only mappings
+        void advise_sequential()const{
+            this->advise(0, m_size, MADV_SEQUENTIAL);
+        }
+        void advise_will_need(const std::size_t offset, const std::size_t size)const{
+            this->advise(offset, size, MADV_WILLNEED);
+        }
+        void advise_dont_need(const std::size_t offset, const std::size_t size)const{
+            this->advise(offset, size, MADV_DONTNEED);
+        }
+
+        static std::size_t page_size(){
+            return std::size_t(::sysconf(_SC_PAGESIZE));
+        }
+
+    private:
+        void advise(const std::size_t offset, const std::size_t size, const int advice)const{
+            if(m_data == nullptr || size == 0 || offset >= m_size){
+                return;
+            }
+            const auto page = page_size();
+            const auto begin = offset / page * page;
+            const auto end = std::min(m_size, offset + size);
+            ::madvise(m_data + begin, end - begin, advice);
+        }
+
+        void unmap(){
+            if(m_data != nullptr){
+                ::munmap(m_data, m_size);
+                m_data = nullptr;
+                m_size = 0;
+            }
+        }
+
+        char * m_data;
+        std::size_t m_size;
+    };
+
+}
+}
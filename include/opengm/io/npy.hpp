@@ -0,0 +1,334 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+
+#include "opengm/tensors.hpp"
+#include "opengm/io/mapped_file.hpp"
+#include "opengm/io/binary_model.hpp"
+
+namespace opengm{
+namespace io{
+
+
+    // the numpy dtype string of T, e.g. "<f4" for float
+    template<class T>
+    std::string npy_descr(){
+        static_assert(std::is_arithmetic<T>::value, "only arithmetic types can be stored in .npy files");
+        const char kind = std::is_same<T, bool>::value ? 'b' :
+            std::is_floating_point<T>::value ? 'f' :
+            std::is_signed<T>::value ? 'i' : 'u';
+        const char order = sizeof(T) == 1 ? '|' : '<';
+        return std::string{order, kind} + std::to_string(sizeof(T));
+    }
+
+    struct NpyHeader{
+        std::string descr;
+        bool fortran_order{false};
+        std::vector<std::size_t> shape;
+        // byte offset of the data from the begin of the file
+        std::size_t data_offset{0};
+
+        std::size_t size()const{
+            return std::accumulate(shape.begin(), shape.end(), std::size_t(1), std::multiplies<std::size_t>());
+        }
+    };
+
+namespace detail{
+
+    constexpr char npy_magic[] = "\x93NUMPY";
+    constexpr std::size_t npy_magic_size = 6;
+
+    // value of key in the python dict literal of a .npy header
+    inline std::string npy_dict_value(const std::string & dict, const std::string & key){
+        const auto key_pos = dict.find("'" + key + "'");
+        if(key_pos == std::string::npos){
+            throw std::runtime_error("malformed .npy header, missing " + key);
+        }
+        auto begin = dict.find(':', key_pos);
+        if(begin == std::string::npos){
+            throw std::runtime_error("malformed .npy header");
+        }
+        begin = dict.find_first_not_of(' ', begin + 1);
+        if(begin == std::string::npos){
+            throw std::runtime_error("malformed .npy header");
+        }
+        std::size_t end;
+        if(dict[begin] == '('){
+            end = dict.find(')', begin) + 1;
+        }
+        else if(dict[begin] == '\''){
+            end = dict.find('\'', begin + 1) + 1;
+        }
+        else{
+            end = dict.find_first_of(",}", begin);
+        }
+        if(end == std::string::npos || end == 0){
+            throw std::runtime_error("malformed .npy header");
+        }
+        return dict.substr(begin, end - begin);
+    }
+}
+
+    // parse the header of a .npy file of the given size
+    inline NpyHeader parse_npy_header(const char * data, const std::size_t size){
+        if(size < detail::npy_magic_size + 4 || std::memcmp(data, detail::npy_magic, detail::npy_magic_size) != 0){
+            throw std::runtime_error("not a .npy file");
+        }
+        const auto major = std::uint8_t(data[6]);
+        std::size_t header_size, prefix_size;
+        if(major == 1){
+            std::uint16_t len;
+            std::memcpy(&len, data + 8, 2);
+            header_size = len;
+            prefix_size = 10;
+        }
+        else if(major == 2 || major == 3){
+            if(size < 12){
+                throw std::runtime_error("not a .npy file");
+            }
+            std::uint32_t len;
+            std::memcpy(&len, data + 8, 4);
+            header_size = len;
+            prefix_size = 12;
+        }
+        else{
+            throw std::runtime_error("unsupported .npy version " + std::to_string(major));
+        }
+        if(header_size > size - prefix_size){
+            throw std::runtime_error(".npy file is truncated");
+        }
+        const std::string dict(data + prefix_size, header_size);
+
+        NpyHeader header;
+        header.data_offset = prefix_size + header_size;
+        const auto descr = detail::npy_dict_value(dict, "descr");
+        header.descr = descr.substr(1, descr.size() - 2);
+        header.fortran_order = detail::npy_dict_value(dict, "fortran_order") == "True";
+        // the extents and their product must not overflow, a
+        // wrapped size would pass the truncation checks of the readers
+        const auto shape = detail::npy_dict_value(dict, "shape");
+        constexpr auto max_size = std::numeric_limits<std::size_t>::max();
+        std::size_t size = 1;
+        for(std::size_t pos = 1; pos < shape.size();){
+            const auto begin = shape.find_first_of("0123456789", pos);
+            if(begin == std::string::npos){
+                break;
+            }
+            const auto end = std::min(shape.find_first_not_of("0123456789", begin), shape.size());
+            std::size_t extent = 0;
+            for(auto c=begin; c<end; ++c){
+                const auto digit = std::size_t(shape[c] - '0');
+                if(extent > (max_size - digit) / 10){
+                    throw std::runtime_error("malformed .npy header");
+                }
+                extent = extent * 10 + digit;
+            }
+            if(extent != 0 && size > max_size / extent){
+                throw std::runtime_error("malformed .npy header");
+            }
+            size *= extent;
+            header.shape.push_back(extent);
+            pos = end;
+        }
+        return header;
+    }
+
+
+    // Zero copy view of a .npy file: the values are read directly
+    // from a private mapping of the file. Copies share the mapping.
+    // Writing to data() only changes the mapped pages of this
+    // process, never the file.
+    template<class T>
+    class NpyArray{
+    public:
+        using value_type = T;
+
+        NpyArray() = default;
+
+        explicit NpyArray(const std::string & path)
+        :   m_file(std::make_shared<MappedFile>(path, MappedFile::Mode::copy_on_write)),
+            m_header(),
+            m_data(nullptr)
+        {
+            m_header = parse_npy_header(m_file->data(), m_file->size());
+            if(m_header.descr != npy_descr<T>()){
+                throw std::runtime_error(path + " stores " + m_header.descr + " values, expected " + npy_descr<T>());
+            }
+            if(m_header.fortran_order && m_header.shape.size() > 1){
+                throw std::runtime_error(path + " is stored in fortran order, only c order can be viewed");
+            }
+            if(m_header.data_offset % alignof(T) != 0){
+                throw std::runtime_error(path + " has misaligned data");
+            }
+            if(m_header.size() > (m_file->size() - m_header.data_offset) / sizeof(T)){
+                throw std::runtime_error(path + " is truncated");
+            }
+            m_data = reinterpret_cast<value_type *>(m_file->data() + m_header.data_offset);
+        }
+
+        value_type * data(){
+            return m_data;
+        }
+        const value_type * data()const{
+            return m_data;
+        }
+        const std::vector<std::size_t> & shape()const{
+            return m_header.shape;
+        }
+        std::size_t dimension()const{
+            return m_header.shape.size();
+        }
+        std::size_t size()const{
+            return m_header.size();
+        }
+        const value_type & operator[](const std::size_t i)const{
+            return m_data[i];
+        }
+        const std::shared_ptr<MappedFile> & file()const{
+            return m_file;
+        }
+
+    private:
+        std::shared_ptr<MappedFile> m_file;
+        NpyHeader m_header;
+        value_type * m_data{nullptr};
+    };
+
+    template<class T>
+    NpyArray<T> read_npy(const std::string & path){
+        return NpyArray<T>(path);
+    }
+
+
+    // write values in c order with the given shape as .npy version 1.0,
+    // the data is aligned to 64 bytes st. it can be viewed by NpyArray
+    template<class T>
+    void write_npy(const std::string & path, const T * values, const std::vector<std::size_t> & shape){
+        if(!is_little_endian()){
+            throw std::runtime_error(".npy files are only written on little endian hosts");
+        }
+        // python tuple syntax, a 1 tuple needs a trailing comma
+        std::string shape_tuple;
+        for(std::size_t d=0; d<shape.size(); ++d){
+            shape_tuple += (d > 0 ? ", " : "") + std::to_string(shape[d]);
+        }
+        if(shape.size() == 1){
+            shape_tuple += ",";
+        }
+        std::string dict = "{'descr': '" + npy_descr<T>() + "', 'fortran_order': False, 'shape': (" + shape_tuple + "), }";
+        const std::size_t prefix_size = 10;
+        const auto header_size = align_up(prefix_size + dict.size() + 1, 64) - prefix_size;
+        dict.resize(header_size - 1, ' ');
+        dict += '\n';
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if(!out){
+            throw std::runtime_error("cannot open " + path + " for writing");
+        }
+        const std::uint16_t len = std::uint16_t(header_size);
+        const char version[2] = {1, 0};
+        out.write(detail::npy_magic, detail::npy_magic_size);
+        out.write(version, 2);
+        out.write(reinterpret_cast<const char *>(&len), 2);
+        out.write(dict.data(), dict.size());
+        const auto size = std::accumulate(shape.begin(), shape.end(), std::size_t(1), std::multiplies<std::size_t>());
+        out.write(reinterpret_cast<const char *>(values), size * sizeof(T));
+        out.close();
+        if(!out){
+            throw std::runtime_error("writing " + path + " failed");
+        }
+    }
+
+    // a labeling as 1D array of uint64
+    template<class LABELS>
+    void write_npy_labels(const std::string & path, const LABELS & labels){
+        std::vector<std::uint64_t> values(labels.begin(), labels.end());
+        write_npy(path, values.data(), {values.size()});
+    }
+
+    // a labeling from a 1D array of any integer type
+    inline std::vector<std::size_t> read_npy_labels(const std::string & path){
+        MappedFile file(path);
+        const auto header = parse_npy_header(file.data(), file.size());
+        if(header.shape.size() != 1){
+            throw std::runtime_error(path + " is not a 1D array");
+        }
+        std::vector<std::size_t> labels(header.shape[0]);
+        auto convert = [&](auto tag){
+            using V = decltype(tag);
+            if(header.size() > (file.size() - header.data_offset) / sizeof(V)){
+                throw std::runtime_error(path + " is truncated");
+            }
+            const char * data = file.data() + header.data_offset;
+            for(std::size_t i=0; i<labels.size(); ++i){
+                V value;
+                std::memcpy(&value, data + i * sizeof(V), sizeof(V));
+                if constexpr(std::is_signed<V>::value){
+                    if(value < 0){
+                        throw std::runtime_error(path + " stores negative labels");
+                    }
+                }
+                labels[i] = std::size_t(value);
+            }
+        };
+        if(header.descr == npy_descr<std::int64_t>()){ convert(std::int64_t()); }
+        else if(header.descr == npy_descr<std::uint64_t>()){ convert(std::uint64_t()); }
+        else if(header.descr == npy_descr<std::int32_t>()){ convert(std::int32_t()); }
+        else if(header.descr == npy_descr<std::uint32_t>()){ convert(std::uint32_t()); }
+        else if(header.descr == npy_descr<std::uint8_t>()){ convert(std::uint8_t()); }
+        else{
+            throw std::runtime_error(path + " stores " + header.descr + " values, expected integers");
+        }
+        return labels;
+    }
+
+    // the beliefs of a minimizer with belief(vi, out), e.g. BeliefPropergation,
+    // as (num_variables x max_num_labels) array padded with infinity
+    template<class MINIMIZER>
+    void write_npy_beliefs(const std::string & path, MINIMIZER & minimizer){
+        using value_type = typename MINIMIZER::value_type;
+        auto && gm = minimizer.gm();
+        const std::size_t num_variables = gm.num_variables();
+        const std::size_t max_num_labels = num_variables > 0 ? gm.space().max_num_labels() : 0;
+        std::vector<value_type> beliefs(num_variables * max_num_labels, std::numeric_limits<value_type>::infinity());
+        for(std::size_t vi=0; vi<num_variables; ++vi){
+            minimizer.belief(vi, beliefs.data() + vi * max_num_labels);
+        }
+        write_npy(path, beliefs.data(), {num_variables, max_num_labels});
+    }
+
+
+    // add a zero copy ExplicitViewTensor of array to gm,
+    // the model keeps the mapping alive. Returns the tensor id.
+    template<class GM>
+    std::size_t add_npy_tensor(GM & gm, const NpyArray<typename GM::value_type> & array){
+        using value_type = typename GM::value_type;
+        gm.add_storage(array.file());
+        auto shape = std::vector<std::size_t>(array.shape());
+        const auto arity = shape.size();
+        const auto shape_data = gm.add_storage(std::move(shape));
+        return gm.add_tensor(std::make_unique<ExplicitViewTensor<value_type>>(array.data(), shape_data, arity));
+    }
+
+    // view a (num_variables x stride) array as the dense unary block
+    // of gm without copying, the model keeps the mapping alive.
+    // Returns the id of the first unary factor.
+    template<class GM>
+    std::size_t add_npy_unaries(GM & gm, NpyArray<typename GM::value_type> & array){
+        gm.add_storage(array.file());
+        return gm.add_dense_unaries_view(array);
+    }
+
+}
+}
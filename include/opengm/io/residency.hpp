@@ -0,0 +1,201 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "opengm/io/mapped_file.hpp"
+
+namespace opengm{
+namespace io{
+
+
+    struct ResidencySettings{
+        // upper bound of the resident bytes of the region,
+        // should be larger than the largest tensor
+        std::size_t budget_bytes{std::size_t(256) << 20};
+        // granularity of the residency, rounded up to whole pages
+        std::size_t chunk_bytes{std::size_t(1) << 20};
+        // chunks behind a missed chunk which are prefetched
+        // st. sequential sweeps only miss once per readahead window
+        std::size_t readahead_chunks{4};
+    };
+
+    struct ResidencyStats{
+        // accessed chunks which were resident / not resident
+        std::size_t hits{0};
+        std::size_t misses{0};
+        // chunks made resident ahead of their access
+        std::size_t prefetches{0};
+        std::size_t evictions{0};
+        std::size_t resident_bytes{0};
+        std::size_t peak_resident_bytes{0};
+    };
+
+
+    // Explicit residency control of a region of a read only mapping.
+    // The region is split into chunks, accessed and prefetched chunks
+    // are advised as needed and kept in a LRU list, the least recently
+    // used chunks are advised as not needed as soon as the resident
+    // bytes exceed the budget. Evicting only drops the pages of the
+    // file backed mapping, evicted data is read again on the next
+    // access, therefore wrong hints only cost time.
+    // All members are thread safe.
+    class PagedResidency{
+    public:
+        PagedResidency(
+            const MappedFile & file,
+            const std::size_t region_offset,
+            const std::size_t region_size,
+            const ResidencySettings & settings = ResidencySettings()
+        )
+        :   m_file(&file),
+            m_region_offset(region_offset),
+            m_region_size(region_size),
+            m_settings(settings),
+            m_chunk_bytes(),
+            m_lru(),
+            m_lru_position(),
+            m_is_resident(),
+            m_stats(),
+            m_mutex()
+        {
+            const auto page = MappedFile::page_size();
+            m_chunk_bytes = std::max<std::size_t>((settings.chunk_bytes + page - 1) / page * page, page);
+            const auto num_chunks = (region_size + m_chunk_bytes - 1) / m_chunk_bytes;
+            m_lru_position.resize(num_chunks);
+            m_is_resident.resize(num_chunks, false);
+        }
+
+        PagedResidency(const PagedResidency &) = delete;
+        PagedResidency & operator=(const PagedResidency &) = delete;
+
+        std::size_t num_chunks()const{
+            return m_is_resident.size();
+        }
+        std::size_t chunk_bytes()const{
+            return m_chunk_bytes;
+        }
+        const ResidencySettings & settings()const{
+            return m_settings;
+        }
+
+        ResidencyStats stats()const{
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_stats;
+        }
+        void reset_stats(){
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const auto resident_bytes = m_stats.resident_bytes;
+            m_stats = ResidencyStats();
+            m_stats.resident_bytes = resident_bytes;
+            m_stats.peak_resident_bytes = resident_bytes;
+        }
+
+        // the bytes [offset, offset + size) of the region are accessed now
+        void access(const std::size_t offset, const std::size_t size){
+            if(size == 0){
+                return;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const auto first = offset / m_chunk_bytes;
+            const auto last = (offset + size - 1) / m_chunk_bytes;
+            bool missed = false;
+            for(auto c=first; c<=last; ++c){
+                if(m_is_resident[c]){
+                    ++m_stats.hits;
+                    m_lru.splice(m_lru.begin(), m_lru, m_lru_position[c]);
+                }
+                else{
+                    ++m_stats.misses;
+                    missed = true;
+                    this->make_resident(c);
+                }
+            }
+            if(missed){
+                const auto end = std::min(this->num_chunks(), last + 1 + m_settings.readahead_chunks);
+                for(auto c=last + 1; c<end; ++c){
+                    this->prefetch_chunk(c);
+                }
+            }
+            this->evict();
+        }
+
+        // the bytes [offset, offset + size) of the region will be accessed soon
+        void prefetch(const std::size_t offset, const std::size_t size){
+            if(size == 0){
+                return;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const auto first = offset / m_chunk_bytes;
+            const auto last = (offset + size - 1) / m_chunk_bytes;
+            for(auto c=first; c<=last; ++c){
+                this->prefetch_chunk(c);
+            }
+            this->evict();
+        }
+
+        // drop all chunks, e.g. after a solver finished
+        void evict_all(){
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while(!m_lru.empty()){
+                this->evict_back();
+            }
+        }
+
+    private:
+
+        void prefetch_chunk(const std::size_t c){
+            if(!m_is_resident[c]){
+                ++m_stats.prefetches;
+                this->make_resident(c);
+            }
+        }
+
+        void make_resident(const std::size_t c){
+            m_file->advise_will_need(m_region_offset + c * m_chunk_bytes, this->bytes_of(c));
+            m_lru.push_front(c);
+            m_lru_position[c] = m_lru.begin();
+            m_is_resident[c] = true;
+            m_stats.resident_bytes += this->bytes_of(c);
+            m_stats.peak_resident_bytes = std::max(m_stats.peak_resident_bytes, m_stats.resident_bytes);
+        }
+
+        // the most recently used chunk is never evicted
+        void evict(){
+            while(m_stats.resident_bytes > m_settings.budget_bytes && m_lru.size() > 1){
+                this->evict_back();
+                ++m_stats.evictions;
+            }
+        }
+
+        void evict_back(){
+            const auto c = m_lru.back();
+            m_lru.pop_back();
+            m_is_resident[c] = false;
+            m_stats.resident_bytes -= this->bytes_of(c);
+            m_file->advise_dont_need(m_region_offset + c * m_chunk_bytes, this->bytes_of(c));
+        }
+
+        std::size_t bytes_of(const std::size_t c)const{
+            return std::min(m_chunk_bytes, m_region_size - c * m_chunk_bytes);
+        }
+
+        const MappedFile * m_file;
+        std::size_t m_region_offset;
+        std::size_t m_region_size;
+        ResidencySettings m_settings;
+        std::size_t m_chunk_bytes;
+
+        // most recently used chunk first
+        std::list<std::size_t> m_lru;
+        std::vector<std::list<std::size_t>::iterator> m_lru_position;
+        std::vector<bool> m_is_resident;
+        ResidencyStats m_stats;
+        mutable std::mutex m_mutex;
+    };
+
+}
+}
@@ -0,0 +1,441 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <memory>
+#include <vector>
+#include <limits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "opengm/space.hpp"
+#include "opengm/tensors.hpp"
+#include "opengm/graphical_model.hpp"
+#include "opengm/thread_pool.hpp"
+#include "opengm/io/mapped_file.hpp"
+
+namespace opengm{
+namespace io{
+
+
+    // UAI tables store potentials which are multiplied, opengm
+    // stores energies which are added: energy = -log(potential).
+    // Zero potentials become infinite energies.
+    enum class UaiValues{
+        potentials,
+        energies
+    };
+
+    struct UaiReadSettings{
+        UaiValues values{UaiValues::potentials};
+        // 0 means one thread per core
+        std::size_t num_threads{0};
+    };
+
+
+namespace detail{
+
+    inline bool uai_is_space(const char c){
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    // sequential tokenizer over [begin, end)
+    class UaiTokenizer{
+    public:
+        UaiTokenizer(const char * begin, const char * end)
+        :   m_pos(begin),
+            m_end(end){
+        }
+
+        const char * position()const{
+            return m_pos;
+        }
+
+        // the next token or an empty range at the end
+        std::pair<const char *, const char *> next(){
+            while(m_pos != m_end && uai_is_space(*m_pos)){
+                ++m_pos;
+            }
+            const auto begin = m_pos;
+            while(m_pos != m_end && !uai_is_space(*m_pos)){
+                ++m_pos;
+            }
+            return std::make_pair(begin, m_pos);
+        }
+
+        std::string next_string(){
+            const auto token = this->next();
+            return std::string(token.first, token.second);
+        }
+
+        std::uint64_t next_integer(){
+            const auto token = this->next();
+            return parse_integer(token.first, token.second);
+        }
+
+        static std::uint64_t parse_integer(const char * begin, const char * end){
+            if(begin == end){
+                throw std::runtime_error("unexpected end of UAI file");
+            }
+            std::uint64_t value = 0;
+            for(auto c=begin; c!=end; ++c){
+                if(*c < '0' || *c > '9'){
+                    throw std::runtime_error("expected an integer in UAI file, got " + std::string(begin, end));
+                }
+                const auto digit = std::uint64_t(*c - '0');
+                if(value > (std::numeric_limits<std::uint64_t>::max() - digit) / 10){
+                    throw std::runtime_error("integer out of range in UAI file: " + std::string(begin, end));
+                }
+                value = value * 10 + digit;
+            }
+            return value;
+        }
+
+        // the token is copied st. strtod never reads past the mapping
+        static double parse_real(const char * begin, const char * end){
+            char buffer[64];
+            const auto size = std::size_t(end - begin);
+            if(size == 0 || size >= sizeof(buffer)){
+                throw std::runtime_error("expected a number in UAI file");
+            }
+            std::copy(begin, end, buffer);
+            buffer[size] = '\0';
+            char * parsed_end = nullptr;
+            const auto value = std::strtod(buffer, &parsed_end);
+            if(parsed_end != buffer + size){
+                throw std::runtime_error("expected a number in UAI file, got " + std::string(begin, end));
+            }
+            return value;
+        }
+
+    private:
+        const char * m_pos;
+        const char * m_end;
+    };
+
+    template<class T>
+    T uai_to_value(const double value, const UaiValues values){
+        return values == UaiValues::potentials ? T(-std::log(value)) : T(value);
+    }
+
+    template<class T>
+    double uai_from_value(const T value, const UaiValues values){
+        return values == UaiValues::potentials ? std::exp(-double(value)) : double(value);
+    }
+
+    inline std::string uai_read_file(const std::string & path){
+        std::ifstream in(path, std::ios::binary);
+        if(!in){
+            throw std::runtime_error("cannot open " + path);
+        }
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+}
+
+
+    // Read a MARKOV or BAYES network in UAI format.
+    //
+    // The preamble is parsed sequentially. The function tables are
+    // split into chunks at whitespace which are tokenized in parallel:
+    // a first pass counts the tokens of each chunk, a second pass parses
+    // them and writes each value to its position in one pool of values,
+    // which is moved into the model and viewed by the tensors.
+    template<class T = float>
+    GraphicalModel<ExplicitSpace<std::size_t>, T> read_uai(const std::string & path, const UaiReadSettings & settings = UaiReadSettings()){
+        using value_type = T;
+        using space_type = ExplicitSpace<std::size_t>;
+        using gm_type = GraphicalModel<space_type, value_type>;
+
+        MappedFile file(path);
+        const char * const file_begin = file.data();
+        const char * const file_end = file.data() + file.size();
+        file.advise_sequential();
+
+        // preamble
+        detail::UaiTokenizer tokenizer(file_begin, file_end);
+        const auto network = tokenizer.next_string();
+        if(network != "MARKOV" && network != "BAYES"){
+            throw std::runtime_error("unsupported UAI network type '" + network + "'");
+        }
+        const auto num_variables = tokenizer.next_integer();
+        std::vector<std::size_t> num_labels(num_variables);
+        for(auto & n : num_labels){
+            n = tokenizer.next_integer();
+        }
+        const auto num_factors = tokenizer.next_integer();
+        if(num_factors == std::numeric_limits<std::size_t>::max()){
+            throw std::runtime_error("too many factors in UAI file");
+        }
+        std::vector<std::size_t> factor_offsets(num_factors + 1, 0);
+        std::vector<std::size_t> factor_variables;
+        for(std::size_t fi=0; fi<num_factors; ++fi){
+            const auto arity = tokenizer.next_integer();
+            for(std::size_t a=0; a<arity; ++a){
+                const auto vi = tokenizer.next_integer();
+                if(vi >= num_variables){
+                    throw std::runtime_error("variable index out of range in UAI file");
+                }
+                factor_variables.push_back(vi);
+            }
+            factor_offsets[fi + 1] = factor_variables.size();
+        }
+
+        // each table is its number of entries followed by the entries,
+        // shapes and values of all tables are pooled.
+        // Each entry takes at least one byte of the file, larger
+        // (or overflowing) table sizes cannot match the file
+        const auto max_entries = file.size();
+        std::vector<std::size_t> shapes(factor_variables.size());
+        std::vector<std::size_t> value_offsets(num_factors + 1, 0);
+        std::vector<std::size_t> table_tokens(num_factors + 1, 0);
+        for(std::size_t fi=0; fi<num_factors; ++fi){
+            std::size_t size = 1;
+            for(auto i=factor_offsets[fi]; i<factor_offsets[fi + 1]; ++i){
+                shapes[i] = num_labels[factor_variables[i]];
+                if(shapes[i] == 0){
+                    throw std::runtime_error("variable without labels in UAI file");
+                }
+                if(size > max_entries / shapes[i]){
+                    throw std::runtime_error("UAI table too large");
+                }
+                size *= shapes[i];
+            }
+            if(size > max_entries - value_offsets[fi]){
+                throw std::runtime_error("UAI table too large");
+            }
+            value_offsets[fi + 1] = value_offsets[fi] + size;
+            table_tokens[fi + 1] = table_tokens[fi] + size + 1;
+        }
+        std::vector<value_type> values(value_offsets[num_factors]);
+
+        // chunks of the tables which start and end at whitespace
+        const char * const tables_begin = tokenizer.position();
+        const auto num_threads = settings.num_threads == 0 ? default_num_threads() : settings.num_threads;
+        const auto tables_size = std::size_t(file_end - tables_begin);
+        const auto num_chunks = std::max(std::size_t(1), std::min(4 * num_threads, tables_size / (1 << 16)));
+        std::vector<const char *> chunks(num_chunks + 1, file_end);
+        chunks[0] = tables_begin;
+        for(std::size_t c=1; c<num_chunks; ++c){
+            auto pos = std::max(chunks[c - 1], tables_begin + c * (tables_size / num_chunks));
+            while(pos != file_end && !detail::uai_is_space(*pos)){
+                ++pos;
+            }
+            chunks[c] = pos;
+        }
+
+        // pass 1: count the tokens of each chunk
+        std::vector<std::size_t> chunk_tokens(num_chunks + 1, 0);
+        parallel_for(num_chunks, num_threads, 1, [&](auto begin, auto end){
+            for(auto c=begin; c<end; ++c){
+                detail::UaiTokenizer chunk(chunks[c], chunks[c + 1]);
+                std::size_t n = 0;
+                while(chunk.next().first != chunks[c + 1]){
+                    ++n;
+                }
+                chunk_tokens[c + 1] = n;
+            }
+        });
+        std::partial_sum(chunk_tokens.begin(), chunk_tokens.end(), chunk_tokens.begin());
+        if(chunk_tokens[num_chunks] != table_tokens[num_factors]){
+            throw std::runtime_error("UAI file has " + std::to_string(chunk_tokens[num_chunks]) +
+                " table tokens, expected " + std::to_string(table_tokens[num_factors]));
+        }
+
+        // pass 2: parse the tokens, token g of the tables
+        // belongs to the table fi with table_tokens[fi] <= g
+        parallel_for(num_chunks, num_threads, 1, [&](auto begin, auto end){
+            for(auto c=begin; c<end; ++c){
+                detail::UaiTokenizer chunk(chunks[c], chunks[c + 1]);
+                auto g = chunk_tokens[c];
+                std::size_t fi = std::upper_bound(table_tokens.begin(), table_tokens.end(), g) - table_tokens.begin() - 1;
+                for(auto token = chunk.next(); token.first != chunks[c + 1]; token = chunk.next(), ++g){
+                    while(g >= table_tokens[fi + 1]){
+                        ++fi;
+                    }
+                    const auto i = g - table_tokens[fi];
+                    if(i == 0){
+                        const auto size = detail::UaiTokenizer::parse_integer(token.first, token.second);
+                        if(size != value_offsets[fi + 1] - value_offsets[fi]){
+                            throw std::runtime_error("table " + std::to_string(fi) + " of UAI file has the wrong size");
+                        }
+                    }
+                    else{
+                        const auto value = detail::UaiTokenizer::parse_real(token.first, token.second);
+                        values[value_offsets[fi] + i - 1] = detail::uai_to_value<value_type>(value, settings.values);
+                    }
+                }
+            }
+        });
+
+        // bulk construction of the model
+        gm_type gm(num_labels.begin(), num_labels.end());
+        const auto values_data = gm.add_storage(std::move(values));
+        const auto shapes_data = gm.add_storage(std::move(shapes));
+        gm.reserve(num_factors, factor_variables.size(), num_factors);
+        for(std::size_t fi=0; fi<num_factors; ++fi){
+            const auto offset = factor_offsets[fi];
+            const auto arity = factor_offsets[fi + 1] - offset;
+            const auto data = values_data + value_offsets[fi];
+            if(arity == 1){
+                gm.add_factor(std::make_unique<UnaryViewTensor<value_type>>(data, shapes_data[offset]),
+                    factor_variables.begin() + offset, factor_variables.begin() + offset + arity);
+            }
+            else{
+                gm.add_factor(std::make_unique<ExplicitViewTensor<value_type>>(data, shapes_data + offset, arity),
+                    factor_variables.begin() + offset, factor_variables.begin() + offset + arity);
+            }
+        }
+        return gm;
+    }
+
+
+    // Write a model in UAI MARKOV format. The tables of batches of
+    // factors are formatted in parallel on one pool of num_threads.
+    template<class GM>
+    void write_uai(const GM & gm, const std::string & path, const UaiValues values = UaiValues::potentials, const std::size_t num_threads = 0){
+        using value_type = typename GM::value_type;
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if(!out){
+            throw std::runtime_error("cannot open " + path + " for writing");
+        }
+
+        std::string buffer;
+        auto flush = [&](){
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        };
+
+        const std::size_t num_variables = gm.num_variables();
+        const std::size_t num_factors = gm.num_factors();
+        buffer += "MARKOV\n" + std::to_string(num_variables) + "\n";
+        for(std::size_t vi=0; vi<num_variables; ++vi){
+            buffer += std::to_string(gm.num_labels(vi));
+            buffer += vi + 1 < num_variables ? ' ' : '\n';
+        }
+        buffer += std::to_string(num_factors) + "\n";
+        for(auto && factor : gm){
+            auto && variables = factor.variables();
+            buffer += std::to_string(variables.size());
+            for(auto vi : variables){
+                buffer += ' ';
+                buffer += std::to_string(vi);
+            }
+            buffer += '\n';
+            if(buffer.size() > (1 << 20)){
+                flush();
+            }
+        }
+        flush();
+
+        constexpr std::size_t batch_size = 1 << 12;
+        constexpr std::size_t min_block_size = 64;
+        const auto max_num_threads = num_threads == 0 ? default_num_threads() : num_threads;
+        std::unique_ptr<ThreadPool> pool;
+        if(max_num_threads > 1 && num_factors >= 2 * min_block_size){
+            pool = std::make_unique<ThreadPool>(max_num_threads);
+        }
+        std::vector<std::string> tables(batch_size);
+        for(std::size_t batch_begin=0; batch_begin<num_factors; batch_begin+=batch_size){
+            const auto batch_end = std::min(num_factors, batch_begin + batch_size);
+            auto format = [&](auto begin, auto end){
+                std::vector<value_type> table_values;
+                char number[32];
+                for(auto i=begin; i<end; ++i){
+                    auto && factor = gm[batch_begin + i];
+                    std::size_t size = 1;
+                    for(std::size_t d=0; d<factor.arity(); ++d){
+                        size *= factor.shape(d);
+                    }
+                    table_values.resize(size);
+                    factor.copy_corder(table_values.data());
+                    auto & table = tables[i];
+                    table = "\n" + std::to_string(size) + "\n";
+                    for(std::size_t j=0; j<size; ++j){
+                        const auto n = std::snprintf(number, sizeof(number), "%.9g",
+                            detail::uai_from_value(table_values[j], values));
+                        table.append(number, n);
+                        table += j + 1 < size ? ' ' : '\n';
+                    }
+                }
+            };
+            if(pool){
+                parallel_for_static(*pool, batch_end - batch_begin, min_block_size, [&](auto, auto begin, auto end){
+                    format(begin, end);
+                });
+            }
+            else{
+                format(std::size_t(0), batch_end - batch_begin);
+            }
+            for(auto i=batch_begin; i<batch_end; ++i){
+                out.write(tables[i - batch_begin].data(), tables[i - batch_begin].size());
+            }
+        }
+        if(!out){
+            throw std::runtime_error("writing " + path + " failed");
+        }
+    }
+
+
+    // evidence file: the number of observed variables
+    // followed by (variable, label) pairs
+    inline std::vector<std::pair<std::size_t, std::size_t>> read_uai_evidence(const std::string & path){
+        const auto text = detail::uai_read_file(path);
+        detail::UaiTokenizer tokenizer(text.data(), text.data() + text.size());
+        std::vector<std::pair<std::size_t, std::size_t>> evidence(tokenizer.next_integer());
+        for(auto & [vi, label] : evidence){
+            vi = tokenizer.next_integer();
+            label = tokenizer.next_integer();
+        }
+        return evidence;
+    }
+
+    inline void write_uai_evidence(const std::string & path, const std::vector<std::pair<std::size_t, std::size_t>> & evidence){
+        std::ofstream out(path, std::ios::trunc);
+        out<<evidence.size();
+        for(auto && [vi, label] : evidence){
+            out<<' '<<vi<<' '<<label;
+        }
+        out<<'\n';
+        if(!out){
+            throw std::runtime_error("writing " + path + " failed");
+        }
+    }
+
+    // MPE solution file: "MPE", the number of
+    // variables and the label of each variable
+    inline std::vector<std::size_t> read_uai_solution(const std::string & path){
+        const auto text = detail::uai_read_file(path);
+        detail::UaiTokenizer tokenizer(text.data(), text.data() + text.size());
+        if(tokenizer.next_string() != "MPE"){
+            throw std::runtime_error("UAI solution file must start with MPE");
+        }
+        std::vector<std::size_t> labels(tokenizer.next_integer());
+        for(auto & label : labels){
+            label = tokenizer.next_integer();
+        }
+        return labels;
+    }
+
+    template<class LABELS>
+    void write_uai_solution(const std::string & path, const LABELS & labels){
+        std::ofstream out(path, std::ios::trunc);
+        out<<"MPE\n"<<std::size(labels);
+        for(auto label : labels){
+            out<<' '<<label;
+        }
+        out<<'\n';
+        if(!out){
+            throw std::runtime_error("writing " + path + " failed");
+        }
+    }
+
+}
+}
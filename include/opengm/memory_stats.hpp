@@ -0,0 +1,142 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+
+#include "opengm/aligned_allocator.hpp"
+
+namespace opengm{
+
+
+    // memory footprint of a model or a minimizer in bytes
+    struct MemoryStats{
+        // storage of the tensors owned by the model by tensor name()
+        std::map<std::string, std::size_t> tensors;
+        // the factor objects themselves
+        std::size_t factors{0};
+        // the variable indices of all factors
+        std::size_t variable_indices{0};
+        std::size_t space{0};
+        // auxiliary buffers of a minimizer by buffer name
+        std::map<std::string, std::size_t> buffers;
+
+        std::size_t tensor_bytes()const{
+            return sum(tensors);
+        }
+        std::size_t buffer_bytes()const{
+            return sum(buffers);
+        }
+        std::size_t model_bytes()const{
+            return this->tensor_bytes() + factors + variable_indices + space;
+        }
+        std::size_t total()const{
+            return this->model_bytes() + this->buffer_bytes();
+        }
+
+        MemoryStats & operator+=(const MemoryStats & other){
+            for(auto && [name, bytes] : other.tensors){
+                tensors[name] += bytes;
+            }
+            factors += other.factors;
+            variable_indices += other.variable_indices;
+            space += other.space;
+            for(auto && [name, bytes] : other.buffers){
+                buffers[name] += bytes;
+            }
+            return *this;
+        }
+
+    private:
+        static std::size_t sum(const std::map<std::string, std::size_t> & bytes){
+            std::size_t s = 0;
+            for(auto && [name, b] : bytes){
+                s += b;
+            }
+            return s;
+        }
+    };
+
+    inline std::ostream & operator<<(std::ostream & out, const MemoryStats & stats){
+        for(auto && [name, bytes] : stats.tensors){
+            out<<"tensors/"<<name<<": "<<bytes<<"\n";
+        }
+        out<<"factors: "<<stats.factors<<"\n";
+        out<<"variable_indices: "<<stats.variable_indices<<"\n";
+        out<<"space: "<<stats.space<<"\n";
+        for(auto && [name, bytes] : stats.buffers){
+            out<<"buffers/"<<name<<": "<<bytes<<"\n";
+        }
+        out<<"total: "<<stats.total()<<"\n";
+        return out;
+    }
+
+
+    // the statistics of a model which determine the size
+    // of the buffers of the minimizers.
+    // Can be computed without building the model
+    // to estimate the footprint of a minimizer beforehand.
+    struct ModelStatistics{
+        std::size_t num_variables{0};
+        std::size_t num_factors{0};
+        // sum of the arities of all factors
+        std::size_t num_index_entries{0};
+        // sum of the arities of the factors with arity > 1
+        std::size_t num_higher_order_index_entries{0};
+        // sum of sum_of_shape() of the factors with arity > 1
+        std::size_t higher_order_sum_of_shape{0};
+        // as above, but each extent padded to packed_row_size of
+        // value_type as in the message layout of BeliefPropergation
+        std::size_t higher_order_padded_sum_of_shape{0};
+        // sum of the number of labels of all variables
+        std::size_t sum_of_num_labels{0};
+        std::size_t max_num_labels{0};
+        std::size_t max_arity{0};
+    };
+
+    template<class GM>
+    ModelStatistics model_statistics(const GM & gm){
+        ModelStatistics stats;
+        stats.num_variables = gm.num_variables();
+        stats.num_factors = gm.num_factors();
+        for(std::size_t vi=0; vi<stats.num_variables; ++vi){
+            const auto num_labels = std::size_t(gm.num_labels(vi));
+            stats.sum_of_num_labels += num_labels;
+            stats.max_num_labels = std::max(stats.max_num_labels, num_labels);
+        }
+        for(auto && factor : gm){
+            const auto arity = std::size_t(factor.arity());
+            stats.num_index_entries += arity;
+            stats.max_arity = std::max(stats.max_arity, arity);
+            if(arity > 1){
+                stats.num_higher_order_index_entries += arity;
+                stats.higher_order_sum_of_shape += factor.sum_of_shape();
+                for(std::size_t i=0; i<arity; ++i){
+                    stats.higher_order_padded_sum_of_shape += packed_row_size<typename GM::value_type>(factor.shape(i));
+                }
+            }
+        }
+        return stats;
+    }
+
+
+namespace detail{
+
+    template<class V, class A>
+    std::size_t heap_bytes(const std::vector<V, A> & v){
+        return v.capacity() * sizeof(V);
+    }
+
+    template<class V, class A, class OUTER_A>
+    std::size_t heap_bytes(const std::vector<std::vector<V, A>, OUTER_A> & v){
+        auto bytes = v.capacity() * sizeof(std::vector<V, A>);
+        for(auto && inner : v){
+            bytes += heap_bytes(inner);
+        }
+        return bytes;
+    }
+}
+
+}
@@ -20,4 +20,17 @@ namespace opengm::meta{
         A,B
     >;
 
+
+    namespace detail{
+        template<class VOID, template<class...> class OP, class... ARGS>
+        struct detector : public std::false_type{};
+
+        template<template<class...> class OP, class... ARGS>
+        struct detector<std::void_t<OP<ARGS...>>, OP, ARGS...> : public std::true_type{};
+    }
+
+    // true iff OP<ARGS...> is well formed
+    template<template<class...> class OP, class... ARGS>
+    using is_detected = detail::detector<void, OP, ARGS...>;
+
 }
\ No newline at end of file
@@ -1,11 +1,18 @@
 #pragma once
 
+#include <array>
+#include <cmath>
 #include <queue>
 #include <algorithm>
+#include <numeric>
 #include <map>
 
 #include "opengm/minimizer/minimizer_base.hpp"
 #include "opengm/arity_vector.hpp"
+#include "opengm/aligned_allocator.hpp"
+#include "opengm/float16.hpp"
+#include "opengm/thread_pool.hpp"
+#include "opengm/datastructures/indexed_priority_queue.hpp"
 
 namespace opengm{
 
@@ -15,123 +22,201 @@ namespace opengm{
 
 namespace detail{
 
-    template<class T>
-    struct Msg{
-        T * msg_;
-        T * oMsg_;
-    };
+    constexpr std::size_t simd_lanes = 8;
 
+    // f(lane, i) for i in [0, size) in chunks of simd_lanes, lane is
+    // i % simd_lanes for full chunks and 0 for the remainder
+    template<class F>
+    inline void for_each_lane(const std::size_t size, F && f){
+        std::size_t i = 0;
+        for(; i + simd_lanes <= size; i += simd_lanes){
+            for(std::size_t lane=0; lane<simd_lanes; ++lane){
+                f(lane, i + lane);
+            }
+        }
+        for(; i<size; ++i){
+            f(std::size_t(0), i);
+        }
+    }
 
+    // sum in T with one partial sum per lane, short arrays
+    // (where the lanes do not pay off) are summed in order
+    template<class T, class V>
+    inline T lane_sum(const V * values, const std::size_t size){
+        if(size < 2 * simd_lanes){
+            return std::accumulate(values, values + size, T(0));
+        }
+        std::array<T, simd_lanes> lanes{};
+        for_each_lane(size, [&](auto lane, auto i){
+            lanes[lane] += values[i];
+        });
+        auto sum = T(0);
+        for(auto value : lanes){
+            sum += value;
+        }
+        return sum;
+    }
 
-    template<class GM>
+    // distinguishes the message types in snapshots: the size
+    // and whether it is a floating point or a 16 bit type
+    template<class T>
+    constexpr std::uint32_t message_type_tag(){
+        if constexpr(std::is_same<T, float16>::value){
+            return 0x10001;
+        }
+        else if constexpr(std::is_same<T, bfloat16>::value){
+            return 0x10002;
+        }
+        else{
+            return std::uint32_t(sizeof(T)) | (std::is_floating_point<T>::value ? 0x100 : 0);
+        }
+    }
+
+    // Structure of arrays message layout. The var-to-fac and the
+    // fac-to-var messages are stored in two arrays with identical layout:
+    // the messages between a variable vi and its higher order factors
+    // form one block of vi, row hoi of the block belongs to the hoi-th
+    // higher order factor of vi. Rows are padded to packed_row_size and
+    // blocks are aligned accordingly, a row therefore never straddles a
+    // cache line (or spans whole lines) and an update of vi streams two
+    // contiguous blocks. The rows of a factor are found via an index
+    // array of row offsets.
+    // The messages can be stored in a narrower MESSAGE_TYPE than the
+    // value_type of the model, e.g. float16 (see float16.hpp), the rows
+    // keep the number of elements of value_type rows.
+    template<class GM, class MESSAGE_TYPE = typename GM::value_type>
     class MessageStoring{
     public:
         typedef GM gm_type;
         using value_type = typename gm_type::value_type;
+        using message_type = MESSAGE_TYPE;
         using factors_of_variables_type =  HigherOrderAndUnaryFactorsOfVariables<gm_type>;
         MessageStoring(const gm_type & gm, const factors_of_variables_type & factors_of_variables)
         :   m_gm(gm),
             m_factors_of_variables(factors_of_variables),
-            m_msg_ptrs(),
-            m_fac_to_var_offset(gm.num_factors()),
-            m_var_to_fac_offset(gm.num_variables())
+            m_var_offset(gm.num_variables() + 1, 0),
+            m_fac_offset(gm.num_factors(), 0),
+            m_row_offset(),
+            m_var_to_fac(),
+            m_fac_to_var()
         {
-
-            uint64_t num_fac_to_var_msg = 0;
-            uint64_t msg_value_space = 0;
-            // count messages
-            for(auto && factor : m_gm){
-                const auto arity = factor.arity();
-                if(arity>1){
-                    num_fac_to_var_msg +=arity;
-                    msg_value_space += factor.sum_of_shape();
-                }
-            }
-
-            m_msg_storage.resize(2*msg_value_space,0.0);
-            m_msg_ptrs.reserve(2*num_fac_to_var_msg);
-
-            // setup offsets
-            uint64_t var_offset = 0;
-            uint64_t msg_index = 0;
-
-            for(auto vi=0; vi<m_gm.num_variables(); ++vi){
-                const auto nl = m_gm.num_labels(vi);
+            // blocks of the variables, each block starts at a
+            // multiple of its row stride or of a full line
+            constexpr auto values_per_line = padded_size<value_type>(1);
+            for(std::size_t vi=0; vi<m_gm.num_variables(); ++vi){
                 const auto & factors = m_factors_of_variables[vi];
-                m_var_to_fac_offset[vi] = msg_index;
-                for(auto fi : factors.higher_order()){
-                    const auto factor = m_gm[fi];
-
-                    m_msg_ptrs.push_back(Msg<value_type>{m_msg_storage.data()+ var_offset , NULL});
-                    var_offset += nl;
-                    ++msg_index;
-                }
+                const auto num_rows = factors.higher_order().size();
+                const auto stride = this->row_stride(vi);
+                const auto alignment = std::min(stride, values_per_line);
+                const auto begin = num_rows > 0 ? (m_var_offset[vi] + alignment - 1) / alignment * alignment : m_var_offset[vi];
+                m_var_offset[vi] = begin;
+                m_var_offset[vi + 1] = begin + num_rows * stride;
             }
+            m_var_to_fac.assign(m_var_offset.back(), message_type(0));
+            m_fac_to_var.assign(m_var_offset.back(), message_type(0));
 
+            // rows of the factors
+            std::size_t num_rows = 0;
+            m_gm.for_each_factor([&](auto fi, auto && factor){
+                const auto arity = factor.arity();
+                m_fac_offset[fi] = num_rows;
+                if(arity > 1){
+                    num_rows += arity;
+                }
+            });
+            m_row_offset.resize(num_rows);
             m_gm.for_each_factor([&](auto fi, auto && factor){
                 const auto arity = factor.arity();
                 if(arity > 1){
-
                     auto && variables = factor.variables();
-                    // set var_offset
                     for(auto a=0; a<arity; ++a){
-
-
                         const auto vi = variables[a];
-                        const auto nl = m_gm.num_labels(vi);
-                        auto && hfacs = m_factors_of_variables[vi].higher_order();
-
-                        // find out at which position fDesc is in hfacs
-                        auto fi_iter = std::find(hfacs.begin(), hfacs.end(), fi);
-                        const auto pos = std::distance(hfacs.begin(), fi_iter);
-
-                        auto  & varToFacMsgHolder = m_msg_ptrs[m_var_to_fac_offset[vi]+pos];
+                        const auto & factors = m_factors_of_variables[vi];
+                        auto && hfacs = factors.higher_order();
 
-                        const auto facToVarMsgHolder  = Msg<value_type>{m_msg_storage.data()+ var_offset, varToFacMsgHolder.msg_};
-                        varToFacMsgHolder.oMsg_ = facToVarMsgHolder.msg_;
-                        m_msg_ptrs.push_back(facToVarMsgHolder);
-                        var_offset += nl;
+                        // find out at which position fi is in hfacs
+                        const auto pos = std::distance(hfacs.begin(), std::find(hfacs.begin(), hfacs.end(), fi));
+                        m_row_offset[m_fac_offset[fi] + a] = m_var_offset[vi] + pos * this->row_stride(vi);
                     }
-                    m_fac_to_var_offset[fi] = msg_index;
-                    msg_index += arity;
                 }
             });
         }
 
-        value_type * facToVarMsg(const std::size_t fi, const size_t mi){
-            const uint64_t offset = m_fac_to_var_offset[fi];
-            return m_msg_ptrs[offset + mi].msg_;
+        message_type * facToVarMsg(const std::size_t fi, const size_t mi){
+            return m_fac_to_var.data() + m_row_offset[m_fac_offset[fi] + mi];
         }
 
-        value_type * oppToFacToVarMsg(const std::size_t fi, const size_t mi){
-            const uint64_t offset = m_fac_to_var_offset[fi];
-            return m_msg_ptrs[offset + mi].oMsg_;
+        message_type * oppToFacToVarMsg(const std::size_t fi, const size_t mi){
+            return m_var_to_fac.data() + m_row_offset[m_fac_offset[fi] + mi];
         }
 
-        value_type * varToFacMsg(const std::size_t vi, const size_t mi){
-            const uint64_t offset = m_var_to_fac_offset[vi];
-            return m_msg_ptrs[offset + mi].msg_;
+        message_type * varToFacMsg(const std::size_t vi, const size_t mi){
+            return m_var_to_fac.data() + m_var_offset[vi] + mi * this->row_stride(vi);
         }
 
-        value_type * oppToVarToFacMsg(const std::size_t vi, const size_t mi){
-            const uint64_t offset = m_var_to_fac_offset[vi];
-            return m_msg_ptrs[offset + mi].oMsg_;
+        message_type * oppToVarToFacMsg(const std::size_t vi, const size_t mi){
+            return m_fac_to_var.data() + m_var_offset[vi] + mi * this->row_stride(vi);
         }
 
+        // the block of vi, row hoi starts at hoi * row_stride(vi)
+        message_type * varToFacBlock(const std::size_t vi){
+            return m_var_to_fac.data() + m_var_offset[vi];
+        }
+        message_type * facToVarBlock(const std::size_t vi){
+            return m_fac_to_var.data() + m_var_offset[vi];
+        }
+        std::size_t row_stride(const std::size_t vi)const{
+            return packed_row_size<value_type>(m_gm.num_labels(vi));
+        }
+        // rows of the block of vi, one per higher order factor of vi
+        std::size_t num_rows(const std::size_t vi)const{
+            return (m_var_offset[vi + 1] - m_var_offset[vi]) / this->row_stride(vi);
+        }
 
         uint64_t nMsg()const{
-            return m_msg_ptrs.size();
+            return 2 * m_row_offset.size();
+        }
+
+        void add_buffer_memory(MemoryStats & stats)const{
+            stats.buffers["messages"] += detail::heap_bytes(m_var_to_fac) + detail::heap_bytes(m_fac_to_var);
+            stats.buffers["message_indices"] += detail::heap_bytes(m_row_offset);
+            stats.buffers["message_offsets"] += detail::heap_bytes(m_fac_offset) + detail::heap_bytes(m_var_offset);
+        }
+
+        void save(SnapshotWriter & writer)const{
+            writer.write_value(message_type_tag<message_type>());
+            writer.write_vector(m_var_to_fac);
+            writer.write_vector(m_fac_to_var);
+        }
+        // the layout is fixed by the model, it is filled in place
+        void load(SnapshotReader & reader){
+            if(reader.read_value<std::uint32_t>() != message_type_tag<message_type>()){
+                throw std::runtime_error("snapshot messages are stored in another type");
+            }
+            reader.read_array(m_var_to_fac.data(), m_var_to_fac.size());
+            reader.read_array(m_fac_to_var.data(), m_fac_to_var.size());
+        }
+
+        // each factor of arity > 1 has one message in each
+        // direction for each of its variables
+        static void estimate_buffer_memory(const ModelStatistics & model_stats, MemoryStats & stats){
+            stats.buffers["messages"] += 2 * model_stats.higher_order_padded_sum_of_shape * sizeof(message_type);
+            stats.buffers["message_indices"] += model_stats.num_higher_order_index_entries * sizeof(std::size_t);
+            stats.buffers["message_offsets"] += (model_stats.num_factors + model_stats.num_variables + 1) * sizeof(std::size_t);
         }
 
     private:
         const gm_type & m_gm;
         const factors_of_variables_type & m_factors_of_variables;
-        std::vector<Msg<value_type>> m_msg_ptrs;
 
-        std::vector<std::size_t> m_fac_to_var_offset;
-        std::vector<std::size_t> m_var_to_fac_offset;
-        std::vector<value_type> m_msg_storage;
-        // uint64_t lastVarOffset_;
+        // first value of the block of each variable
+        std::vector<std::size_t> m_var_offset;
+        // first row of each factor in m_row_offset
+        std::vector<std::size_t> m_fac_offset;
+        // first value of each row of each factor
+        std::vector<std::size_t> m_row_offset;
+        aligned_vector<message_type> m_var_to_fac;
+        aligned_vector<message_type> m_fac_to_var;
     };
 
 
@@ -150,8 +235,16 @@ namespace detail{
 
 
 
-template<class GM>
-class BeliefPropergation : public MinimizerCrtpBase<GM, BeliefPropergation<GM> >{
+// MESSAGE_TYPE is the type the messages are stored in, it can be
+// narrower than the value_type of the model (e.g. float16 or bfloat16
+// for float models, float for double models) to halve the message
+// memory streamed in each iteration. Beliefs and messages are computed
+// in value_type, only the stored messages are rounded. Narrow
+// factor-to-variable messages are shifted st. their minimum is zero,
+// which does not change any variable-to-factor message, and the
+// convergence criteria compare the rounded messages.
+template<class GM, class MESSAGE_TYPE = typename GM::value_type>
+class BeliefPropergation : public MinimizerCrtpBase<GM, BeliefPropergation<GM, MESSAGE_TYPE> >{
     //public MinimizerBase<GM>{
 public:
 
@@ -160,16 +253,63 @@ public:
     using base_type = MinimizerBase<gm_type>;
     using factors_of_variables_type =  HigherOrderAndUnaryFactorsOfVariables<gm_type>;
     using value_type = typename GM::value_type;
+    using message_type = MESSAGE_TYPE;
     using label_type = typename GM::label_type;
     using labels_vector_type = typename base_type::labels_vector_type;
     using minimizer_callback_base_ptr_type = typename base_type::minimizer_callback_base_ptr_type;
 
     using base_type::minimize;
+    using base_type::model_changed;
+
+    static constexpr bool narrow_messages = !std::is_same<message_type, value_type>::value;
+
+    // Each iteration is synchronous: first all factor-to-variable
+    // messages are computed from the variable-to-factor messages, then
+    // all variable-to-factor messages from the factor-to-variable ones.
+    // Within a phase each factor (variable) only writes its own messages,
+    // therefore a phase is a single conflict-free group which is split
+    // into one contiguous block per thread.
+    //
+    // The residual schedule instead keeps the change each factor would
+    // make to its factor-to-variable messages (the residual) in a priority
+    // queue and always updates the factor with the largest residual first,
+    // followed by the variable-to-factor messages of its variables.
+    // It stops when no residual exceeds residual_threshold. To bound
+    // oscillating models an iteration counts as as many factor updates
+    // as there are factors of arity > 1, at most num_iterations are run.
+    //
+    // The active set schedule is synchronous, but each phase only visits
+    // the active factors (variables). After the first iteration, which
+    // visits all of them, a variable is active if one of its incoming
+    // factor-to-variable messages changed by more than active_threshold
+    // (max norm), or if its own variable-to-factor messages still changed
+    // by more than active_threshold (euclidean norm) due to damping. The
+    // factors of such a variable are re-activated. It stops when the
+    // active set is empty. A threshold of 0 reproduces the synchronous
+    // schedule. The residual and the active set schedule are sequential.
+    enum class Schedule{
+        synchronous,
+        residual,
+        active_set
+    };
 
     struct Settings : public SolverSettingsBase{
         std::size_t num_iterations{10000};
         value_type damping{0.9};
         value_type convergence{5e-7};
+        // 1 is sequential, 0 means one thread per core
+        std::size_t num_threads{1};
+        // sum the convergence criterion in variable order st. parallel
+        // runs are bit-identical to sequential runs, otherwise the
+        // partial sums of the blocks are added
+        bool deterministic{true};
+        Schedule schedule{Schedule::synchronous};
+        // largest change of any message (max norm) which
+        // is still considered converged by the residual schedule
+        value_type residual_threshold{1e-5};
+        // largest change of the messages of a variable which is
+        // still considered converged by the active set schedule
+        value_type active_threshold{1e-4};
     };
 
     using settings_type = Settings;
@@ -207,16 +347,64 @@ public:
         m_best_energy(),
         m_current_labels(gm.num_variables(), 0),
         m_best_labels(gm.num_variables(),0),
-        sMsgBuffer_(gm.space().max_num_labels())
+        sMsgBuffer_(buffer_size(gm.space().max_num_labels(), gm.max_arity())),
+        m_dense_unaries(dense_unaries_of(gm)),
+        m_pool(nullptr),
+        m_thread_buffers(),
+        m_variable_eps(),
+        m_pending_offsets(),
+        m_pending(),
+        m_residual_queue(),
+        m_active_factors(),
+        m_active_variables(),
+        m_previous_messages(),
+        m_num_active_factors(0)
     {
         m_current_energy =  m_gm.evaluate(m_current_labels);
         m_best_energy = m_current_energy;
 
     }
 
+    // continue the run of the snapshot at resume_from.path
+    BeliefPropergation(const GM & gm, const Settings & settings, const ResumeFrom & resume_from)
+    :   BeliefPropergation(gm, settings)
+    {
+        this->resume(resume_from.path);
+    }
+
     std::string name() const override{
         return "BeliefPropergation";
     }
+
+    void add_buffer_memory(MemoryStats & stats) const override{
+        m_msg.add_buffer_memory(stats);
+        stats.buffers["factors_of_variables"] += m_factors_of_variables.memory_usage();
+        stats.buffers["labels"] += detail::heap_bytes(m_current_labels) + detail::heap_bytes(m_best_labels);
+        stats.buffers["belief_buffer"] += detail::heap_bytes(sMsgBuffer_) + detail::heap_bytes(m_thread_buffers) +
+            detail::heap_bytes(m_variable_eps);
+        if(!m_pending.empty()){
+            stats.buffers["residual_messages"] += detail::heap_bytes(m_pending) + detail::heap_bytes(m_pending_offsets);
+            stats.buffers["residual_queue"] += m_residual_queue.memory_usage();
+        }
+        if(!m_active_factors.empty()){
+            stats.buffers["active_set"] += detail::heap_bytes(m_active_factors) + detail::heap_bytes(m_active_variables) +
+                detail::heap_bytes(m_previous_messages);
+        }
+    }
+
+    // predict the buffers of a BeliefPropergation for a model
+    // with the given statistics before constructing it.
+    // The factors of variables are estimated by their size,
+    // their actual capacity may be slightly larger.
+    static MemoryStats estimate_memory(const ModelStatistics & model_stats, const Settings & settings = Settings()){
+        MemoryStats stats;
+        detail::MessageStoring<GM, message_type>::estimate_buffer_memory(model_stats, stats);
+        stats.buffers["factors_of_variables"] += model_stats.num_variables * sizeof(typename factors_of_variables_type::value_type) +
+            model_stats.num_index_entries * sizeof(std::size_t);
+        stats.buffers["labels"] += 2 * model_stats.num_variables * sizeof(label_type);
+        stats.buffers["belief_buffer"] += buffer_size(model_stats.max_num_labels, model_stats.max_arity) * sizeof(value_type);
+        return stats;
+    }
     const gm_type & gm() const override{
         return m_gm;
     }
@@ -238,25 +426,76 @@ public:
         return false;
     }
 
-    void minimize(minimizer_callback_base_ptr_type minimizer_callback_base_ptr)override{
+    // the messages are kept and serve as warm start
+    void model_changed() override{
         m_current_energy =  m_gm.evaluate(m_current_labels);
-        m_best_labels = m_current_labels;
-        m_best_energy = m_current_energy;
+        m_best_energy = m_gm.evaluate(m_best_labels);
+    }
+
+    bool can_checkpoint() const override{
+        return true;
+    }
+    void save_state(SnapshotWriter & writer) const override{
+        writer.write_value(std::uint64_t(m_iteration));
+        writer.write_value(m_current_energy);
+        writer.write_value(m_best_energy);
+        writer.write_vector(m_current_labels);
+        writer.write_vector(m_best_labels);
+        m_msg.save(writer);
+    }
+    void load_state(SnapshotReader & reader) override{
+        m_iteration = reader.read_value<std::uint64_t>();
+        m_current_energy = reader.read_value<value_type>();
+        m_best_energy = reader.read_value<value_type>();
+        reader.read_array(m_current_labels.data(), m_current_labels.size());
+        reader.read_array(m_best_labels.data(), m_best_labels.size());
+        m_msg.load(reader);
+        m_resumed = true;
+    }
+
+    // after a resume the interrupted run is continued
+    // with its iteration counter and best labels
+    void minimize(minimizer_callback_base_ptr_type minimizer_callback_base_ptr)override{
+        if(!m_resumed)
+        {
+            m_iteration = 0;
+            m_current_energy =  m_gm.evaluate(m_current_labels);
+            m_best_labels = m_current_labels;
+            m_best_energy = m_current_energy;
+        }
+        m_resumed = false;
 
         auto callback = callback_wrapper(this, minimizer_callback_base_ptr);
 
+        if(m_settings.schedule == Schedule::residual)
+        {
+            this->minimize_residual(callback);
+            return;
+        }
+        if(m_settings.schedule == Schedule::active_set)
+        {
+            this->minimize_active_set(callback);
+            return;
+        }
 
-        for(auto iteration=0; iteration<m_settings.num_iterations; ++iteration)
+        // the pool lives as long as this call
+        std::unique_ptr<ThreadPool> pool;
+        if(m_settings.num_threads != 1)
+        {
+            pool = std::make_unique<ThreadPool>(m_settings.num_threads);
+            m_thread_buffers.resize(pool->num_threads(), std::vector<value_type>(sMsgBuffer_.size()));
+        }
+        m_pool = pool.get();
+        struct ResetPool{
+            ThreadPool *& pool;
+            ~ResetPool(){ pool = nullptr; }
+        } reset_pool{m_pool};
+
+        while(m_iteration < m_settings.num_iterations)
         {
             this->sendAllFacToVar();
             auto eps = this->sendAllVarToFac();
-            m_current_energy =  m_gm.evaluate(m_current_labels);
-            callback();
-            if(m_current_energy < m_best_energy)
-            {
-                m_best_energy = m_current_energy;
-                m_best_labels = m_current_labels;
-            }
+            this->finish_iteration(callback);
 
             if( eps < m_settings.convergence)
             {
@@ -266,137 +505,625 @@ public:
 
     }
 
+    // completed iterations of the current run
+    std::size_t iteration()const{
+        return m_iteration;
+    }
+
+    // factors of arity > 1 updated in the last
+    // iteration of the active set schedule
+    std::size_t num_active_factors()const{
+        return m_num_active_factors;
+    }
+
     auto sendAllVarToFac(){
+        const std::size_t num_variables = m_gm.num_variables();
         auto eps = value_type(0);
-        for(auto vi=0; vi<m_gm.num_variables(); ++vi)
+        if(m_pool == nullptr)
+        {
+            for(auto vi=0; vi<num_variables; ++vi)
+            {
+                eps +=  this->sendVarToFac(vi);
+            }
+        }
+        else if(m_settings.deterministic)
         {
-            eps +=  this->sendVarToFac(vi);
+            m_variable_eps.resize(num_variables);
+            parallel_for_static(*m_pool, num_variables, parallel_min_block_size, [&](auto block, auto begin, auto end){
+                const auto buffer = m_thread_buffers[block].data();
+                for(auto vi=begin; vi<end; ++vi)
+                {
+                    m_variable_eps[vi] = this->sendVarToFac(vi, buffer);
+                }
+            });
+            for(auto vi=0; vi<num_variables; ++vi)
+            {
+                eps += m_variable_eps[vi];
+            }
+        }
+        else
+        {
+            std::vector<value_type> block_eps(m_pool->num_threads(), value_type(0));
+            const auto num_blocks = parallel_for_static(*m_pool, num_variables, parallel_min_block_size, [&](auto block, auto begin, auto end){
+                const auto buffer = m_thread_buffers[block].data();
+                auto partial_eps = value_type(0);
+                for(auto vi=begin; vi<end; ++vi)
+                {
+                    partial_eps += this->sendVarToFac(vi, buffer);
+                }
+                block_eps[block] = partial_eps;
+            });
+            for(std::size_t block=0; block<num_blocks; ++block)
+            {
+                eps += block_eps[block];
+            }
         }
         eps /= m_msg.nMsg();
         return eps;
     }
 
+    // the fac-to-var messages only depend on the var-to-fac messages,
+    // therefore the factors can be visited grouped by arity.
+    // Unaries have no messages and are skipped entirely.
+    // Models with pairwise tensors (e.g. GridGm) stream their
+    // pairwise factors without creating factor proxies.
     void sendAllFacToVar(){
-        for(auto fi=0; fi<m_gm.num_factors(); ++fi)
+        if constexpr(has_pairwise_tensors<GM>::value)
         {
-            this->sendFacToVar(fi);
+            const std::size_t num_pairwise = m_gm.num_factors() - m_gm.num_variables();
+            if(m_pool != nullptr)
+            {
+                parallel_for_static(*m_pool, num_pairwise, parallel_min_block_size, [&](auto block, auto begin, auto end){
+                    this->send_pairwise_fac_to_var(begin, end, m_thread_buffers[block].data());
+                });
+            }
+            else
+            {
+                this->send_pairwise_fac_to_var(0, num_pairwise, sMsgBuffer_.data());
+            }
+            return;
+        }
+        if(m_pool != nullptr)
+        {
+            parallel_for_static(*m_pool, m_gm.num_factors(), parallel_min_block_size, [&](auto block, auto begin, auto end){
+                const auto buffer = m_thread_buffers[block].data();
+                for(auto fi=begin; fi<end; ++fi)
+                {
+                    this->sendFacToVar(fi, buffer);
+                }
+            });
+            return;
+        }
+        if constexpr(narrow_messages)
+        {
+            m_gm.template for_each_factor_of_min_arity<2>([&](auto fi, auto && factor){
+                this->sendFacToVar(fi, factor, sMsgBuffer_.data());
+            });
+        }
+        else
+        {
+            m_gm.template for_each_factor_of_arity<2>([&](auto fi, auto && factor){
+                std::array<value_type *, 2>       facToVar{m_msg.facToVarMsg(fi, 0), m_msg.facToVarMsg(fi, 1)};
+                std::array<const value_type *, 2> varToFac{m_msg.oppToFacToVarMsg(fi, 0), m_msg.oppToFacToVarMsg(fi, 1)};
+                factor.factor_to_variable_messages(varToFac.data(), facToVar.data());
+            });
+            m_gm.template for_each_factor_of_min_arity<3>([&](auto fi, auto && factor){
+                this->sendFacToVar(fi, factor, sMsgBuffer_.data());
+            });
         }
     }
 
 
     void sendFacToVar(const std::size_t fi){
+        this->sendFacToVar(fi, sMsgBuffer_.data());
+    }
+
+    // buffer has room for buffer_size values
+    void sendFacToVar(const std::size_t fi, value_type * buffer){
         auto && factor = m_gm[fi];
-        const auto arity  = factor.arity();
 
-        arity_vector<value_type *>       facToVar(arity);
-        arity_vector<const value_type *> varToFac(arity);
-        for(auto i=0; i<arity; ++i){
-            facToVar[i] = m_msg.facToVarMsg(fi, i);
-            varToFac[i] = m_msg.oppToFacToVarMsg(fi, i);
+        // unaries have no messages
+        if(factor.arity() < 2){
+            return;
         }
-        factor.factor_to_variable_messages(varToFac.data(), facToVar.data());
+        this->sendFacToVar(fi, factor, buffer);
     }
 
 
     value_type sendVarToFac(const std::size_t vi){
+        return this->sendVarToFac(vi, sMsgBuffer_.data());
+    }
 
-        auto msg_squared_diff = value_type(0.0);
+    // buffer has room for the labels of vi.
+    // The messages of vi are the rows of its blocks: one pass over the
+    // incoming block accumulates the belief. Each row is then read twice,
+    // a lane wise sum gives the mean of belief - row, and a fused pass
+    // computes the outgoing message, subtracts the mean, damps it and
+    // accumulates the change. The row is still in cache for the second read.
+    value_type sendVarToFac(const std::size_t vi, value_type * buffer){
 
-        auto buffer = sMsgBuffer_.data();
+        auto msg_squared_diff = value_type(0.0);
 
         // how many labels
         const auto num_labels = m_gm.num_labels(vi);
 
-        // factors for this variable
-        auto && unaries = m_factors_of_variables[vi].unaries();
-        auto && higher_order = m_factors_of_variables[vi].higher_order();
+        // variables without factors keep their label, models
+        // with pairwise tensors have a unary for each variable
+        const auto num_rows = m_msg.num_rows(vi);
+        bool has_factors = true;
+        if constexpr(!has_pairwise_tensors<GM>::value)
+        {
+            const auto & factors = m_factors_of_variables[vi];
+            has_factors = factors.unaries().size() + num_rows > 0;
+        }
 
-        if(unaries.size() + higher_order.size() > 0)
+        if(has_factors)
         {
-            // initialize buffer
-            std::fill(buffer, buffer + num_labels, 0.0);
+            this->accumulate_belief(vi, buffer);
+
+            // all msg are summed up now therefore buffer is
+            // the actual belief vector
+            m_current_labels[vi] = std::distance(buffer, std::min_element(buffer,buffer+num_labels));
+
+            const auto belief_sum = detail::lane_sum<value_type>(buffer, num_labels);
+
+            const auto damping = m_settings.damping;
+            const auto stride = m_msg.row_stride(vi);
+            const message_type * fac_to_var = m_msg.facToVarBlock(vi);
+            message_type * var_to_fac = m_msg.varToFacBlock(vi);
+            for(std::size_t hoi=0; hoi<num_rows; ++hoi, fac_to_var += stride, var_to_fac += stride){
+                if constexpr(narrow_messages)
+                {
+                    msg_squared_diff += this->send_narrow_var_to_fac(fac_to_var, var_to_fac, buffer, belief_sum, num_labels);
+                }
+                else
+                {
+                    // the mean of belief - fac_to_var
+                    const value_type mean = (belief_sum - detail::lane_sum<value_type>(fac_to_var, num_labels)) / num_labels;
+
+                    auto update = [&](auto l){
+                        const value_type old_value = var_to_fac[l];
+                        const value_type new_value = damping * old_value + (1.0 - damping) * (buffer[l] - fac_to_var[l] - mean);
+                        var_to_fac[l] = new_value;
+                        return old_value - new_value;
+                    };
+                    if(num_labels < 2 * detail::simd_lanes)
+                    {
+                        for(label_type l=0; l<num_labels; ++l){
+                            const auto diff = update(l);
+                            msg_squared_diff += diff * diff;
+                        }
+                    }
+                    else
+                    {
+                        // lane wise st. the loop vectorizes without reassociation
+                        std::array<value_type, detail::simd_lanes> diff_lanes{};
+                        detail::for_each_lane(num_labels, [&](auto lane, auto l){
+                            const auto diff = update(l);
+                            diff_lanes[lane] += diff * diff;
+                        });
+                        for(auto lane_diff : diff_lanes){
+                            msg_squared_diff += lane_diff;
+                        }
+                    }
+                }
+            }
+        }
+        return msg_squared_diff;
+    }
+    // the min-sum belief of vi, the sum of its unaries and all
+    // incoming messages, shifted st. its minimum is zero
+    void belief(const std::size_t vi, value_type * out){
+        const auto num_labels = m_gm.num_labels(vi);
+        this->accumulate_belief(vi, out);
+        const auto min_value = *std::min_element(out, out + num_labels);
+        for(label_type l=0; l<num_labels; ++l){
+            out[l] -= min_value;
+        }
+    }
+
+private:
+
+    // energy, best labels, checkpoint and callback after each iteration
+    template<class CALLBACK>
+    void finish_iteration(CALLBACK & callback){
+        m_current_energy =  m_gm.evaluate(m_current_labels);
+        if(m_current_energy < m_best_energy)
+        {
+            m_best_energy = m_current_energy;
+            m_best_labels = m_current_labels;
+        }
+        ++m_iteration;
+        this->checkpoint_iteration(m_iteration);
+        callback();
+    }
 
-            // add unaries to buffer
-            for(auto fi : unaries)
+    template<class CALLBACK>
+    void minimize_residual(CALLBACK & callback){
+        const std::size_t num_factors = m_gm.num_factors();
+        if(m_pending_offsets.size() != num_factors)
+        {
+            // the candidate factor-to-variable messages of each factor
+            m_pending_offsets.assign(num_factors, 0);
+            std::size_t size = 0;
+            for(std::size_t fi=0; fi<num_factors; ++fi)
             {
-                m_gm[fi].add_values(buffer);
+                auto && factor = m_gm[fi];
+                m_pending_offsets[fi] = size;
+                if(factor.arity() > 1)
+                {
+                    size += factor.sum_of_shape();
+                }
             }
+            m_pending.assign(size, value_type(0));
+            m_residual_queue.resize(num_factors);
+        }
+        m_residual_queue.clear();
 
-            // higher order factors
-            for(auto hoi=0; hoi<higher_order.size(); ++hoi)
+        // variable-to-factor messages (and labels) which
+        // match the current factor-to-variable messages
+        this->sendAllVarToFac();
+        std::size_t updates_per_iteration = 0;
+        for(std::size_t fi=0; fi<num_factors; ++fi)
+        {
+            if(m_gm[fi].arity() > 1)
             {
-                const auto fac_to_var = m_msg.oppToVarToFacMsg(vi, hoi);
-                for(label_type l=0; l<num_labels; ++l)
+                ++updates_per_iteration;
+                this->update_residual(fi);
+            }
+        }
+
+        std::size_t updates = 0;
+        while(!m_residual_queue.empty() && m_iteration < m_settings.num_iterations)
+        {
+            const auto fi = m_residual_queue.pop();
+            this->commit_pending(fi);
+            auto && factor = m_gm[fi];
+            for(auto vi : factor.variables())
+            {
+                this->sendVarToFac(vi);
+                const auto & factors = m_factors_of_variables[vi];
+                for(auto other_fi : factors.higher_order())
                 {
-                    buffer[l] +=fac_to_var[l];
+                    this->update_residual(other_fi);
                 }
             }
+            if(++updates == updates_per_iteration || m_residual_queue.empty())
+            {
+                updates = 0;
+                this->finish_iteration(callback);
+            }
+        }
+    }
 
-            // all msg are summed up now therefore buffer is
-            // the actual belief vector
-            m_current_labels[vi] = std::distance(buffer, std::min_element(buffer,buffer+num_labels));
+    template<class CALLBACK>
+    void minimize_active_set(CALLBACK & callback){
+        const std::size_t num_factors = m_gm.num_factors();
+        const std::size_t num_variables = m_gm.num_variables();
+        const auto threshold = m_settings.active_threshold;
 
+        // the first iteration visits everything,
+        // a resumed run therefore starts over as well
+        m_active_factors.assign(num_factors, 1);
+        m_active_variables.assign(num_variables, 1);
+        m_previous_messages.resize(m_gm.max_arity() * m_gm.space().max_num_labels());
 
-            // compute outgoing messages
-            // - we subtract a single varToFac msg 
-            //   from belief vector 
-            for(size_t hoi=0; hoi<higher_order.size(); ++hoi){
-                // get the factor msg
-                const auto fac_to_var = m_msg.oppToVarToFacMsg(vi,hoi);
-                auto var_to_fac = m_msg.varToFacMsg(vi,hoi);
+        while(m_iteration < m_settings.num_iterations)
+        {
+            m_num_active_factors = 0;
+            for(std::size_t fi=0; fi<num_factors; ++fi)
+            {
+                if(m_active_factors[fi])
+                {
+                    m_active_factors[fi] = 0;
+                    this->send_active_fac_to_var(fi, threshold);
+                }
+            }
 
-                // calculate the mean of the new message
-                value_type mean = 0.0;
-                for(label_type l=0; l<num_labels; ++l){
-                    mean += (buffer[l] - fac_to_var[l]);
+            auto eps = value_type(0);
+            bool converged = true;
+            for(std::size_t vi=0; vi<num_variables; ++vi)
+            {
+                if(m_active_variables[vi])
+                {
+                    const auto squared_diff = this->sendVarToFac(vi);
+                    eps += squared_diff;
+
+                    // still changing: stays active and
+                    // re-activates its factors
+                    const auto changed = squared_diff > threshold * threshold;
+                    m_active_variables[vi] = changed;
+                    if(changed)
+                    {
+                        converged = false;
+                        const auto & factors = m_factors_of_variables[vi];
+                        for(auto fi : factors.higher_order())
+                        {
+                            m_active_factors[fi] = 1;
+                        }
+                    }
                 }
-                mean /= num_labels;
-
-
-                // // calculate the mean of the new message
-                // value_type min_val = (buffer[0] - fac_to_var[0]);
-                // for(label_type l=0; l<num_labels; ++l){
-                //     min_val = std::min(min_val, (buffer[l] - fac_to_var[l]));
-                // }
-              
-                // substract the mean and damp
-                for(label_type l=0; l<num_labels; ++l){
-                    const value_type oldValue = var_to_fac[l];
-                    const value_type newUndampedValue = (buffer[l] - fac_to_var[l])- mean;
-                    const value_type newDampedValue = m_settings.damping * oldValue + (1.0 - m_settings.damping)*newUndampedValue;
-                    var_to_fac[l] = newDampedValue;
-
-                    //std::cout<<oldValue<<" "<<newUndampedValue<<"\n";
-                    // convergence accumulation
-                    const value_type diff = oldValue-newDampedValue;
-                    msg_squared_diff += diff*diff;
+            }
+            eps /= m_msg.nMsg();
+            this->finish_iteration(callback);
+
+            if(converged || eps < m_settings.convergence)
+            {
+                break;
+            }
+        }
+    }
+
+    // update the factor-to-variable messages of fi and activate the
+    // variables whose message changed by more than threshold
+    void send_active_fac_to_var(const std::size_t fi, const value_type threshold){
+        auto && factor = m_gm[fi];
+        const auto arity = factor.arity();
+        if(arity < 2){
+            return;
+        }
+        ++m_num_active_factors;
+        auto previous = m_previous_messages.data();
+        for(auto i=0; i<arity; ++i){
+            const auto msg = m_msg.facToVarMsg(fi, i);
+            std::copy(msg, msg + factor.shape(i), previous);
+            previous += factor.shape(i);
+        }
+        this->sendFacToVar(fi);
+
+        previous = m_previous_messages.data();
+        auto && variables = factor.variables();
+        for(auto i=0; i<arity; ++i){
+            const auto msg = m_msg.facToVarMsg(fi, i);
+            const auto num_labels = factor.shape(i);
+            for(std::size_t l=0; l<num_labels; ++l){
+                if(std::abs(value_type(msg[l]) - value_type(previous[l])) > threshold){
+                    m_active_variables[variables[i]] = 1;
+                    break;
                 }
             }
+            previous += num_labels;
+        }
+    }
+
+    // compute the candidate messages of fi and
+    // queue fi if they differ from the current ones
+    void update_residual(const std::size_t fi){
+        auto && factor = m_gm[fi];
+        const auto arity = factor.arity();
+        arity_vector<value_type *>       pending(arity);
+        auto offset = m_pending_offsets[fi];
+        for(auto i=0; i<arity; ++i){
+            pending[i] = m_pending.data() + offset;
+            offset += factor.shape(i);
+        }
+        if constexpr(narrow_messages)
+        {
+            this->compute_narrow_messages(fi, factor, pending.data(), sMsgBuffer_.data());
+        }
+        else
+        {
+            arity_vector<const value_type *> varToFac(arity);
+            for(auto i=0; i<arity; ++i){
+                varToFac[i] = m_msg.oppToFacToVarMsg(fi, i);
+            }
+            factor.factor_to_variable_messages(varToFac.data(), pending.data());
+        }
+
+        // the change of the stored (rounded) messages
+        auto residual = value_type(0);
+        for(auto i=0; i<arity; ++i){
+            const auto facToVar = m_msg.facToVarMsg(fi, i);
+            for(std::size_t l=0; l<factor.shape(i); ++l){
+                const value_type candidate = message_type(pending[i][l]);
+                residual = std::max(residual, value_type(std::abs(candidate - value_type(facToVar[l]))));
+            }
+        }
+        if(residual > m_settings.residual_threshold){
+            m_residual_queue.push(fi, residual);
+        }
+        else{
+            m_residual_queue.erase(fi);
         }
-        return msg_squared_diff;
     }
-private:
 
+    void commit_pending(const std::size_t fi){
+        auto && factor = m_gm[fi];
+        auto pending = m_pending.data() + m_pending_offsets[fi];
+        for(auto i=0; i<factor.arity(); ++i){
+            const auto size = factor.shape(i);
+            convert(pending, size, m_msg.facToVarMsg(fi, i));
+            pending += size;
+        }
+    }
+
+    void accumulate_belief(const std::size_t vi, value_type * buffer){
+        const auto num_labels = m_gm.num_labels(vi);
+
+        // initialize buffer, either with the row of the
+        // dense unary block or with zeros
+        if(m_dense_unaries)
+        {
+            const auto row = m_dense_unaries[vi];
+            std::copy(row, row + num_labels, buffer);
+        }
+        else
+        {
+            std::fill(buffer, buffer + num_labels, 0.0);
+        }
 
+        // add (remaining) unaries to buffer, models with
+        // pairwise tensors keep all of them in the dense block
+        if constexpr(!has_pairwise_tensors<GM>::value)
+        {
+            const auto & factors = m_factors_of_variables[vi];
+            for(auto fi : factors.unaries())
+            {
+                if(!m_dense_unaries.contains_factor(fi))
+                {
+                    m_gm[fi].add_values(buffer);
+                }
+            }
+        }
 
+        // higher order factors, the rows of the incoming block
+        const auto stride = m_msg.row_stride(vi);
+        const auto num_rows = m_msg.num_rows(vi);
+        const message_type * fac_to_var = m_msg.facToVarBlock(vi);
+        for(std::size_t hoi=0; hoi<num_rows; ++hoi, fac_to_var += stride)
+        {
+            for(label_type l=0; l<num_labels; ++l)
+            {
+                buffer[l] += fac_to_var[l];
+            }
+        }
+    }
+
+    // the pairwise factors num_variables + [e_begin, e_end) of a
+    // model with pairwise tensors, the tensors are called qualified
+    // st. no virtual call is needed
+    void send_pairwise_fac_to_var(const std::size_t e_begin, const std::size_t e_end, value_type * buffer){
+        m_gm.for_each_pairwise_tensor(e_begin, e_end, [&](const std::size_t fi, auto && tensor){
+            if constexpr(narrow_messages)
+            {
+                this->sendFacToVar(fi, tensor, buffer);
+            }
+            else
+            {
+                using tensor_t = std::decay_t<decltype(tensor)>;
+                std::array<value_type *, 2>       facToVar{m_msg.facToVarMsg(fi, 0), m_msg.facToVarMsg(fi, 1)};
+                std::array<const value_type *, 2> varToFac{m_msg.oppToFacToVarMsg(fi, 0), m_msg.oppToFacToVarMsg(fi, 1)};
+                tensor.tensor_t::factor_to_variable_messages(varToFac.data(), facToVar.data());
+            }
+        });
+    }
+
+    template<class FACTOR>
+    void sendFacToVar(const std::size_t fi, FACTOR && factor, value_type * buffer){
+        const auto arity  = factor.arity();
+        arity_vector<value_type *>       facToVar(arity);
+        if constexpr(narrow_messages)
+        {
+            const auto max_num_labels = m_gm.space().max_num_labels();
+            for(auto i=0; i<arity; ++i){
+                facToVar[i] = buffer + (arity + i) * max_num_labels;
+            }
+            this->compute_narrow_messages(fi, factor, facToVar.data(), buffer);
+            for(auto i=0; i<arity; ++i){
+                convert(facToVar[i], factor.shape(i), m_msg.facToVarMsg(fi, i));
+            }
+        }
+        else
+        {
+            arity_vector<const value_type *> varToFac(arity);
+            for(auto i=0; i<arity; ++i){
+                facToVar[i] = m_msg.facToVarMsg(fi, i);
+                varToFac[i] = m_msg.oppToFacToVarMsg(fi, i);
+            }
+            factor.factor_to_variable_messages(varToFac.data(), facToVar.data());
+        }
+    }
+
+    // the factor-to-variable messages of fi in full precision from its
+    // narrow variable-to-factor messages, which are converted in the
+    // first arity * max_num_labels values of buffer. The messages are
+    // shifted st. their minimum is zero.
+    template<class FACTOR>
+    void compute_narrow_messages(const std::size_t fi, FACTOR && factor, value_type ** out, value_type * buffer){
+        const auto arity  = factor.arity();
+        const auto max_num_labels = m_gm.space().max_num_labels();
+        arity_vector<const value_type *> varToFac(arity);
+        for(auto i=0; i<arity; ++i){
+            const auto msg = m_msg.oppToFacToVarMsg(fi, i);
+            const auto in = buffer + i * max_num_labels;
+            convert(msg, factor.shape(i), in);
+            varToFac[i] = in;
+        }
+        factor.factor_to_variable_messages(varToFac.data(), out);
+        for(auto i=0; i<arity; ++i){
+            const auto num_labels = factor.shape(i);
+            const auto min_value = *std::min_element(out[i], out[i] + num_labels);
+            for(std::size_t l=0; l<num_labels; ++l){
+                out[i][l] -= min_value;
+            }
+        }
+    }
+
+    // the update of one narrow row of sendVarToFac: the rows are
+    // converted to value_type rows after the belief in buffer, updated
+    // there and stored again. Returns the squared change of the stored row.
+    value_type send_narrow_var_to_fac(const message_type * fac_to_var, message_type * var_to_fac,
+        value_type * buffer, const value_type belief_sum, const std::size_t num_labels
+    ){
+        const auto max_num_labels = m_gm.space().max_num_labels();
+        const auto in = buffer + max_num_labels;
+        const auto old_values = in + max_num_labels;
+        const auto new_values = old_values + max_num_labels;
+        convert(fac_to_var, num_labels, in);
+        convert(var_to_fac, num_labels, old_values);
+
+        const auto damping = m_settings.damping;
+        const value_type mean = (belief_sum - detail::lane_sum<value_type>(in, num_labels)) / num_labels;
+        for(std::size_t l=0; l<num_labels; ++l){
+            new_values[l] = damping * old_values[l] + (1.0 - damping) * (buffer[l] - in[l] - mean);
+        }
+        convert(new_values, num_labels, var_to_fac);
+        convert(var_to_fac, num_labels, new_values);
+
+        std::array<value_type, detail::simd_lanes> diff_lanes{};
+        detail::for_each_lane(num_labels, [&](auto lane, auto l){
+            const auto diff = old_values[l] - new_values[l];
+            diff_lanes[lane] += diff * diff;
+        });
+        return std::accumulate(diff_lanes.begin(), diff_lanes.end(), value_type(0));
+    }
+
+    // values per scratch buffer: a belief, narrow messages additionally
+    // convert the messages of a factor or three rows of a variable in it
+    static std::size_t buffer_size(const std::size_t max_num_labels, const std::size_t max_arity){
+        return narrow_messages ? std::max<std::size_t>(2 * max_arity, 4) * max_num_labels : max_num_labels;
+    }
+
+    // factors (variables) per block of the parallel schedule
+    static constexpr std::size_t parallel_min_block_size = 256;
 
     const gm_type & m_gm;
     Settings m_settings;
     factors_of_variables_type m_factors_of_variables;
-    detail::MessageStoring<GM> m_msg;
+    detail::MessageStoring<GM, message_type> m_msg;
     value_type m_current_energy;
     value_type m_best_energy;
     labels_vector_type m_current_labels;
     labels_vector_type m_best_labels;
     std::vector<value_type> sMsgBuffer_;
+    DenseUnaries<value_type> m_dense_unaries;
+
+    // parallel schedule, the pool is only set during minimize
+    ThreadPool * m_pool;
+    std::vector<std::vector<value_type>> m_thread_buffers;
+    std::vector<value_type> m_variable_eps;
+
+    // residual schedule
+    std::vector<std::size_t> m_pending_offsets;
+    std::vector<value_type> m_pending;
+    IndexedPriorityQueue<value_type> m_residual_queue;
+
+    // active set schedule
+    std::vector<std::uint8_t> m_active_factors;
+    std::vector<std::uint8_t> m_active_variables;
+    std::vector<message_type> m_previous_messages;
+    std::size_t m_num_active_factors;
+
+    std::size_t m_iteration{0};
+    bool m_resumed{false};
 
 
 };
 
 
 
-template<class GM>
-using BeliefePropergationFactory = MinimizerFactory<BeliefPropergation<GM>>;
+template<class GM, class MESSAGE_TYPE = typename GM::value_type>
+using BeliefePropergationFactory = MinimizerFactory<BeliefPropergation<GM, MESSAGE_TYPE>>;
 
 
 
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+#include "opengm/datastructures/partition.hpp"
+#include "opengm/tensor_view_gm.hpp"
+#include "opengm/thread_pool.hpp"
+#include "opengm/minimizer/minimizer_base.hpp"
+
+namespace opengm{
+
+
+// Splits a model into its connected components and minimizes
+// each component independently with a minimizer created by
+// settings.minimizer_factory.
+// The submodels are TensorViewGm's which point to the tensors
+// of the original model if its factors own their tensors (as for
+// GraphicalModel and TensorViewGm). The tensors of factor proxies
+// (e.g. of GridGm) are cloned per factor.
+// Components are solved on a thread pool, largest first.
+// Variables without any factor keep their starting label
+// (0 if no starting point is set).
+template<class GM>
+class ComponentDecomposition : public MinimizerCrtpBase<GM, ComponentDecomposition<GM> >{
+public:
+    using gm_type = GM;
+    using base_type = MinimizerBase<GM>;
+    using value_type = typename GM::value_type;
+    using label_type = typename GM::label_type;
+    using labels_vector_type = typename base_type::labels_vector_type;
+    using minimizer_callback_base_ptr_type = typename base_type::minimizer_callback_base_ptr_type;
+
+    using subspace_type = typename gm_type::space_type::subspace_type;
+    using sub_gm_type = TensorViewGm<subspace_type, value_type>;
+
+    using sub_minimizer_factory_base_type = MinimizerFactoryBase<sub_gm_type>;
+    using sub_minimizer_factory_ptr_type = std::shared_ptr<sub_minimizer_factory_base_type>;
+
+    using base_type::minimize;
+    using base_type::set_starting_point;
+
+    struct settings_type : public SolverSettingsBase{
+        sub_minimizer_factory_ptr_type minimizer_factory;
+        // 0 means one thread per core
+        std::size_t num_threads{0};
+    };
+
+    ComponentDecomposition(const GM & gm, const settings_type & settings = settings_type())
+    :   m_gm(gm),
+        m_settings(settings),
+        m_labels(gm.num_variables(), 0),
+        m_energy(),
+        m_sub_gms(),
+        m_owned_tensors(),
+        m_component_variables(),
+        m_component_energies()
+    {
+        if(!m_settings.minimizer_factory){
+            throw std::runtime_error("ComponentDecomposition needs a minimizer_factory");
+        }
+        this->find_components();
+        m_energy = m_gm.evaluate(m_labels);
+    }
+
+    std::string name() const override{
+        return "ComponentDecomposition";
+    }
+
+    // the component models, the minimizers of the
+    // components only exist during minimize
+    void add_buffer_memory(MemoryStats & stats) const override{
+        auto & bytes = stats.buffers["components"];
+        bytes += detail::heap_bytes(m_sub_gms) + detail::heap_bytes(m_component_variables);
+        for(auto && sub_gm : m_sub_gms){
+            bytes += sub_gm.memory_stats().model_bytes();
+        }
+        stats.buffers["labels"] += detail::heap_bytes(m_labels);
+    }
+
+    const gm_type & gm() const override{
+        return m_gm;
+    }
+
+    const labels_vector_type & best_labels()override{
+        return m_labels;
+    }
+    const labels_vector_type & current_labels() override{
+        return m_labels;
+    }
+
+    value_type best_energy()  override{
+        return m_energy;
+    }
+    value_type current_energy() override {
+        return m_energy;
+    }
+
+    bool can_start_from_starting_point() override{
+        return true;
+    }
+    void set_starting_point(const label_type  * labels)override{
+        m_labels.assign(labels, labels + m_gm.num_variables());
+    }
+
+    void minimize(minimizer_callback_base_ptr_type minimizer_callback_base_ptr)override{
+        auto callback = callback_wrapper(this, minimizer_callback_base_ptr);
+
+        const auto num_components = m_sub_gms.size();
+        m_component_energies.assign(num_components, value_type(0));
+
+        // largest components first st. a huge component
+        // does not end up as the last task of the pool
+        std::vector<std::size_t> order(num_components);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](auto a, auto b){
+            return this->work(a) > this->work(b);
+        });
+
+        // each component writes to a disjoint set of labels
+        auto solve = [this](const std::size_t ci){
+            auto && sub_gm = m_sub_gms[ci];
+            auto && variables = m_component_variables[ci];
+            auto minimizer = m_settings.minimizer_factory->create(sub_gm);
+            if(minimizer->can_start_from_starting_point()){
+                labels_vector_type sub_labels(variables.size());
+                for(std::size_t svi=0; svi<variables.size(); ++svi){
+                    sub_labels[svi] = m_labels[variables[svi]];
+                }
+                minimizer->set_starting_point(sub_labels);
+            }
+            minimizer->minimize();
+            auto && sub_labels = minimizer->best_labels();
+            for(std::size_t svi=0; svi<variables.size(); ++svi){
+                m_labels[variables[svi]] = sub_labels[svi];
+            }
+            m_component_energies[ci] = minimizer->best_energy();
+        };
+
+        const auto num_threads = m_settings.num_threads == 0 ? default_num_threads() : m_settings.num_threads;
+        if(num_threads <= 1 || num_components <= 1){
+            for(auto ci : order){
+                solve(ci);
+            }
+        }
+        else{
+            ThreadPool pool(std::min(num_threads, num_components));
+            for(auto ci : order){
+                pool.enqueue([&solve, ci](){
+                    solve(ci);
+                });
+            }
+            pool.wait();
+        }
+
+        m_energy = m_gm.evaluate(m_labels);
+        callback();
+    }
+
+    std::size_t num_components()const{
+        return m_sub_gms.size();
+    }
+    // the submodel of component ci, variable svi of the
+    // submodel is the variable component_variables(ci)[svi]
+    const sub_gm_type & component_gm(const std::size_t ci)const{
+        return m_sub_gms[ci];
+    }
+    const std::vector<std::size_t> & component_variables(const std::size_t ci)const{
+        return m_component_variables[ci];
+    }
+    // energies of the components found by the last call of minimize
+    const std::vector<value_type> & component_energies()const{
+        return m_component_energies;
+    }
+
+private:
+
+    std::size_t work(const std::size_t ci)const{
+        return m_sub_gms[ci].num_variables() + m_sub_gms[ci].num_index_entries();
+    }
+
+    void find_components(){
+        const auto num_variables = m_gm.num_variables();
+        const auto num_factors = m_gm.num_factors();
+        constexpr auto none = std::numeric_limits<std::size_t>::max();
+
+        Partition<std::size_t> partition(num_variables);
+        std::vector<bool> has_factor(num_variables, false);
+        for(std::size_t fi=0; fi<num_factors; ++fi){
+            auto && variables = m_gm[fi].variables();
+            for(auto vi : variables){
+                has_factor[vi] = true;
+            }
+            for(std::size_t a=1; a<variables.size(); ++a){
+                partition.merge(variables[0], variables[a]);
+            }
+        }
+
+        // dense component ids in the order of the smallest variable
+        std::vector<std::size_t> component_of_root(num_variables, none);
+        std::vector<std::size_t> component(num_variables, none);
+        std::vector<std::size_t> local_vi(num_variables, none);
+        for(std::size_t vi=0; vi<num_variables; ++vi){
+            if(!has_factor[vi]){
+                continue;
+            }
+            const auto root = partition.find(vi);
+            if(component_of_root[root] == none){
+                component_of_root[root] = m_component_variables.size();
+                m_component_variables.emplace_back();
+            }
+            const auto ci = component_of_root[root];
+            component[vi] = ci;
+            local_vi[vi] = m_component_variables[ci].size();
+            m_component_variables[ci].push_back(vi);
+        }
+        const auto num_components = m_component_variables.size();
+
+        std::vector<std::size_t> num_component_factors(num_components, 0);
+        std::vector<std::size_t> num_component_entries(num_components, 0);
+        for(std::size_t fi=0; fi<num_factors; ++fi){
+            auto && variables = m_gm[fi].variables();
+            if(variables.size() > 0){
+                const auto ci = component[variables[0]];
+                ++num_component_factors[ci];
+                num_component_entries[ci] += variables.size();
+            }
+        }
+
+        m_sub_gms.reserve(num_components);
+        for(std::size_t ci=0; ci<num_components; ++ci){
+            auto && variables = m_component_variables[ci];
+            m_sub_gms.emplace_back(m_gm.space().subspace(variables.begin(), variables.end()));
+            m_sub_gms.back().reserve(num_component_factors[ci], num_component_entries[ci]);
+        }
+
+        // the tensor of a factor proxy dies with the proxy
+        constexpr bool stable_tensors = std::is_reference<decltype(m_gm[std::size_t(0)])>::value;
+        if constexpr(!stable_tensors){
+            m_owned_tensors.reserve(num_factors);
+        }
+        std::vector<std::size_t> sub_variables(m_gm.max_arity());
+        for(std::size_t fi=0; fi<num_factors; ++fi){
+            auto && factor = m_gm[fi];
+            auto && variables = factor.variables();
+            if(variables.size() == 0){
+                continue;
+            }
+            for(std::size_t a=0; a<variables.size(); ++a){
+                sub_variables[a] = local_vi[variables[a]];
+            }
+            const TensorBase<value_type> * tensor = factor.tensor();
+            if constexpr(!stable_tensors){
+                m_owned_tensors.push_back(tensor->clone());
+                tensor = m_owned_tensors.back().get();
+            }
+            m_sub_gms[component[variables[0]]].add_factor(
+                tensor,
+                sub_variables.begin(),
+                sub_variables.begin() + variables.size()
+            );
+        }
+    }
+
+    const GM & m_gm;
+    settings_type m_settings;
+    std::vector<label_type> m_labels;
+    value_type m_energy;
+
+    std::vector<sub_gm_type> m_sub_gms;
+    // clones of the tensors of factor proxies
+    std::vector<std::unique_ptr<TensorBase<value_type>>> m_owned_tensors;
+    std::vector<std::vector<std::size_t>> m_component_variables;
+    std::vector<value_type> m_component_energies;
+};
+
+template<class GM>
+using ComponentDecompositionFactory = MinimizerFactory<ComponentDecomposition<GM>>;
+}
@@ -20,7 +20,10 @@ public:
     using labels_vector_type = typename base_type::labels_vector_type;
     using minimizer_callback_base_ptr_type = typename base_type::minimizer_callback_base_ptr_type;
 
+    using factors_of_variables_type = HigherOrderAndUnaryFactorsOfVariables<GM>;
+
     using base_type::minimize;
+    using base_type::model_changed;
 
     struct settings_type : public SolverSettingsBase{
         std::vector<std::size_t> roots;
@@ -38,7 +41,8 @@ public:
         m_value_buffers(gm.num_variables()),
         m_state_buffers(gm.num_variables()),
         m_node_order(gm.num_variables(), std::numeric_limits<std::size_t>::max() ),
-        m_ordered_nodes(gm.num_variables(), std::numeric_limits<std::size_t>::max() )
+        m_ordered_nodes(gm.num_variables(), std::numeric_limits<std::size_t>::max() ),
+        m_dense_unaries(dense_unaries_of(gm))
     {
 
         if(m_gm.max_arity() > 2)
@@ -73,21 +77,19 @@ public:
             while(node_list.size()>0){
                 size_t node = node_list.back();
                 node_list.pop_back();
-                for(auto && fid: m_factors_of_variables[node])
+                const auto & factors = m_factors_of_variables[node];
+                for(auto && fid: factors.higher_order())
                 {
-                    auto && factor = m_gm[fid];
-                    auto && variables = factor.variables();
-                    if( factor.arity() == 2 ){
-                        if(variables[1] == node && m_node_order[variables[0]]==mxval ){
-                            m_node_order[variables[0]] = order_count++;
-                            node_list.push_back(variables[0]);
-                            ++num_children[node];
-                        }
-                        if( variables[0] == node && m_node_order[variables[1]]==mxval ){
-                            m_node_order[variables[1]] = order_count++;
-                            node_list.push_back(variables[1]);
-                            ++num_children[node];
-                        }
+                    auto && variables = m_gm[fid].variables();
+                    if(variables[1] == node && m_node_order[variables[0]]==mxval ){
+                        m_node_order[variables[0]] = order_count++;
+                        node_list.push_back(variables[0]);
+                        ++num_children[node];
+                    }
+                    if( variables[0] == node && m_node_order[variables[1]]==mxval ){
+                        m_node_order[variables[1]] = order_count++;
+                        node_list.push_back(variables[1]);
+                        ++num_children[node];
                     }
                 }
             }
@@ -122,6 +124,32 @@ public:
         return "DynamicProgramming";
     }
 
+    void add_buffer_memory(MemoryStats & stats) const override{
+        stats.buffers["factors_of_variables"] += m_factors_of_variables.memory_usage();
+        stats.buffers["labels"] += detail::heap_bytes(m_labels);
+        stats.buffers["values"] += detail::heap_bytes(m_value_buffer) + detail::heap_bytes(m_value_buffers);
+        stats.buffers["states"] += detail::heap_bytes(m_state_buffer) + detail::heap_bytes(m_state_buffers);
+        stats.buffers["node_order"] += detail::heap_bytes(m_node_order) + detail::heap_bytes(m_ordered_nodes);
+    }
+
+    // predict the buffers of a DynamicProgramming for a model
+    // with the given statistics before constructing it.
+    // The states are bounded by assuming every child variable
+    // has max_num_labels labels.
+    static MemoryStats estimate_memory(const ModelStatistics & model_stats, const settings_type & settings = settings_type()){
+        const auto num_variables = model_stats.num_variables;
+        // each second order factor of a forest adds one child
+        const auto num_children = model_stats.num_higher_order_index_entries / 2;
+        MemoryStats stats;
+        stats.buffers["factors_of_variables"] += num_variables * sizeof(typename factors_of_variables_type::value_type) +
+            model_stats.num_index_entries * sizeof(std::size_t);
+        stats.buffers["labels"] += num_variables * sizeof(label_type);
+        stats.buffers["values"] += model_stats.sum_of_num_labels * sizeof(value_type) + num_variables * sizeof(value_type *);
+        stats.buffers["states"] += num_children * model_stats.max_num_labels * sizeof(label_type) + num_variables * sizeof(label_type *);
+        stats.buffers["node_order"] += 2 * num_variables * sizeof(std::size_t);
+        return stats;
+    }
+
     const gm_type & gm() const override{
         return m_gm;
     }
@@ -145,6 +173,12 @@ public:
         return false;
     }
 
+    // the node order and all buffers are kept,
+    // the next minimize only recomputes the values
+    void model_changed() override{
+        m_energy = m_gm.evaluate(m_labels);
+    }
+
     void minimize(minimizer_callback_base_ptr_type minimizer_callback_base_ptr)override {
         m_energy = m_gm.evaluate(m_labels);
         auto callback = callback_wrapper(this, minimizer_callback_base_ptr);
@@ -154,70 +188,81 @@ public:
         {
             // std::cout<<" ii "<< i<<"\n";
             const auto node = m_ordered_nodes[m_gm.num_variables() - i];
+            if(i < m_gm.num_variables()){
+                auto && next_factors = m_factors_of_variables[m_ordered_nodes[m_gm.num_variables() - i - 1]];
+                prefetch_factors(m_gm, next_factors.unaries().begin(), next_factors.unaries().end());
+                prefetch_factors(m_gm, next_factors.higher_order().begin(), next_factors.higher_order().end());
+            }
 
-            std::fill(m_value_buffers[node], m_value_buffers[node] + m_gm.num_labels(node), value_type(0));
-
-            // accumulate messages
-            std::size_t children_counter = 0;
-            for(auto fid: m_factors_of_variables[node])
+            if(m_dense_unaries)
             {
-                auto && factor = m_gm[fid];
+                const auto row = m_dense_unaries[node];
+                std::copy(row, row + m_gm.num_labels(node), m_value_buffers[node]);
+            }
+            else
+            {
+                std::fill(m_value_buffers[node], m_value_buffers[node] + m_gm.num_labels(node), value_type(0));
+            }
 
-                // unary
-                if (factor.arity() == 1)
+            // unaries
+            auto && factors = m_factors_of_variables[node];
+            for(auto fid: factors.unaries())
+            {
+                if (!m_dense_unaries.contains_factor(fid))
                 {
-                    factor.add_values(m_value_buffers[node]);
+                    m_gm[fid].add_values(m_value_buffers[node]);
                 }
+            }
 
-                //pairwise
-                if (factor.arity() == 2)
+            // accumulate messages of the pairwise factors
+            std::size_t children_counter = 0;
+            for(auto fid: factors.higher_order())
+            {
+                auto && factor = m_gm[fid];
+                auto && vars =  factor.variables();
+                if (vars[0] == node && m_node_order[vars[1]] > m_node_order[node])
                 {
-
-                    auto && vars =  factor.variables();
-                    if (vars[0] == node && m_node_order[vars[1]] > m_node_order[node])
+                    const auto node2 = vars[1];
+                    label_type s;
+                    value_type v;
+                    for(auto l0=0; l0<m_gm.num_labels(node); ++l0)
                     {
-                        const auto node2 = vars[1];
-                        label_type s;
-                        value_type v;
-                        for(auto l0=0; l0<m_gm.num_labels(node); ++l0)
+                        v=std::numeric_limits<value_type>::infinity();
+                        for(auto l1=0; l1<m_gm.num_labels(node2); ++l1)
                         {
-                            v=std::numeric_limits<value_type>::infinity();
-                            for(auto l1=0; l1<m_gm.num_labels(node2); ++l1)
+                            const auto factor_value = factor(l0, l1);
+                            const auto v2 = factor_value + m_value_buffers[node2][l1];
+                            if(v2 < v)
                             {
-                                const auto factor_value = factor(l0, l1);
-                                const auto v2 = factor_value + m_value_buffers[node2][l1];
-                                if(v2 < v)
-                                {
-                                    v = v2;
-                                    s = l1;
-                                }
+                                v = v2;
+                                s = l1;
                             }
-                            m_state_buffers[node][children_counter * m_gm.num_labels(node) + l0] = s;
-                            m_value_buffers[node][l0] += v;
                         }
-                        ++children_counter;
-
+                        m_state_buffers[node][children_counter * m_gm.num_labels(node) + l0] = s;
+                        m_value_buffers[node][l0] += v;
                     }
-                    if (vars[1] == node && m_node_order[vars[0]] > m_node_order[node])
-                    {
-                        const auto node2 = vars[0];
-                        label_type s;
-                        value_type v;
-                        for (auto l1 = 0; l1 < m_gm.num_labels(node); ++l1) {
-                            v=std::numeric_limits<value_type>::infinity();
-                            for (auto l0 = 0; l0 < m_gm.num_labels(node2); ++l0) {
-                                const auto factor_value = factor(l0, l1);
-                                const auto v2 = factor_value + m_value_buffers[node2][l0];
-                                if (v2 < v) {
-                                    v = v2;
-                                    s = l0;
-                                }
+                    ++children_counter;
+
+                }
+                if (vars[1] == node && m_node_order[vars[0]] > m_node_order[node])
+                {
+                    const auto node2 = vars[0];
+                    label_type s;
+                    value_type v;
+                    for (auto l1 = 0; l1 < m_gm.num_labels(node); ++l1) {
+                        v=std::numeric_limits<value_type>::infinity();
+                        for (auto l0 = 0; l0 < m_gm.num_labels(node2); ++l0) {
+                            const auto factor_value = factor(l0, l1);
+                            const auto v2 = factor_value + m_value_buffers[node2][l0];
+                            if (v2 < v) {
+                                v = v2;
+                                s = l0;
                             }
-                            m_state_buffers[node][children_counter * m_gm.num_labels(node) + l1] = s;
-                            m_value_buffers[node][l1] += v;
                         }
-                        ++children_counter;
+                        m_state_buffers[node][children_counter * m_gm.num_labels(node) + l1] = s;
+                        m_value_buffers[node][l1] += v;
                     }
+                    ++children_counter;
                 }
             }
         }
@@ -253,23 +298,19 @@ private:
                 node_list.pop_back();
 
 
-                for(auto && fid: m_factors_of_variables[node])
+                const auto & factors = m_factors_of_variables[node];
+                for(auto && fid: factors.higher_order())
                 {
-                    auto && factor = m_gm[fid];
-                    auto && vars = factor.variables();
-
-                    if (factor.arity() == 2)
-                    {
-                        if (vars[1] == node && m_node_order[vars[0]] > m_node_order[node]) {
-                            m_labels[vars[0]] = m_state_buffers[node][children_counter * m_gm.num_labels(node) + m_labels[node]];
-                            node_list.push_back(vars[0]);
-                            ++children_counter;
-                        }
-                        if (vars[0] == node && m_node_order[vars[1]] > m_node_order[node]) {
-                            m_labels[vars[1]] = m_state_buffers[node][children_counter * m_gm.num_labels(node) + m_labels[node]];
-                            node_list.push_back(vars[1]);
-                            ++children_counter;
-                        }
+                    auto && vars = m_gm[fid].variables();
+                    if (vars[1] == node && m_node_order[vars[0]] > m_node_order[node]) {
+                        m_labels[vars[0]] = m_state_buffers[node][children_counter * m_gm.num_labels(node) + m_labels[node]];
+                        node_list.push_back(vars[0]);
+                        ++children_counter;
+                    }
+                    if (vars[0] == node && m_node_order[vars[1]] > m_node_order[node]) {
+                        m_labels[vars[1]] = m_state_buffers[node][children_counter * m_gm.num_labels(node) + m_labels[node]];
+                        node_list.push_back(vars[1]);
+                        ++children_counter;
                     }
                 }
             }
@@ -278,7 +319,7 @@ private:
 
     const GM & m_gm;
     settings_type m_settings;
-    FactorsOfVariables<GM> m_factors_of_variables;
+    factors_of_variables_type m_factors_of_variables;
     value_type m_energy;
     std::vector<label_type> m_labels;
 
@@ -289,6 +330,7 @@ private:
     std::vector<label_type*> m_state_buffers;
     std::vector<std::size_t> m_node_order;
     std::vector<std::size_t> m_ordered_nodes;
+    DenseUnaries<value_type> m_dense_unaries;
 };
 
 template<class GM>
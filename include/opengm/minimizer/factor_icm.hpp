@@ -3,6 +3,7 @@
 #include <queue>
 #include <algorithm>
 #include <map>
+#include <set>
 
 #include "opengm/minimizer/minimizer_base.hpp"
 #include "opengm/minimizer/utils/movemaker.hpp"
@@ -80,16 +81,9 @@ public:
             {
                 break;
             }
+            this->prefetch_next();
             auto && factor = m_gm[fi];
 
-
-
-            std::stringstream conf_pre;
-            for(auto i=0; i<m_gm.num_variables();++i){
-                conf_pre<<this->best_labels()[i]<<" ";
-            }
-
-
             // move the variables of that factor optimal
             auto && variables = factor.variables();
             this->m_movemaker.move_brute_force_optimal(variables.begin(), variables.end(),[&](auto & involved_factors){
@@ -157,6 +151,17 @@ private:
     }
 
 
+    // hint the factor which is popped next
+    void prefetch_next()const{
+        for(auto & kv : m_dirty){
+            if(!kv.second.empty()){
+                const auto fi = kv.second.front();
+                prefetch_factors(m_gm, &fi, &fi + 1);
+                return;
+            }
+        }
+    }
+
     auto try_add_to_queue(const std::size_t fi){
         if(!m_in_queue[fi]){
             m_in_queue[fi] = true;
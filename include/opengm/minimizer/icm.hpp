@@ -41,6 +41,26 @@ public:
         return "Icm";
     }
 
+    void add_buffer_memory(MemoryStats & stats) const override{
+        stats.buffers["factors_of_variables"] += m_factors_of_variables.memory_usage();
+        stats.buffers["labels"] += detail::heap_bytes(m_labels) + detail::heap_bytes(m_factor_labels);
+        stats.buffers["values"] += detail::heap_bytes(m_value_buffer);
+        stats.buffers["queue"] += m_in_queue.capacity() / 8 + m_dirty.size() * sizeof(std::size_t);
+    }
+
+    // predict the buffers of an Icm for a model with the
+    // given statistics before constructing it
+    static MemoryStats estimate_memory(const ModelStatistics & model_stats, const settings_type & settings = settings_type()){
+        const auto num_variables = model_stats.num_variables;
+        MemoryStats stats;
+        stats.buffers["factors_of_variables"] += num_variables * sizeof(std::vector<std::size_t>) +
+            model_stats.num_index_entries * sizeof(std::size_t);
+        stats.buffers["labels"] += (num_variables + model_stats.max_arity) * sizeof(label_type);
+        stats.buffers["values"] += model_stats.max_num_labels * sizeof(value_type);
+        stats.buffers["queue"] += num_variables / 8;
+        return stats;
+    }
+
     const gm_type & gm() const override{
         return m_gm;
     }
@@ -65,6 +85,27 @@ public:
     }
     void set_starting_point(const label_type  * labels)override{
         m_labels.assign(labels, labels + m_gm.num_variables());
+        m_all_dirty = true;
+    }
+
+    void model_changed() override{
+        m_energy = m_gm.evaluate(m_labels);
+        m_all_dirty = true;
+    }
+
+    // after a minimize the labels are a local optimum, therefore only
+    // the changed variables need to be revisited by the next minimize.
+    // A changed factor of vi also changes the local optimum of the other
+    // variables of the factor, hence the neighbours are revisited as well.
+    void model_changed(gsl::span<const std::size_t> variables) override{
+        m_energy = m_gm.evaluate(m_labels);
+        for(auto vi : variables){
+            if(!m_in_queue[vi]){
+                m_in_queue[vi] = true;
+                m_dirty.push(vi);
+            }
+            this->set_neighbours_dirty(vi);
+        }
     }
 
     void minimize(minimizer_callback_base_ptr_type minimizer_callback_base_ptr)override{
@@ -72,10 +113,16 @@ public:
 
         m_energy = m_gm.evaluate(m_labels);
 
-        // start with all variables on the queue
-        for(std::size_t vi=0; vi<m_gm.size(); ++vi){
-            m_dirty.push(vi);
-            m_in_queue[vi] = true;
+        // start with all variables on the queue unless only
+        // a few variables changed since the last minimize
+        if(m_all_dirty){
+            for(std::size_t vi=0; vi<m_gm.size(); ++vi){
+                if(!m_in_queue[vi]){
+                    m_dirty.push(vi);
+                    m_in_queue[vi] = true;
+                }
+            }
+            m_all_dirty = false;
         }
 
         while(!m_dirty.empty())
@@ -84,6 +131,10 @@ public:
             auto vi = m_dirty.front();
             m_in_queue[vi] = false;
             m_dirty.pop();
+            if(!m_dirty.empty()){
+                auto && next_factors = m_factors_of_variables[m_dirty.front()];
+                prefetch_factors(m_gm, next_factors.begin(), next_factors.end());
+            }
 
             // move the variable vi optimal  where all other variables
             // are conditioned to the then labels as given by "labels"
@@ -113,16 +164,24 @@ private:
     bool move_optimal(std::size_t vi){
 
         const auto num_labels = m_gm.num_labels(vi);
-        std::fill(m_value_buffer.begin(), m_value_buffer.end(), value_type(0));
 
-        for(auto && vi : m_factors_of_variables[vi]){
-            auto && factor = m_gm[vi];
-            factor.from_gm(m_labels, m_factor_labels);
-            auto vi_pos = factor.index(vi);
-            for(auto l=label_type(0); l<num_labels; ++l)
-            {
-                m_factor_labels[vi_pos] = l;
-                m_value_buffer[l] += factor[m_factor_labels.data()];
+        if constexpr(has_conditional_energies<GM>::value)
+        {
+            // the model computes the energies of all labels of vi itself
+            m_gm.conditional_energies(vi, m_labels, m_value_buffer.data());
+        }
+        else
+        {
+            std::fill(m_value_buffer.begin(), m_value_buffer.end(), value_type(0));
+            for(auto && fi : m_factors_of_variables[vi]){
+                auto && factor = m_gm[fi];
+                factor.from_gm(m_labels, m_factor_labels);
+                auto vi_pos = factor.index(vi);
+                for(auto l=label_type(0); l<num_labels; ++l)
+                {
+                    m_factor_labels[vi_pos] = l;
+                    m_value_buffer[l] += factor[m_factor_labels.data()];
+                }
             }
         }
         const auto old_energy = m_value_buffer[ m_labels[vi]];
@@ -149,6 +208,7 @@ private:
 
     std::queue<std::size_t> m_dirty;
     std::vector<bool> m_in_queue;
+    bool m_all_dirty{true};
 };
 
 template<class GM>
@@ -5,9 +5,15 @@
 #include <string>
 #include <iostream>
 #include <memory>
+#include <limits>
+#include <stdexcept>
 
 #include "opengm/from_gm_factory.hpp"
 #include "opengm/crtp_base.hpp"
+#include "opengm/memory_stats.hpp"
+#include "opengm/minimizer/utils/checkpoint.hpp"
+
+#include <gsl-lite/gsl-lite.hpp>
 
 namespace opengm{
 
@@ -143,6 +149,15 @@ public:
 
     using labels_vector_type = std::vector<label_type>;
 
+    MinimizerBase() = default;
+    // a copy does not inherit the checkpointing of the original
+    MinimizerBase(const MinimizerBase &){
+    }
+    MinimizerBase & operator=(const MinimizerBase &){
+        return *this;
+    }
+    virtual ~MinimizerBase() = default;
+
     virtual void minimize(minimizer_callback_base_unique_ptr_type callback){
         this->minimize(callback.get());
     }
@@ -168,6 +183,123 @@ public:
     virtual value_type current_energy() {
         return this->gm().evaluate(this->current_labels());
     }
+    // lower bound of the minimal energy, -infinity
+    // for minimizers which do not compute a bound
+    virtual value_type lower_bound() {
+        return -std::numeric_limits<value_type>::infinity();
+    }
+
+    // notification that values of the model have changed, but not
+    // its structure (e.g. after GraphicalModel::update_tensor).
+    // Minimizers keep their buffers and the next call of minimize
+    // continues from their current state instead of starting over.
+    virtual void model_changed(){
+    }
+    // as above, but only factors of the given variables have changed.
+    // By default this falls back to a full model_changed(),
+    // minimizers override it to only update the affected buffers.
+    virtual void model_changed(gsl::span<const std::size_t> /*variables*/){
+        this->model_changed();
+    }
+
+    // memory used by the model and by the buffers of the minimizer
+    virtual MemoryStats memory_stats() const{
+        auto stats = this->gm().memory_stats();
+        this->add_buffer_memory(stats);
+        return stats;
+    }
+    // add the auxiliary buffers of the minimizer to stats.buffers
+    virtual void add_buffer_memory(MemoryStats & stats) const{
+    }
+
+    // Checkpointing. Minimizers which can_checkpoint() serialize all
+    // state needed to continue an interrupted minimize in save_state and
+    // restore it in load_state, the next minimize then continues from
+    // the restored state. Snapshots are bound to the minimizer name and
+    // to the size of the model.
+    virtual bool can_checkpoint() const{
+        return false;
+    }
+    virtual void save_state(SnapshotWriter & writer) const{
+        throw std::runtime_error(this->name() + " does not support checkpointing");
+    }
+    virtual void load_state(SnapshotReader & reader){
+        throw std::runtime_error(this->name() + " does not support checkpointing");
+    }
+
+    // write snapshots to settings.path from within minimize,
+    // asynchronously and without blocking the iterations
+    void enable_checkpoints(const CheckpointSettings & settings){
+        if(!this->can_checkpoint()){
+            throw std::runtime_error(this->name() + " does not support checkpointing");
+        }
+        this->disable_checkpoints();
+        m_checkpoint_stats = CheckpointStats();
+        m_checkpoints = std::make_unique<detail::AsyncSnapshotFile>(settings);
+    }
+    // waits for a snapshot which is still being written,
+    // the statistics are kept until checkpoints are enabled again
+    void disable_checkpoints(){
+        if(m_checkpoints){
+            auto checkpoints = std::move(m_checkpoints);
+            m_checkpoint_stats = checkpoints->stats();
+            checkpoints->wait();
+        }
+    }
+    CheckpointStats checkpoint_stats() const{
+        return m_checkpoints ? m_checkpoints->stats() : m_checkpoint_stats;
+    }
+
+    // serialize the state with the snapshot header
+    void save_snapshot(std::vector<char> & bytes) const{
+        SnapshotWriter writer(bytes);
+        writer.write_value(detail::snapshot_magic);
+        writer.write_value(detail::snapshot_version);
+        writer.write_string(this->name());
+        writer.write_value(std::uint64_t(this->gm().num_variables()));
+        writer.write_value(std::uint64_t(this->gm().num_factors()));
+        this->save_state(writer);
+    }
+    void load_snapshot(const std::vector<char> & bytes){
+        SnapshotReader reader(bytes);
+        if(reader.read_value<std::array<char, 8>>() != detail::snapshot_magic ||
+           reader.read_value<std::uint32_t>() != detail::snapshot_version){
+            throw std::runtime_error("not a minimizer snapshot");
+        }
+        if(reader.read_string() != this->name()){
+            throw std::runtime_error("snapshot was not written by " + this->name());
+        }
+        if(reader.read_value<std::uint64_t>() != this->gm().num_variables() ||
+           reader.read_value<std::uint64_t>() != this->gm().num_factors()){
+            throw std::runtime_error("snapshot does not match the model");
+        }
+        this->load_state(reader);
+    }
+
+    // synchronous snapshot, e.g. after minimize returned
+    void save_checkpoint(const std::string & path) const{
+        std::vector<char> bytes;
+        this->save_snapshot(bytes);
+        detail::write_snapshot_file(path, bytes);
+    }
+    void resume(const std::string & path){
+        this->load_snapshot(detail::read_snapshot_file(path));
+    }
+
+protected:
+    // called by minimizers after each completed iteration
+    void checkpoint_iteration(const std::size_t iteration){
+        if(m_checkpoints && m_checkpoints->is_due(iteration)){
+            if(auto bytes = m_checkpoints->back_buffer()){
+                this->save_snapshot(*bytes);
+                m_checkpoints->submit();
+            }
+        }
+    }
+
+private:
+    std::unique_ptr<detail::AsyncSnapshotFile> m_checkpoints;
+    CheckpointStats m_checkpoint_stats;
 };
 
 
@@ -122,6 +122,13 @@ public:
         }
     }
 
+    // continue the run of the snapshot at resume_from.path
+    SelfFusion(const GM & gm, const settings_type & settings, const ResumeFrom & resume_from)
+    :   SelfFusion(gm, settings)
+    {
+        this->resume(resume_from.path);
+    }
+
     std::string name() const override{
         return "SelfFusion";
     }
@@ -143,6 +150,10 @@ public:
     value_type current_energy() override {
         return m_energy;
     }
+    // fusions of the current (or resumed) run
+    std::size_t num_fusions()const{
+        return m_num_fusions;
+    }
 
 
     bool can_start_from_starting_point() override{
@@ -153,22 +164,62 @@ public:
         m_labels.assign(labels, labels + m_gm.num_variables());
     }
 
-    void minimize(minimizer_callback_base_ptr_type minimizer_callback_base_ptr)override{
+    // the snapshot contains the fused labels and, if the proposal
+    // minimizer can checkpoint, a nested snapshot of its state
+    bool can_checkpoint() const override{
+        return true;
+    }
+    void save_state(SnapshotWriter & writer) const override{
+        writer.write_value(std::uint64_t(m_num_fusions));
+        writer.write_value(m_energy);
+        writer.write_vector(m_labels);
+        writer.write_value(m_starting_point_passed);
+        writer.write_value(m_first);
+        std::vector<char> minimizer_snapshot;
+        if(m_minimizer && m_minimizer->can_checkpoint())
+        {
+            m_minimizer->save_snapshot(minimizer_snapshot);
+        }
+        writer.write_vector(minimizer_snapshot);
+    }
+    void load_state(SnapshotReader & reader) override{
+        m_num_fusions = reader.read_value<std::uint64_t>();
+        m_energy = reader.read_value<value_type>();
+        reader.read_array(m_labels.data(), m_labels.size());
+        m_starting_point_passed = reader.read_value<bool>();
+        m_first = reader.read_value<bool>();
+        reader.read_vector(m_minimizer_snapshot);
+        m_resumed = true;
+    }
 
+    // after a resume the proposal minimizer continues from its nested
+    // snapshot, or if it cannot checkpoint, starts from the fused labels
+    void minimize(minimizer_callback_base_ptr_type minimizer_callback_base_ptr)override{
+        if(!m_resumed)
+        {
+            m_num_fusions = 0;
+        }
 
         // evaluate energy st. callbacks report correct energy
         m_energy = m_gm.evaluate(m_labels);
 
         auto callback = callback_wrapper(this, minimizer_callback_base_ptr);
-        auto minimizer = m_settings.minimizer_factory->create(m_gm);
-        if(m_starting_point_passed && minimizer->can_start_from_starting_point())
+        m_minimizer = m_settings.minimizer_factory->create(m_gm);
+        const bool has_fused_labels = m_starting_point_passed || (m_resumed && !m_first);
+        if(m_resumed && !m_minimizer_snapshot.empty())
         {
-            minimizer->set_starting_point(m_labels);
+            m_minimizer->load_snapshot(m_minimizer_snapshot);
         }
+        else if(has_fused_labels && m_minimizer->can_start_from_starting_point())
+        {
+            m_minimizer->set_starting_point(m_labels);
+        }
+        m_minimizer_snapshot.clear();
+        m_resumed = false;
 
         self_fusion_visitor_type self_fusion_visitor(*this, minimizer_callback_base_ptr);
-        minimizer->minimize(&self_fusion_visitor);
-
+        m_minimizer->minimize(&self_fusion_visitor);
+        m_minimizer.reset();
     }
 private:
 
@@ -184,6 +235,7 @@ private:
             m_energy = m_label_fuser.fuse(labels, m_labels);
         }
         m_first = false;
+        this->checkpoint_iteration(++m_num_fusions);
     };
 
 
@@ -195,6 +247,12 @@ private:
 
     bool m_starting_point_passed;
     bool m_first;
+
+    // the proposal minimizer while minimize is running
+    std::unique_ptr<base_type> m_minimizer;
+    std::size_t m_num_fusions{0};
+    std::vector<char> m_minimizer_snapshot;
+    bool m_resumed{false};
 };
 
 }
\ No newline at end of file
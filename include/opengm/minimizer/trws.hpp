@@ -0,0 +1,449 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "opengm/minimizer/minimizer_base.hpp"
+#include "opengm/minimizer/bp.hpp"
+#include "opengm/arity_vector.hpp"
+
+namespace opengm{
+
+
+// Sequential tree-reweighted message passing (TRW-S) on the message
+// storage of BeliefPropergation, in the reparametrization form of
+// Kolmogorov's SRMP which extends it to factors of higher order.
+// The var-to-fac message of a variable to a factor is added to the
+// factor and subtracted from the variable, the fac-to-var message is its
+// negation. The sum of the minima of the reparametrized unaries and
+// factors is a lower bound of the minimal energy, each update below
+// does not decrease it.
+//
+// The variables are visited in index order, alternating forward and
+// backward passes. When a variable is visited, first the min-marginals
+// of the factors with variables before it (in the direction of the pass)
+// are moved into the variable, then the fraction 1/max(#before, #after)
+// of its reparametrized unary is moved into each factor with variables
+// after it. On trees the bound converges to the minimal energy.
+// The labels are chosen during the passes, conditioned on the labels
+// of the variables already visited in the current pass.
+template<class GM>
+class TrwS : public MinimizerCrtpBase<GM, TrwS<GM> >{
+public:
+
+    using gm_type = GM;
+    using base_type = MinimizerBase<gm_type>;
+    using factors_of_variables_type =  HigherOrderAndUnaryFactorsOfVariables<gm_type>;
+    using value_type = typename GM::value_type;
+    using label_type = typename GM::label_type;
+    using labels_vector_type = typename base_type::labels_vector_type;
+    using minimizer_callback_base_ptr_type = typename base_type::minimizer_callback_base_ptr_type;
+
+    using base_type::minimize;
+    using base_type::model_changed;
+
+    struct Settings : public SolverSettingsBase{
+        std::size_t num_iterations{1000};
+        // stop as soon as best_energy - lower_bound <= absolute_gap
+        value_type absolute_gap{1e-6};
+        // or best_energy - lower_bound <= relative_gap * |best_energy|
+        value_type relative_gap{0};
+        // or an iteration improved the bound by less than convergence
+        value_type convergence{1e-7};
+    };
+
+    using settings_type = Settings;
+
+    TrwS(const GM & gm, const Settings & settings = Settings())
+    :   m_gm(gm),
+        m_settings(settings),
+        m_factors_of_variables(gm),
+        m_msg(gm, m_factors_of_variables),
+        m_factor_offsets(gm.num_variables() + 1, 0),
+        m_factor_entries(),
+        m_weights(gm.num_variables(), value_type(0)),
+        m_current_energy(),
+        m_best_energy(),
+        m_lower_bound(-std::numeric_limits<value_type>::infinity()),
+        m_current_labels(gm.num_variables(), 0),
+        m_best_labels(gm.num_variables(), 0),
+        m_belief_buffer(gm.space().max_num_labels()),
+        m_label_buffer(gm.space().max_num_labels()),
+        m_out_buffer(gm.max_arity() * gm.space().max_num_labels()),
+        m_dense_unaries(dense_unaries_of(gm))
+    {
+        const std::size_t num_variables = m_gm.num_variables();
+
+        // position of each variable in its factors and whether
+        // it is the first / last variable of the factor
+        for(std::size_t vi=0; vi<num_variables; ++vi)
+        {
+            const auto & factors = m_factors_of_variables[vi];
+            auto && higher_order = factors.higher_order();
+            m_factor_offsets[vi + 1] = m_factor_offsets[vi] + higher_order.size();
+            std::size_t num_not_first = 0;
+            std::size_t num_not_last = 0;
+            for(auto fi : higher_order)
+            {
+                auto && factor = m_gm[fi];
+                auto && variables = factor.variables();
+                const auto begin = variables.begin();
+                const auto end = variables.end();
+                const auto entry = FactorEntry{
+                    std::size_t(std::distance(begin, std::find(begin, end, vi))),
+                    *std::min_element(begin, end) == vi,
+                    *std::max_element(begin, end) == vi
+                };
+                num_not_first += !entry.first;
+                num_not_last += !entry.last;
+                m_factor_entries.push_back(entry);
+            }
+            const auto num_chains = std::max(num_not_first, num_not_last);
+            if(num_chains > 0)
+            {
+                m_weights[vi] = value_type(1) / value_type(num_chains);
+            }
+        }
+
+        m_current_energy =  m_gm.evaluate(m_current_labels);
+        m_best_energy = m_current_energy;
+    }
+
+    // continue the run of the snapshot at resume_from.path
+    TrwS(const GM & gm, const Settings & settings, const ResumeFrom & resume_from)
+    :   TrwS(gm, settings)
+    {
+        this->resume(resume_from.path);
+    }
+
+    std::string name() const override{
+        return "TrwS";
+    }
+
+    void add_buffer_memory(MemoryStats & stats) const override{
+        m_msg.add_buffer_memory(stats);
+        stats.buffers["factors_of_variables"] += m_factors_of_variables.memory_usage() +
+            detail::heap_bytes(m_factor_offsets) + detail::heap_bytes(m_factor_entries) + detail::heap_bytes(m_weights);
+        stats.buffers["labels"] += detail::heap_bytes(m_current_labels) + detail::heap_bytes(m_best_labels);
+        stats.buffers["belief_buffer"] += detail::heap_bytes(m_belief_buffer) + detail::heap_bytes(m_label_buffer) +
+            detail::heap_bytes(m_out_buffer);
+    }
+
+    const gm_type & gm() const override{
+        return m_gm;
+    }
+
+    const labels_vector_type & best_labels()override{
+        return m_best_labels;
+    }
+    const labels_vector_type & current_labels() override{
+        return m_current_labels;
+    }
+    value_type best_energy()  override{
+        return m_best_energy;
+    }
+    value_type current_energy()  override{
+        return m_current_energy;
+    }
+    value_type lower_bound() override{
+        return m_lower_bound;
+    }
+
+    bool can_start_from_starting_point() override{
+        return false;
+    }
+
+    // the messages are kept and serve as warm start,
+    // the bound of the old values is void
+    void model_changed() override{
+        m_current_energy =  m_gm.evaluate(m_current_labels);
+        m_best_energy = m_gm.evaluate(m_best_labels);
+        m_lower_bound = -std::numeric_limits<value_type>::infinity();
+    }
+
+    bool can_checkpoint() const override{
+        return true;
+    }
+    void save_state(SnapshotWriter & writer) const override{
+        writer.write_value(std::uint64_t(m_iteration));
+        writer.write_value(m_current_energy);
+        writer.write_value(m_best_energy);
+        writer.write_value(m_lower_bound);
+        writer.write_vector(m_current_labels);
+        writer.write_vector(m_best_labels);
+        m_msg.save(writer);
+    }
+    void load_state(SnapshotReader & reader) override{
+        m_iteration = reader.read_value<std::uint64_t>();
+        m_current_energy = reader.read_value<value_type>();
+        m_best_energy = reader.read_value<value_type>();
+        m_lower_bound = reader.read_value<value_type>();
+        reader.read_array(m_current_labels.data(), m_current_labels.size());
+        reader.read_array(m_best_labels.data(), m_best_labels.size());
+        m_msg.load(reader);
+        m_resumed = true;
+    }
+
+    // after a resume the interrupted run is continued
+    // with its iteration counter, best labels and bound
+    void minimize(minimizer_callback_base_ptr_type minimizer_callback_base_ptr)override{
+        if(!m_resumed)
+        {
+            m_iteration = 0;
+            m_current_energy =  m_gm.evaluate(m_current_labels);
+            m_best_labels = m_current_labels;
+            m_best_energy = m_current_energy;
+            m_lower_bound = -std::numeric_limits<value_type>::infinity();
+        }
+        m_resumed = false;
+
+        auto callback = callback_wrapper(this, minimizer_callback_base_ptr);
+
+        const std::size_t num_variables = m_gm.num_variables();
+        while(m_iteration < m_settings.num_iterations && !this->gap_closed())
+        {
+            for(std::size_t vi=0; vi<num_variables; ++vi)
+            {
+                this->update_variable(vi, true);
+            }
+            this->update_best();
+            for(std::size_t vi=num_variables; vi-- > 0;)
+            {
+                this->update_variable(vi, false);
+            }
+            this->update_best();
+
+            const auto previous_bound = m_lower_bound;
+            m_lower_bound = std::max(m_lower_bound, this->compute_lower_bound());
+
+            ++m_iteration;
+            this->checkpoint_iteration(m_iteration);
+            callback();
+
+            if(m_lower_bound - previous_bound < m_settings.convergence)
+            {
+                break;
+            }
+        }
+    }
+
+    // completed iterations of the current run
+    std::size_t iteration()const{
+        return m_iteration;
+    }
+
+    // best_energy() - lower_bound()
+    value_type duality_gap()const{
+        return m_best_energy - m_lower_bound;
+    }
+
+    // the lower bound of the current messages, the sum of the
+    // minima of the reparametrized unaries and factors
+    value_type compute_lower_bound(){
+        auto bound = value_type(0);
+        const std::size_t num_variables = m_gm.num_variables();
+        for(std::size_t vi=0; vi<num_variables; ++vi)
+        {
+            const auto num_labels = m_gm.num_labels(vi);
+            this->accumulate_belief(vi, m_belief_buffer.data());
+            bound += *std::min_element(m_belief_buffer.begin(), m_belief_buffer.begin() + num_labels);
+        }
+
+        const auto max_num_labels = m_gm.space().max_num_labels();
+        m_gm.template for_each_factor_of_min_arity<2>([&](auto fi, auto && factor){
+            // the reparametrized factor is the factor plus its var-to-fac
+            // messages, its minimum is taken over the min-marginal of the
+            // first variable
+            const auto arity = factor.arity();
+            arity_vector<value_type *>       out(arity);
+            arity_vector<const value_type *> in(arity);
+            for(auto i=0; i<arity; ++i){
+                in[i] = m_msg.oppToFacToVarMsg(fi, i);
+                out[i] = m_out_buffer.data() + i * max_num_labels;
+            }
+            factor.factor_to_variable_messages(in.data(), out.data());
+            auto factor_min = std::numeric_limits<value_type>::infinity();
+            for(std::size_t l=0; l<factor.shape(0); ++l){
+                factor_min = std::min(factor_min, out[0][l] + in[0][l]);
+            }
+            bound += factor_min;
+        });
+        return bound;
+    }
+
+private:
+
+    struct FactorEntry{
+        // position of the variable in the factor
+        std::size_t position;
+        // the variable has the smallest / largest index of the factor
+        bool first;
+        bool last;
+    };
+
+    bool gap_closed()const{
+        const auto gap = this->duality_gap();
+        return gap <= m_settings.absolute_gap || gap <= m_settings.relative_gap * std::abs(m_best_energy);
+    }
+
+    void update_best(){
+        m_current_energy =  m_gm.evaluate(m_current_labels);
+        if(m_current_energy < m_best_energy)
+        {
+            m_best_energy = m_current_energy;
+            m_best_labels = m_current_labels;
+        }
+    }
+
+    void update_variable(const std::size_t vi, const bool forward){
+        const auto num_labels = m_gm.num_labels(vi);
+        const auto & factors = m_factors_of_variables[vi];
+        auto && higher_order = factors.higher_order();
+        const auto entries = m_factor_entries.data() + m_factor_offsets[vi];
+
+        // move the min-marginals of the factors with
+        // variables before vi into vi
+        for(std::size_t hoi=0; hoi<higher_order.size(); ++hoi)
+        {
+            if(!(forward ? entries[hoi].first : entries[hoi].last))
+            {
+                this->update_message(higher_order[hoi], entries[hoi].position);
+                const auto fac_to_var = m_msg.oppToVarToFacMsg(vi, hoi);
+                auto var_to_fac = m_msg.varToFacMsg(vi, hoi);
+                for(label_type l=0; l<num_labels; ++l){
+                    var_to_fac[l] = -fac_to_var[l];
+                }
+            }
+        }
+
+        const auto belief = m_belief_buffer.data();
+        this->accumulate_belief(vi, belief);
+
+        // the label, factors whose other variables have all been
+        // labeled in this pass contribute their conditioned values
+        const auto label_values = m_label_buffer.data();
+        std::copy(belief, belief + num_labels, label_values);
+        for(std::size_t hoi=0; hoi<higher_order.size(); ++hoi)
+        {
+            if(forward ? entries[hoi].last : entries[hoi].first)
+            {
+                const auto fac_to_var = m_msg.oppToVarToFacMsg(vi, hoi);
+                auto && factor = m_gm[higher_order[hoi]];
+                auto && variables = factor.variables();
+                arity_vector<label_type> labels(factor.arity());
+                for(auto i=0; i<factor.arity(); ++i){
+                    labels[i] = m_current_labels[variables[i]];
+                }
+                for(label_type l=0; l<num_labels; ++l){
+                    labels[entries[hoi].position] = l;
+                    label_values[l] += factor[labels.data()] - fac_to_var[l];
+                }
+            }
+        }
+        m_current_labels[vi] = std::distance(label_values, std::min_element(label_values, label_values + num_labels));
+
+        // move the fraction weight of the belief into each
+        // factor with variables after vi
+        const auto weight = m_weights[vi];
+        for(std::size_t hoi=0; hoi<higher_order.size(); ++hoi)
+        {
+            if(!(forward ? entries[hoi].last : entries[hoi].first))
+            {
+                auto fac_to_var = m_msg.oppToVarToFacMsg(vi, hoi);
+                auto var_to_fac = m_msg.varToFacMsg(vi, hoi);
+                for(label_type l=0; l<num_labels; ++l){
+                    var_to_fac[l] += weight * belief[l];
+                    fac_to_var[l] = -var_to_fac[l];
+                }
+            }
+        }
+    }
+
+    // recompute the message of fi to its variable at position,
+    // the messages to the other variables are left unchanged
+    void update_message(const std::size_t fi, const std::size_t position){
+        auto && factor = m_gm[fi];
+        const auto arity = factor.arity();
+        const auto max_num_labels = m_gm.space().max_num_labels();
+        arity_vector<value_type *>       facToVar(arity);
+        arity_vector<const value_type *> varToFac(arity);
+        for(auto i=0; i<arity; ++i){
+            facToVar[i] = i == position ? m_msg.facToVarMsg(fi, i) : m_out_buffer.data() + i * max_num_labels;
+            varToFac[i] = m_msg.oppToFacToVarMsg(fi, i);
+        }
+        factor.factor_to_variable_messages(varToFac.data(), facToVar.data());
+
+        // normalize st. the messages do not drift
+        const auto msg = facToVar[position];
+        const auto num_labels = factor.shape(position);
+        const auto min_value = *std::min_element(msg, msg + num_labels);
+        for(std::size_t l=0; l<num_labels; ++l){
+            msg[l] -= min_value;
+        }
+    }
+
+    // unaries plus all incoming factor-to-variable messages
+    void accumulate_belief(const std::size_t vi, value_type * buffer){
+        const auto num_labels = m_gm.num_labels(vi);
+        const auto & factors = m_factors_of_variables[vi];
+        auto && unaries = factors.unaries();
+        auto && higher_order = factors.higher_order();
+
+        if(m_dense_unaries)
+        {
+            const auto row = m_dense_unaries[vi];
+            std::copy(row, row + num_labels, buffer);
+        }
+        else
+        {
+            std::fill(buffer, buffer + num_labels, 0.0);
+        }
+        for(auto fi : unaries)
+        {
+            if(!m_dense_unaries.contains_factor(fi))
+            {
+                m_gm[fi].add_values(buffer);
+            }
+        }
+        for(auto hoi=0; hoi<higher_order.size(); ++hoi)
+        {
+            const auto fac_to_var = m_msg.oppToVarToFacMsg(vi, hoi);
+            for(label_type l=0; l<num_labels; ++l)
+            {
+                buffer[l] += fac_to_var[l];
+            }
+        }
+    }
+
+    const gm_type & m_gm;
+    Settings m_settings;
+    factors_of_variables_type m_factors_of_variables;
+    detail::MessageStoring<GM> m_msg;
+
+    // entries m_factor_offsets[vi] to m_factor_offsets[vi+1]
+    // belong to the higher order factors of vi
+    std::vector<std::size_t> m_factor_offsets;
+    std::vector<FactorEntry> m_factor_entries;
+    std::vector<value_type> m_weights;
+
+    value_type m_current_energy;
+    value_type m_best_energy;
+    value_type m_lower_bound;
+    labels_vector_type m_current_labels;
+    labels_vector_type m_best_labels;
+    std::vector<value_type> m_belief_buffer;
+    std::vector<value_type> m_label_buffer;
+    std::vector<value_type> m_out_buffer;
+    DenseUnaries<value_type> m_dense_unaries;
+
+    std::size_t m_iteration{0};
+    bool m_resumed{false};
+};
+
+
+
+template<class GM>
+using TrwSFactory = MinimizerFactory<TrwS<GM>>;
+
+}
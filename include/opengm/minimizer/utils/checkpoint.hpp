@@ -0,0 +1,286 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+
+namespace opengm{
+
+
+    // when MinimizerBase::enable_checkpoints writes snapshots,
+    // a snapshot is due if either condition holds
+    struct CheckpointSettings{
+        std::string path;
+        // 0 means never
+        std::size_t every_n_iterations{0};
+        // 0 means never
+        double every_seconds{0};
+    };
+
+    struct CheckpointStats{
+        // snapshots handed to the background writer
+        std::size_t written{0};
+        // due snapshots skipped since the previous one was still being written
+        std::size_t skipped{0};
+    };
+
+    // tag of the resume constructors of the minimizers
+    struct ResumeFrom{
+        std::string path;
+    };
+
+
+    // appends trivially copyable values to a byte buffer
+    class SnapshotWriter{
+    public:
+        explicit SnapshotWriter(std::vector<char> & buffer)
+        :   m_buffer(buffer){
+        }
+
+        template<class V>
+        void write_value(const V & value){
+            static_assert(std::is_trivially_copyable<V>::value, "only trivially copyable values can be written");
+            this->write_bytes(&value, sizeof(V));
+        }
+
+        template<class V>
+        void write_array(const V * values, const std::size_t size){
+            static_assert(std::is_trivially_copyable<V>::value, "only trivially copyable values can be written");
+            this->write_value(std::uint64_t(size));
+            this->write_bytes(values, size * sizeof(V));
+        }
+
+        template<class V, class A>
+        void write_vector(const std::vector<V, A> & values){
+            this->write_array(values.data(), values.size());
+        }
+
+        void write_string(const std::string & str){
+            this->write_array(str.data(), str.size());
+        }
+
+        // std random engines are serialized via their stream operators
+        template<class ENGINE>
+        void write_engine(const ENGINE & engine){
+            std::ostringstream out;
+            out<<engine;
+            this->write_string(out.str());
+        }
+
+    private:
+        void write_bytes(const void * data, const std::size_t size){
+            const auto bytes = static_cast<const char *>(data);
+            m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+        }
+
+        std::vector<char> & m_buffer;
+    };
+
+
+    // reads the values in the order of the SnapshotWriter,
+    // throws if the snapshot is truncated or does not match
+    class SnapshotReader{
+    public:
+        SnapshotReader(const char * data, const std::size_t size)
+        :   m_data(data),
+            m_size(size),
+            m_position(0){
+        }
+        explicit SnapshotReader(const std::vector<char> & buffer)
+        :   SnapshotReader(buffer.data(), buffer.size()){
+        }
+
+        template<class V>
+        V read_value(){
+            static_assert(std::is_trivially_copyable<V>::value, "only trivially copyable values can be read");
+            V value;
+            this->read_bytes(&value, sizeof(V));
+            return value;
+        }
+
+        // read an array of exactly size values into existing storage
+        template<class V>
+        void read_array(V * values, const std::size_t size){
+            if(this->read_value<std::uint64_t>() != size){
+                throw std::runtime_error("snapshot does not match the model");
+            }
+            this->read_bytes(values, size * sizeof(V));
+        }
+
+        template<class V, class A>
+        void read_vector(std::vector<V, A> & values){
+            const auto size = this->read_value<std::uint64_t>();
+            if(size > (m_size - m_position) / sizeof(V)){
+                throw std::runtime_error("snapshot is truncated or corrupted");
+            }
+            values.resize(size);
+            this->read_bytes(values.data(), size * sizeof(V));
+        }
+
+        std::string read_string(){
+            std::vector<char> chars;
+            this->read_vector(chars);
+            return std::string(chars.begin(), chars.end());
+        }
+
+        template<class ENGINE>
+        void read_engine(ENGINE & engine){
+            std::istringstream in(this->read_string());
+            in>>engine;
+            if(!in){
+                throw std::runtime_error("snapshot is truncated or corrupted");
+            }
+        }
+
+    private:
+        void read_bytes(void * data, const std::size_t size){
+            if(size > m_size - m_position){
+                throw std::runtime_error("snapshot is truncated or corrupted");
+            }
+            std::memcpy(data, m_data + m_position, size);
+            m_position += size;
+        }
+
+        const char * m_data;
+        std::size_t m_size;
+        std::size_t m_position;
+    };
+
+
+namespace detail{
+
+    constexpr std::array<char, 8> snapshot_magic{{'O', 'G', 'M', 'S', 'N', 'A', 'P', '\0'}};
+    // 2: padded structure of arrays message layout
+    // 3: message type tag in front of the bp messages
+    constexpr std::uint32_t snapshot_version = 3;
+
+    // the snapshot is written next to path and renamed, a pre-empted
+    // write therefore never destroys the previous snapshot
+    inline void write_snapshot_file(const std::string & path, const std::vector<char> & bytes){
+        const auto tmp_path = path + ".tmp";
+        {
+            std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), bytes.size());
+            out.close();
+            if(!out){
+                throw std::runtime_error("writing the snapshot " + tmp_path + " failed");
+            }
+        }
+        if(std::rename(tmp_path.c_str(), path.c_str()) != 0){
+            throw std::runtime_error("cannot rename " + tmp_path + " to " + path);
+        }
+    }
+
+    inline std::vector<char> read_snapshot_file(const std::string & path){
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if(!in){
+            throw std::runtime_error("cannot open snapshot " + path);
+        }
+        std::vector<char> bytes(std::size_t(in.tellg()));
+        in.seekg(0);
+        in.read(bytes.data(), bytes.size());
+        if(!in){
+            throw std::runtime_error("cannot read snapshot " + path);
+        }
+        return bytes;
+    }
+
+
+    // Double buffered asynchronous snapshots: the solver serializes
+    // into the back buffer while the front buffer is written by a
+    // background task. A snapshot which is due while the previous one
+    // is still being written is skipped instead of stalling the solver.
+    class AsyncSnapshotFile{
+    public:
+        explicit AsyncSnapshotFile(const CheckpointSettings & settings)
+        :   m_settings(settings),
+            m_front(),
+            m_back(),
+            m_pending(),
+            m_last(std::chrono::steady_clock::now()),
+            m_stats()
+        {
+        }
+
+        AsyncSnapshotFile(const AsyncSnapshotFile &) = delete;
+        AsyncSnapshotFile & operator=(const AsyncSnapshotFile &) = delete;
+
+        ~AsyncSnapshotFile(){
+            // errors are only reported by an explicit wait
+            try{
+                this->wait();
+            }
+            catch(...){
+            }
+        }
+
+        const CheckpointSettings & settings()const{
+            return m_settings;
+        }
+        const CheckpointStats & stats()const{
+            return m_stats;
+        }
+
+        bool is_due(const std::size_t iteration)const{
+            if(m_settings.every_n_iterations > 0 && iteration % m_settings.every_n_iterations == 0){
+                return true;
+            }
+            if(m_settings.every_seconds > 0){
+                const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_last;
+                return elapsed.count() >= m_settings.every_seconds;
+            }
+            return false;
+        }
+
+        // the cleared back buffer or nullptr if the previous
+        // snapshot is still being written. Rethrows errors of
+        // the previous write.
+        std::vector<char> * back_buffer(){
+            if(m_pending.valid()){
+                if(m_pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready){
+                    ++m_stats.skipped;
+                    return nullptr;
+                }
+                m_pending.get();
+            }
+            m_back.clear();
+            return &m_back;
+        }
+
+        // write the back buffer in the background
+        void submit(){
+            std::swap(m_front, m_back);
+            m_pending = std::async(std::launch::async, [this](){
+                write_snapshot_file(m_settings.path, m_front);
+            });
+            m_last = std::chrono::steady_clock::now();
+            ++m_stats.written;
+        }
+
+        void wait(){
+            if(m_pending.valid()){
+                m_pending.get();
+            }
+        }
+
+    private:
+        CheckpointSettings m_settings;
+        std::vector<char> m_front;
+        std::vector<char> m_back;
+        std::future<void> m_pending;
+        std::chrono::steady_clock::time_point m_last;
+        CheckpointStats m_stats;
+    };
+}
+
+}
@@ -1,11 +1,15 @@
 #pragma once
 
 #include <queue>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
 
 #include "opengm/opengm_config.hpp"
 #include "opengm/datastructures/partition.hpp"
 #include "opengm/graphical_model.hpp"
 #include "opengm/factors_of_variables.hpp"
+#include "opengm/utils.hpp"
 
 #include <gsl-lite/gsl-lite.hpp>
 
@@ -123,33 +127,72 @@ namespace detail
 
 
     
+    // Builds the submodel of a set of free variables while all other
+    // variables are fixed to given labels.
+    // Only the factors adjacent to the free variables are visited.
+    // The submodel, its variable mapping and all buffers are reused
+    // between calls. Factors which only contain free variables point to
+    // the tensors of the model, factors with a single free variable are
+    // summed into one unary per variable and factors with several free
+    // and fixed variables are evaluated into a value arena which is
+    // viewed by ExplicitViewTensors (they are added after the other
+    // factors). Only bound factors with more than max_dense_bound_size
+    // values are bound to new tensors.
+    // Factor proxies (e.g. of GridGm) own no tensor which outlives
+    // them, their factors are evaluated into the arena (or cloned)
+    // even if all their variables are free.
+    // A builder is not thread safe, parallel block workers use one
+    // builder each and can share the factors of variables.
     template<class GM>
     class ConditionedSubmodelBuilder
     {
     public:
         using gm_type = GM;
         using value_type = typename gm_type::value_type;
+        using label_type = typename gm_type::label_type;
         using labels_vector_type = typename gm_type::labels_vector_type;
+        using factors_of_variables_type = FactorsOfVariables<gm_type>;
+        using factors_of_variables_ptr_type = std::shared_ptr<const factors_of_variables_type>;
 
 
         // submodel
         using subspace_type = typename gm_type::space_type::subspace_type;
         using sub_gm_type = GraphicalModel<subspace_type,value_type>;
 
-        ConditionedSubmodelBuilder(const gm_type & gm)
+        static constexpr std::size_t max_dense_bound_size = std::size_t(1) << 16;
+
+        ConditionedSubmodelBuilder(const gm_type & gm, factors_of_variables_ptr_type factors_of_variables = nullptr)
         :   m_gm(gm),
+            m_factors_of_variables(factors_of_variables ? std::move(factors_of_variables) :
+                std::make_shared<const factors_of_variables_type>(gm)),
+            m_sub_gm(),
             m_sub_num_variables(0),
             m_is_free(m_gm.num_variables(), false),
             m_gm_to_sub_gm(m_gm.num_variables()),
             m_sub_gm_to_gm(m_gm.num_variables()),
+            m_sub_gm_factor_vi(),
             m_factor_fixed_pos(),
-            m_factor_fixed_labels()
+            m_factor_fixed_labels(),
+            m_factor_labels(),
+            m_unary_offsets(),
+            m_unary_values(),
+            m_has_unary(),
+            m_unary_tensors(),
+            m_bound_values(),
+            m_bound_shapes(),
+            m_bound_variables(),
+            m_bound_factors(),
+            m_bound_view_tensors(),
+            m_bound_tensors()
         {
             const auto max_arity = m_gm.max_arity();
 
             m_sub_gm_factor_vi.resize(max_arity);
             m_factor_fixed_pos.resize(max_arity);
             m_factor_fixed_labels.resize(max_arity);
+            m_factor_labels.resize(max_arity);
+            m_factor_free_pos.resize(max_arity);
+            m_sub_labels.resize(max_arity);
         }
 
 
@@ -163,75 +206,248 @@ namespace detail
         template<class VI_ITER, class F>
         void condition(VI_ITER free_vi_begin, VI_ITER free_vi_end, const labels_vector_type &  labels, F && f)
         {
-            sub_gm_type sub_gm(m_gm.space().subspace(free_vi_begin, free_vi_end));
-            m_sub_num_variables = sub_gm.num_variables();
+            f(this->prepare(free_vi_begin, free_vi_end, labels));
+        }
+
+        template<class VI_T>
+        const sub_gm_type & prepare(std::initializer_list<VI_T> free_vi, const labels_vector_type &  labels)
+        {
+            return this->prepare(free_vi.begin(), free_vi.end(), labels);
+        }
 
-            auto svi = 0;
+        // build the submodel of the free variables, variable svi of the
+        // submodel is the variable sub_gm_to_gm()[svi] of the model.
+        // The submodel is valid until the next call of prepare.
+        template<class VI_ITER>
+        const sub_gm_type & prepare(VI_ITER free_vi_begin, VI_ITER free_vi_end, const labels_vector_type &  labels)
+        {
+            m_sub_gm.clear();
+            m_sub_gm.space() = m_gm.space().subspace(free_vi_begin, free_vi_end);
+            m_bound_tensors.clear();
+            m_bound_values.clear();
+            m_bound_shapes.clear();
+            m_bound_variables.clear();
+            m_bound_factors.clear();
+            m_sub_num_variables = m_sub_gm.num_variables();
+
+            std::size_t svi = 0;
+            std::size_t num_unary_values = 0;
+            m_unary_offsets.resize(m_sub_num_variables);
             std::for_each(free_vi_begin, free_vi_end, [&](auto vi){
-                m_is_free[vi]=true;
+                m_is_free[vi] = true;
                 m_gm_to_sub_gm[vi] = svi;
                 m_sub_gm_to_gm[svi] = vi;
+                m_unary_offsets[svi] = num_unary_values;
+                num_unary_values += m_gm.num_labels(vi);
                 ++svi;
             });
+            m_unary_values.assign(num_unary_values, value_type(0));
+            m_has_unary.assign(m_sub_num_variables, false);
+            m_unary_tensors.resize(m_sub_num_variables);
+
+            for(svi=0; svi<m_sub_num_variables; ++svi)
+            {
+                const auto vi = m_sub_gm_to_gm[svi];
+                for(auto fi : (*m_factors_of_variables)[vi])
+                {
+                    this->add_factor(vi, m_gm[fi], labels);
+                }
+            }
+
+            // the bound factors, the arena does not grow anymore
+            m_bound_view_tensors.resize(m_bound_factors.size());
+            for(std::size_t i=0; i<m_bound_factors.size(); ++i)
+            {
+                const auto & bound = m_bound_factors[i];
+                m_bound_view_tensors[i] = ExplicitViewTensor<value_type>(
+                    m_bound_values.data() + bound.values_offset,
+                    m_bound_shapes.data() + bound.shape_offset,
+                    bound.arity
+                );
+                const auto variables = m_bound_variables.begin() + bound.shape_offset;
+                m_sub_gm.add_factor(&m_bound_view_tensors[i], variables, variables + bound.arity);
+            }
+
+            // the conditioned unaries
+            for(svi=0; svi<m_sub_num_variables; ++svi)
+            {
+                if(m_has_unary[svi])
+                {
+                    m_unary_tensors[svi] = UnaryViewTensor<value_type>(
+                        m_unary_values.data() + m_unary_offsets[svi],
+                        m_gm.num_labels(m_sub_gm_to_gm[svi])
+                    );
+                    m_sub_gm.add_factor(&m_unary_tensors[svi], &svi, &svi + 1);
+                }
+            }
+
+            // cleanup
+            for(svi=0; svi<m_sub_num_variables; ++svi)
+            {
+                m_is_free[m_sub_gm_to_gm[svi]] = false;
+            }
+            return m_sub_gm;
+        }
+
+        const sub_gm_type & sub_gm()const{
+            return m_sub_gm;
+        }
+
+        gsl::span<const std::size_t> sub_gm_to_gm()const{
+            return gsl::span<const std::size_t>(m_sub_gm_to_gm.data(), m_sub_num_variables);
+        }
+
+        // write the labels of the submodel to the labels of the model
+        template<class SUB_LABELS>
+        void commit(const SUB_LABELS & sub_labels, labels_vector_type & labels)const
+        {
+            for(std::size_t svi=0; svi<m_sub_num_variables; ++svi)
+            {
+                labels[m_sub_gm_to_gm[svi]] = sub_labels[svi];
+            }
+        }
+
+    private:
 
-            for(auto && factor : m_gm)
+        // add the conditioned factor to the submodel when vi is
+        // its first free variable st. each factor is added once
+        template<class FACTOR>
+        void add_factor(const std::size_t vi, FACTOR && factor, const labels_vector_type & labels)
+        {
+            // * build variable indices of sub factor
+            // * get fixed positions
+            // * get labels at fixed positions
+            auto && vars = factor.variables();
+            std::size_t sub_arity = 0;
+            std::size_t n_fixed = 0;
+            for(std::size_t ai=0; ai<factor.arity(); ++ai)
             {
-                // * build variable indices of sub factor
-                // * get fixed positions
-                // * get labels at fixed positions
-                auto && vars = factor.variables();
-                auto sub_arity = 0;
-                auto n_fixed = 0;
-                for(auto ai=0; ai<factor.arity(); ++ai)
+                const auto other_vi = vars[ai];
+                if(m_is_free[other_vi])
                 {
-                    const auto vi = vars[ai];
-                    if(m_is_free[vi])
+                    if(sub_arity == 0 && other_vi != vi)
                     {
-                        auto sub_vi = m_gm_to_sub_gm[vi];
-                        m_sub_gm_factor_vi[sub_arity] = sub_vi;
-                        ++sub_arity;
+                        return;
                     }
-                    else
+                    m_sub_gm_factor_vi[sub_arity] = m_gm_to_sub_gm[other_vi];
+                    ++sub_arity;
+                }
+                else
+                {
+                    m_factor_fixed_pos[n_fixed] = ai;
+                    m_factor_fixed_labels[n_fixed] = labels[other_vi];
+                    ++n_fixed;
+                }
+            }
+
+            constexpr bool stable_tensors = std::is_reference<decltype(m_gm[std::size_t(0)])>::value;
+            if(n_fixed == 0 && stable_tensors)
+            {
+                m_sub_gm.add_factor(
+                    factor.tensor(),
+                    m_sub_gm_factor_vi.begin(),
+                    m_sub_gm_factor_vi.begin() + sub_arity
+                );
+            }
+            else if(sub_arity == 1)
+            {
+                // sum into the unary of the single free variable
+                const auto svi = m_sub_gm_factor_vi[0];
+                const auto num_labels = m_gm.num_labels(vi);
+                auto values = m_unary_values.data() + m_unary_offsets[svi];
+                std::size_t pos = 0;
+                for(std::size_t ai=0; ai<factor.arity(); ++ai)
+                {
+                    m_factor_labels[ai] = labels[vars[ai]];
+                    if(vars[ai] == vi)
                     {
-                        m_factor_fixed_pos[n_fixed] = ai;
-                        m_factor_fixed_labels[n_fixed] = labels[vi];
-                        ++n_fixed;
+                        pos = ai;
                     }
                 }
-                if(sub_arity > 0 && n_fixed > 0)
+                for(label_type l=0; l<num_labels; ++l)
                 {
-                    auto subtensor = factor.bind(
-                        gsl::span<const std::size_t>(m_factor_fixed_pos.data(), n_fixed),
-                        gsl::span<const label_type>(m_factor_fixed_labels.data(), n_fixed)
-                    );
-                    sub_gm.add_factor(
-                        std::move(subtensor),
-                        m_sub_gm_factor_vi.begin(),
-                        m_sub_gm_factor_vi.begin() + sub_arity
-                    );
+                    m_factor_labels[pos] = l;
+                    values[l] += factor[m_factor_labels.data()];
                 }
-                else if(sub_arity > 0)
+                m_has_unary[svi] = true;
+            }
+            else if(!this->add_dense_bound_factor(factor, sub_arity, labels))
+            {
+                // too large for the arena
+                if(n_fixed == 0)
                 {
-                    auto tensor = factor.tensor();
-                    sub_gm.add_factor(
-                        tensor,
-                        m_sub_gm_factor_vi.begin(),
-                        m_sub_gm_factor_vi.begin() + sub_arity
-                    );
+                    m_bound_tensors.push_back(factor.tensor()->clone());
                 }
+                else
+                {
+                    m_bound_tensors.push_back(factor.bind(
+                        gsl::span<const std::size_t>(m_factor_fixed_pos.data(), n_fixed),
+                        gsl::span<const label_type>(m_factor_fixed_labels.data(), n_fixed)
+                    ));
+                }
+                m_sub_gm.add_factor(
+                    m_bound_tensors.back().get(),
+                    m_sub_gm_factor_vi.begin(),
+                    m_sub_gm_factor_vi.begin() + sub_arity
+                );
+            }
+        }
 
+        // evaluate the factor for all labels of its sub_arity free variables
+        // into the arena, the fixed variables keep their labels
+        template<class FACTOR>
+        bool add_dense_bound_factor(FACTOR && factor, const std::size_t sub_arity, const labels_vector_type & labels)
+        {
+            auto && vars = factor.variables();
+            const auto shape_offset = m_bound_shapes.size();
+            std::size_t size = 1;
+            for(std::size_t i=0; i<sub_arity; ++i)
+            {
+                const auto num_labels = m_gm.num_labels(m_sub_gm_to_gm[m_sub_gm_factor_vi[i]]);
+                size *= num_labels;
+                m_bound_shapes.push_back(num_labels);
             }
-            f(sub_gm);
-            // cleanup
-            for(auto svi=0; svi<m_sub_num_variables; ++svi)
+            if(size > max_dense_bound_size)
+            {
+                m_bound_shapes.resize(shape_offset);
+                return false;
+            }
+            m_bound_variables.insert(m_bound_variables.end(), m_sub_gm_factor_vi.begin(), m_sub_gm_factor_vi.begin() + sub_arity);
+            m_bound_factors.push_back(BoundFactor{m_bound_values.size(), shape_offset, sub_arity});
+
+            // the free positions, in the variable order of the factor
+            std::size_t n_free = 0;
+            for(std::size_t ai=0; ai<factor.arity(); ++ai)
             {
-                m_is_free[m_sub_gm_to_gm[svi]] = true;
+                if(m_is_free[vars[ai]])
+                {
+                    m_factor_free_pos[n_free++] = ai;
+                }
+                else
+                {
+                    m_factor_labels[ai] = labels[vars[ai]];
+                }
             }
+            detail::for_each_state(sub_arity, m_bound_shapes.data() + shape_offset, m_sub_labels, [&](auto && sub_labels){
+                for(std::size_t i=0; i<sub_arity; ++i)
+                {
+                    m_factor_labels[m_factor_free_pos[i]] = sub_labels[i];
+                }
+                m_bound_values.push_back(factor[m_factor_labels.data()]);
+            });
+            return true;
         }
 
-    private:
+        struct BoundFactor{
+            std::size_t values_offset;
+            // offset into m_bound_shapes and m_bound_variables
+            std::size_t shape_offset;
+            std::size_t arity;
+        };
 
         const gm_type & m_gm;
+        factors_of_variables_ptr_type m_factors_of_variables;
+        sub_gm_type m_sub_gm;
         std::size_t m_sub_num_variables;
         std::vector<bool> m_is_free;
         std::vector<std::size_t> m_gm_to_sub_gm;
@@ -239,6 +455,23 @@ namespace detail
         std::vector<std::size_t> m_sub_gm_factor_vi;
         std::vector<std::size_t> m_factor_fixed_pos;
         std::vector<label_type>  m_factor_fixed_labels;
+        std::vector<label_type>  m_factor_labels;
+        std::vector<std::size_t> m_factor_free_pos;
+        std::vector<label_type>  m_sub_labels;
+
+        // conditioned unaries of the free variables
+        std::vector<std::size_t> m_unary_offsets;
+        std::vector<value_type> m_unary_values;
+        std::vector<bool> m_has_unary;
+        std::vector<UnaryViewTensor<value_type>> m_unary_tensors;
+        // arena of the factors with several free and fixed variables
+        std::vector<value_type> m_bound_values;
+        std::vector<std::size_t> m_bound_shapes;
+        std::vector<std::size_t> m_bound_variables;
+        std::vector<BoundFactor> m_bound_factors;
+        std::vector<ExplicitViewTensor<value_type>> m_bound_view_tensors;
+        // bound factors too large for the arena
+        std::vector<std::unique_ptr<TensorBase<value_type>>> m_bound_tensors;
     };
 
     template<class GM>
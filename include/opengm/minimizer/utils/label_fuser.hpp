@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <memory>
 
@@ -88,22 +89,36 @@ namespace opengm{
                 m_fuse_gm.space().resize(m_fuse_gm_num_var);
                 std::fill(m_fuse_gm_unaries.begin(), m_fuse_gm_unaries.begin() + m_fuse_gm_num_var, 0);
 
-                for(auto && factor : m_gm)
-                {
-                    // setup variables of fuse factor
+                // unaries, those of the dense block are added below
+                const auto dense_unaries = dense_unaries_of(m_gm);
+                m_gm.template for_each_factor_of_arity<1>([&](auto fi, auto && factor){
+                    if(!dense_unaries.contains_factor(fi) && m_in_fuse_gm[factor.variables()[0]])
+                    {
+                        this->add_fully_included_unary_factor(labels_a, labels_b, factor);
+                    }
+                });
+
+                // pairwise factors with fixed size label buffers
+                m_gm.template for_each_factor_of_arity<2>([&](auto fi, auto && factor){
+                    const auto fuse_factor_arity = setup_fuse_factor_variables(factor);
+                    if(fuse_factor_arity == 2)
+                    {
+                        this->add_fully_included_pairwise_factor(labels_a, labels_b, factor);
+                    }
+                    else if(fuse_factor_arity == 1)
+                    {
+                        this->add_unary_from_partially_included_factor(labels_a, labels_b, factor);
+                    }
+                });
+
+                // higher order factors
+                m_gm.template for_each_factor_of_min_arity<3>([&](auto fi, auto && factor){
                     const auto fuse_factor_arity = setup_fuse_factor_variables(factor);
 
                     // fully included
                     if(fuse_factor_arity == factor.arity())
                     {
-                        if(fuse_factor_arity == 1)
-                        {
-                            this->add_fully_included_unary_factor(labels_a, labels_b, factor);
-                        }
-                        else
-                        {
-                            this->add_fully_included_factor(labels_a, labels_b, factor);
-                        }
+                        this->add_fully_included_factor(labels_a, labels_b, factor);
                     }
                     // partially included
                     else if(fuse_factor_arity > 0)
@@ -117,6 +132,16 @@ namespace opengm{
                             this->add_partially_included_factor(labels_a, labels_b, factor, fuse_factor_arity);
                         }
                     }
+                });
+
+                if(dense_unaries)
+                {
+                    for(std::size_t fvi=0; fvi<m_fuse_gm_num_var; ++fvi)
+                    {
+                        const auto vi = m_fuse_gm_to_gm[fvi];
+                        const auto row = dense_unaries[vi];
+                        m_fuse_gm_unaries[fvi] += row[labels_a[vi]] - row[labels_b[vi]];
+                    }
                 }
 
                 this->add_collected_unaries();
@@ -209,7 +234,7 @@ namespace opengm{
                 // map from fuse-gm labels to gm labels
                 for(std::size_t ai=0; ai<arity; ++ai)
                 {
-                    m_factor_labels[ai] = m_fuse_factor_labels[ai] == 0 ? labels_a[vars[ai]] : labels_a[vars[ai]];
+                    m_factor_labels[ai] = m_fuse_factor_labels[ai] == 0 ? labels_a[vars[ai]] : labels_b[vars[ai]];
                 }
 
                 // evaluate and assign factor values to tensor
@@ -222,6 +247,33 @@ namespace opengm{
         }
 
 
+        template<class FACTOR>
+        void add_fully_included_pairwise_factor(
+            const label_vector_type & labels_a,
+            const label_vector_type & labels_b,
+            FACTOR && factor
+        )
+        {
+            auto && vars = factor.variables();
+            const std::array<std::array<label_type, 2>, 2> candidates{{
+                {labels_a[vars[0]], labels_b[vars[0]]},
+                {labels_a[vars[1]], labels_b[vars[1]]}
+            }};
+            auto tensor = std::make_unique<fuse_tensor_type>(2);
+            std::array<label_type, 2> fuse_labels;
+            std::array<label_type, 2> labels;
+            for(fuse_labels[0]=0; fuse_labels[0]<2; ++fuse_labels[0])
+            {
+                labels[0] = candidates[0][fuse_labels[0]];
+                for(fuse_labels[1]=0; fuse_labels[1]<2; ++fuse_labels[1])
+                {
+                    labels[1] = candidates[1][fuse_labels[1]];
+                    tensor->operator[](fuse_labels.data()) = factor[labels.data()];
+                }
+            }
+            m_fuse_gm.add_factor(std::move(tensor), m_fuse_factor_vis.begin(), m_fuse_factor_vis.begin() + 2);
+        }
+
         template<class FACTOR>
         void add_fully_included_unary_factor(
             const label_vector_type & labels_a,
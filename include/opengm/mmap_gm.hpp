@@ -0,0 +1,400 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <variant>
+#include <iterator>
+#include <stdexcept>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "opengm/opengm_config.hpp"
+#include "opengm/space.hpp"
+#include "opengm/gm_base.hpp"
+#include "opengm/factor_base.hpp"
+#include "opengm/tensors.hpp"
+#include "opengm/io/mapped_file.hpp"
+#include "opengm/io/binary_model.hpp"
+
+namespace opengm{
+
+
+    template<class T>
+    class MmapGm;
+
+    template<class T>
+    class MmapFactor;
+
+    template<class T>
+    class GmTraits<MmapGm<T>>{
+    public:
+        using space_type = SpanSpace<std::size_t>;
+        using label_type = typename SpaceTraits<space_type>::label_type;
+        using value_type = T;
+    };
+
+    template<class T>
+    class FactorTraits<MmapFactor<T>>{
+    public:
+        using value_type = T;
+        using label_type = std::size_t;
+    };
+
+
+    // factor proxy of a MmapGm.
+    // The variables and the values of explicit tensors point into
+    // the mapping, the lightweight tensor is owned by value,
+    // therefore tensor() is only valid as long as the factor is alive.
+    template<class T>
+    class MmapFactor : public FactorBase<MmapFactor<T>>{
+    public:
+        using base_type = FactorBase<MmapFactor<T>>;
+        using base_type::operator();
+        using base_type::operator[];
+        using label_type = std::size_t;
+        using value_type = T;
+        using variables_type = gsl::span<const std::size_t>;
+        using tensor_variant_type = std::variant<
+            UnaryViewTensor<T>,
+            ExplicitViewTensor<T>,
+            Potts2Tensor<T>,
+            L1Tensor<T>,
+            TruncatedL1Tensor<T>
+        >;
+
+        template<class TENSOR>
+        MmapFactor(const variables_type & variables, TENSOR && tensor)
+        :   m_variables(variables),
+            m_tensor(std::forward<TENSOR>(tensor)){
+        }
+
+        variables_type variables()const{
+            return m_variables;
+        }
+        std::size_t arity()const{
+            return m_variables.size();
+        }
+        std::size_t shape(const std::size_t i)const{
+            return this->tensor()->shape(i);
+        }
+
+        // the members below dispatch on the variant with a qualified call
+        // st. no virtual call is needed
+        value_type operator[](const label_type * labels)const{
+            return std::visit([&](auto && tensor){
+                using tensor_t = std::decay_t<decltype(tensor)>;
+                return tensor.tensor_t::operator[](labels);
+            }, m_tensor);
+        }
+        void add_values(value_type * out)const{
+            std::visit([&](auto && tensor){
+                using tensor_t = std::decay_t<decltype(tensor)>;
+                tensor.tensor_t::add_values(out);
+            }, m_tensor);
+        }
+        void batch_add_values(
+            const label_type * labels,
+            const std::size_t num_labelings,
+            value_type * out
+        )const{
+            std::visit([&](auto && tensor){
+                using tensor_t = std::decay_t<decltype(tensor)>;
+                tensor.tensor_t::batch_add_values(labels, num_labelings, out);
+            }, m_tensor);
+        }
+        void factor_to_variable_messages(
+            const value_type ** in_messages,
+            value_type ** out_messages
+        )const{
+            std::visit([&](auto && tensor){
+                using tensor_t = std::decay_t<decltype(tensor)>;
+                tensor.tensor_t::factor_to_variable_messages(in_messages, out_messages);
+            }, m_tensor);
+        }
+
+        const TensorBase<T> * tensor() const{
+            return std::visit([](auto && tensor) -> const TensorBase<T> *{
+                return &tensor;
+            }, m_tensor);
+        }
+
+    private:
+        variables_type m_variables;
+        tensor_variant_type m_tensor;
+    };
+
+
+
+    // Read only model which serves its factors directly from a memory
+    // mapped file in the binary model format (see io/binary_model.hpp).
+    // Opening only validates the header and the space, nothing is
+    // copied or parsed, pages are loaded on first access and shared
+    // between all processes which map the same file. The indices, the
+    // tensor record and the shape of a factor are checked against the
+    // space and max_arity each time it is accessed (O(arity)), a
+    // corrupted file throws instead of reading outside of the mapping
+    // or handing out factors which do not fit the buffers of solvers.
+    template<class T>
+    class MmapGm : public GmBase<MmapGm<T>>{
+    public:
+        using base_type = GmBase<MmapGm<T>>;
+        using value_type = T;
+        using label_type = std::size_t;
+        using space_type = SpanSpace<label_type>;
+        using labels_vector_type = typename base_type::labels_vector_type;
+        using factor_type = MmapFactor<T>;
+
+        class const_iterator{
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = factor_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = factor_type;
+
+            const_iterator(const MmapGm * gm = nullptr, const std::size_t fi = 0)
+            :   m_gm(gm),
+                m_fi(fi){
+            }
+            reference operator*()const{
+                return (*m_gm)[m_fi];
+            }
+            reference operator[](const difference_type i)const{
+                return (*m_gm)[m_fi + i];
+            }
+            const_iterator & operator++(){
+                ++m_fi;
+                return *this;
+            }
+            const_iterator operator++(int){
+                auto ret = *this;
+                ++m_fi;
+                return ret;
+            }
+            const_iterator & operator--(){
+                --m_fi;
+                return *this;
+            }
+            const_iterator & operator+=(const difference_type n){
+                m_fi += n;
+                return *this;
+            }
+            const_iterator operator+(const difference_type n)const{
+                return const_iterator(m_gm, m_fi + n);
+            }
+            difference_type operator-(const const_iterator & other)const{
+                return difference_type(m_fi) - difference_type(other.m_fi);
+            }
+            bool operator==(const const_iterator & other)const{
+                return m_fi == other.m_fi;
+            }
+            bool operator!=(const const_iterator & other)const{
+                return m_fi != other.m_fi;
+            }
+            bool operator<(const const_iterator & other)const{
+                return m_fi < other.m_fi;
+            }
+        private:
+            const MmapGm * m_gm;
+            std::size_t m_fi;
+        };
+
+        explicit MmapGm(const std::string & path)
+        :   MmapGm(io::MappedFile(path))
+        {
+        }
+
+        explicit MmapGm(io::MappedFile && file)
+        :   m_file(std::move(file)),
+            m_header(),
+            m_space(),
+            m_factor_offsets(nullptr),
+            m_indices(nullptr),
+            m_factor_tensors(nullptr),
+            m_tensor_table(nullptr),
+            m_tensor_pool(nullptr)
+        {
+            if(m_file.size() < sizeof(io::BinaryModelHeader)){
+                io::throw_corrupted_binary_model();
+            }
+            std::memcpy(&m_header, m_file.data(), sizeof(io::BinaryModelHeader));
+            io::check_binary_model_header(m_header, sizeof(value_type), m_file.size());
+
+            const auto data = m_file.data();
+            m_space = space_type(
+                reinterpret_cast<const std::size_t *>(data + m_header.space_offset),
+                m_header.num_variables,
+                m_header.max_num_labels
+            );
+            m_factor_offsets = reinterpret_cast<const std::uint64_t *>(data + m_header.factor_offsets_offset);
+            m_indices = reinterpret_cast<const std::size_t *>(data + m_header.indices_offset);
+            m_factor_tensors = reinterpret_cast<const std::uint64_t *>(data + m_header.factor_tensors_offset);
+            m_tensor_table = reinterpret_cast<const io::BinaryTensorRecord *>(data + m_header.tensor_table_offset);
+            m_tensor_pool = data + m_header.tensor_pool_offset;
+
+            // solvers size their buffers with max_num_labels
+            for(std::size_t vi=0; vi<m_header.num_variables; ++vi){
+                if(m_space[vi] == 0 || m_space[vi] > m_header.max_num_labels){
+                    io::throw_corrupted_binary_model();
+                }
+            }
+        }
+
+        MmapGm(const MmapGm &) = delete;
+        MmapGm & operator=(const MmapGm &) = delete;
+        MmapGm(MmapGm &&) = default;
+        MmapGm & operator=(MmapGm &&) = default;
+
+        const auto & space()const{
+            return m_space;
+        }
+        std::size_t num_factors()const{
+            return m_header.num_factors;
+        }
+        std::size_t num_index_entries()const{
+            return m_header.num_index_entries;
+        }
+        std::size_t num_tensors()const{
+            return m_header.num_tensors;
+        }
+        std::size_t max_arity()const{
+            return m_header.max_arity;
+        }
+        const io::BinaryModelHeader & header()const{
+            return m_header;
+        }
+        const io::MappedFile & file()const{
+            return m_file;
+        }
+
+        factor_type operator[](const std::size_t fi)const{
+            const auto begin = m_factor_offsets[fi];
+            const auto end = m_factor_offsets[fi + 1];
+            // solvers size their buffers with max_arity
+            if(begin > end || end > m_header.num_index_entries || end - begin > m_header.max_arity){
+                io::throw_corrupted_binary_model();
+            }
+            const auto variables = gsl::span<const std::size_t>(m_indices + begin, end - begin);
+            for(auto vi : variables){
+                if(vi >= m_header.num_variables){
+                    io::throw_corrupted_binary_model();
+                }
+            }
+            const auto & record = this->tensor_record(fi);
+            if(record.arity != variables.size()){
+                io::throw_corrupted_binary_model();
+            }
+            const auto kind = io::BinaryTensorKind(record.kind);
+            if(kind != io::BinaryTensorKind::explicit_values){
+                if(record.arity != 2){
+                    io::throw_corrupted_binary_model();
+                }
+                for(auto vi : variables){
+                    if(m_space[vi] != record.num_labels){
+                        io::throw_corrupted_binary_model();
+                    }
+                }
+            }
+            switch(kind){
+                case io::BinaryTensorKind::potts2:
+                    return factor_type(variables, Potts2Tensor<value_type>(record.num_labels, value_type(record.parameters[0])));
+                case io::BinaryTensorKind::l1:
+                    return factor_type(variables, L1Tensor<value_type>(record.num_labels, value_type(record.parameters[0])));
+                case io::BinaryTensorKind::truncated_l1:
+                    return factor_type(variables, TruncatedL1Tensor<value_type>(record.num_labels,
+                        value_type(record.parameters[0]), value_type(record.parameters[1])));
+                default:
+                    break;
+            }
+            this->explicit_tensor_size(record);
+            const auto shape = reinterpret_cast<const std::size_t *>(m_tensor_pool + record.offset);
+            const auto values = reinterpret_cast<const value_type *>(shape + record.arity);
+            for(std::size_t d=0; d<record.arity; ++d){
+                if(shape[d] != m_space[variables[d]]){
+                    io::throw_corrupted_binary_model();
+                }
+            }
+            if(record.arity == 1){
+                return factor_type(variables, UnaryViewTensor<value_type>(values, shape[0]));
+            }
+            return factor_type(variables, ExplicitViewTensor<value_type>(values, shape, record.arity));
+        }
+
+        // byte range of the values of the tensor of factor fi
+        // in the tensor pool, empty for analytic tensors
+        std::pair<std::size_t, std::size_t> tensor_pool_range(const std::size_t fi)const{
+            const auto & record = this->tensor_record(fi);
+            if(io::BinaryTensorKind(record.kind) != io::BinaryTensorKind::explicit_values){
+                return std::make_pair(std::size_t(0), std::size_t(0));
+            }
+            const auto size = this->explicit_tensor_size(record);
+            return std::make_pair(std::size_t(record.offset), std::size_t(record.arity * 8 + size * sizeof(value_type)));
+        }
+
+        const_iterator begin()const{
+            return const_iterator(this, 0);
+        }
+        const_iterator end()const{
+            return const_iterator(this, this->num_factors());
+        }
+        const_iterator cbegin()const{
+            return this->begin();
+        }
+        const_iterator cend()const{
+            return this->end();
+        }
+
+        // all storage is mapped and shared via the page cache,
+        // only the pages which have been touched are resident
+        MemoryStats memory_stats()const{
+            MemoryStats stats;
+            stats.space = sizeof(m_space) + m_header.num_variables * 8;
+            stats.factors = sizeof(*this) + (2 * m_header.num_factors + 1) * 8;
+            stats.variable_indices = m_header.num_index_entries * 8;
+            stats.tensors["MappedTensors"] = m_header.num_tensors * sizeof(io::BinaryTensorRecord) + m_header.tensor_pool_size;
+            return stats;
+        }
+
+    private:
+        const io::BinaryTensorRecord & tensor_record(const std::size_t fi)const{
+            const auto tid = m_factor_tensors[fi];
+            if(tid >= m_header.num_tensors){
+                io::throw_corrupted_binary_model();
+            }
+            return m_tensor_table[tid];
+        }
+
+        // number of values of an explicit tensor, throws if its
+        // shape or its values do not lie within the tensor pool
+        std::size_t explicit_tensor_size(const io::BinaryTensorRecord & record)const{
+            const auto pool_size = m_header.tensor_pool_size;
+            if(record.offset % 8 != 0 || record.offset > pool_size ||
+                record.arity == 0 || record.arity > (pool_size - record.offset) / 8)
+            {
+                io::throw_corrupted_binary_model();
+            }
+            const auto shape = reinterpret_cast<const std::size_t *>(m_tensor_pool + record.offset);
+            const auto max_size = (pool_size - record.offset - record.arity * 8) / sizeof(value_type);
+            std::size_t size = 1;
+            for(std::size_t d=0; d<record.arity; ++d){
+                if(shape[d] == 0 || size > max_size / shape[d]){
+                    io::throw_corrupted_binary_model();
+                }
+                size *= shape[d];
+            }
+            return size;
+        }
+
+        io::MappedFile m_file;
+        io::BinaryModelHeader m_header;
+        space_type m_space;
+        const std::uint64_t * m_factor_offsets;
+        const std::size_t * m_indices;
+        const std::uint64_t * m_factor_tensors;
+        const io::BinaryTensorRecord * m_tensor_table;
+        const char * m_tensor_pool;
+    };
+
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <iterator>
+
+#include "opengm/opengm_config.hpp"
+#include "opengm/gm_base.hpp"
+#include "opengm/mmap_gm.hpp"
+#include "opengm/io/residency.hpp"
+
+namespace opengm{
+
+
+    template<class T>
+    class PagedGm;
+
+    template<class T>
+    class GmTraits<PagedGm<T>>{
+    public:
+        using space_type = SpanSpace<std::size_t>;
+        using label_type = typename SpaceTraits<space_type>::label_type;
+        using value_type = T;
+    };
+
+
+    // Out-of-core variant of MmapGm for models whose tensors do not
+    // fit in memory. The tensor pool of the file is only resident
+    // within the budget of a io::PagedResidency: each access of a factor
+    // marks the chunks of its tensor as used, the least recently used
+    // chunks are dropped when the budget is exceeded and sequential
+    // sweeps are read ahead. Solvers pass the factors of their next
+    // step via prefetch_factors (see gm_base.hpp), Icm, FactorIcm and
+    // DynamicProgramming do so along their sweep order.
+    // The space and the factor indices are mapped as in MmapGm.
+    template<class T>
+    class PagedGm : public GmBase<PagedGm<T>>{
+    public:
+        using base_type = GmBase<PagedGm<T>>;
+        using value_type = T;
+        using label_type = std::size_t;
+        using space_type = SpanSpace<label_type>;
+        using labels_vector_type = typename base_type::labels_vector_type;
+        using mmap_gm_type = MmapGm<T>;
+        using factor_type = MmapFactor<T>;
+
+        class const_iterator{
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = factor_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = factor_type;
+
+            const_iterator(const PagedGm * gm = nullptr, const std::size_t fi = 0)
+            :   m_gm(gm),
+                m_fi(fi){
+            }
+            reference operator*()const{
+                return (*m_gm)[m_fi];
+            }
+            reference operator[](const difference_type i)const{
+                return (*m_gm)[m_fi + i];
+            }
+            const_iterator & operator++(){
+                ++m_fi;
+                return *this;
+            }
+            const_iterator operator++(int){
+                auto ret = *this;
+                ++m_fi;
+                return ret;
+            }
+            const_iterator & operator--(){
+                --m_fi;
+                return *this;
+            }
+            const_iterator & operator+=(const difference_type n){
+                m_fi += n;
+                return *this;
+            }
+            const_iterator operator+(const difference_type n)const{
+                return const_iterator(m_gm, m_fi + n);
+            }
+            difference_type operator-(const const_iterator & other)const{
+                return difference_type(m_fi) - difference_type(other.m_fi);
+            }
+            bool operator==(const const_iterator & other)const{
+                return m_fi == other.m_fi;
+            }
+            bool operator!=(const const_iterator & other)const{
+                return m_fi != other.m_fi;
+            }
+            bool operator<(const const_iterator & other)const{
+                return m_fi < other.m_fi;
+            }
+        private:
+            const PagedGm * m_gm;
+            std::size_t m_fi;
+        };
+
+        explicit PagedGm(const std::string & path, const io::ResidencySettings & settings = io::ResidencySettings())
+        :   m_gm(std::make_unique<mmap_gm_type>(path)),
+            m_residency(std::make_unique<io::PagedResidency>(
+                m_gm->file(),
+                m_gm->header().tensor_pool_offset,
+                m_gm->header().tensor_pool_size,
+                settings
+            ))
+        {
+            // nothing of the pool is resident before the first access
+            m_gm->file().advise_dont_need(m_gm->header().tensor_pool_offset, m_gm->header().tensor_pool_size);
+        }
+
+        const auto & space()const{
+            return m_gm->space();
+        }
+        std::size_t num_factors()const{
+            return m_gm->num_factors();
+        }
+        std::size_t num_index_entries()const{
+            return m_gm->num_index_entries();
+        }
+        std::size_t num_tensors()const{
+            return m_gm->num_tensors();
+        }
+        std::size_t max_arity()const{
+            return m_gm->max_arity();
+        }
+        const mmap_gm_type & mmap_gm()const{
+            return *m_gm;
+        }
+
+        factor_type operator[](const std::size_t fi)const{
+            const auto range = m_gm->tensor_pool_range(fi);
+            m_residency->access(range.first, range.second);
+            return (*m_gm)[fi];
+        }
+
+        template<class ITER>
+        void prefetch_factors(ITER fi_begin, ITER fi_end)const{
+            for(; fi_begin != fi_end; ++fi_begin){
+                const auto range = m_gm->tensor_pool_range(*fi_begin);
+                m_residency->prefetch(range.first, range.second);
+            }
+        }
+
+        io::PagedResidency & residency()const{
+            return *m_residency;
+        }
+        io::ResidencyStats residency_stats()const{
+            return m_residency->stats();
+        }
+
+        const_iterator begin()const{
+            return const_iterator(this, 0);
+        }
+        const_iterator end()const{
+            return const_iterator(this, this->num_factors());
+        }
+        const_iterator cbegin()const{
+            return this->begin();
+        }
+        const_iterator cend()const{
+            return this->end();
+        }
+
+        // the tensors count with the resident bytes of the pool
+        MemoryStats memory_stats()const{
+            auto stats = m_gm->memory_stats();
+            stats.tensors.erase("MappedTensors");
+            stats.tensors["ResidentTensors"] = m_gm->num_tensors() * sizeof(io::BinaryTensorRecord) +
+                m_residency->stats().resident_bytes;
+            stats.factors += sizeof(io::PagedResidency) + m_residency->num_chunks() * 4 * sizeof(void *);
+            return stats;
+        }
+
+    private:
+        // on the heap st. the residency can refer to the mapping
+        std::unique_ptr<mmap_gm_type> m_gm;
+        std::unique_ptr<io::PagedResidency> m_residency;
+    };
+
+}
@@ -0,0 +1,417 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <limits>
+#include <numeric>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+#include "opengm/graphical_model.hpp"
+
+namespace opengm{
+
+
+    enum class ReorderMethod{
+        bfs,
+        reverse_cuthill_mckee
+    };
+
+
+namespace detail{
+
+    // CSR adjacency of the variables, two variables are
+    // adjacent iff they share a factor.
+    class VariableAdjacency{
+    public:
+        template<class GM>
+        VariableAdjacency(const GM & gm)
+        :   m_offsets(gm.num_variables() + 1, 0),
+            m_neighbours()
+        {
+            std::vector<std::vector<std::size_t>> adjacency(gm.num_variables());
+            for(auto && factor : gm){
+                auto && variables = factor.variables();
+                for(auto v0 : variables){
+                    for(auto v1 : variables){
+                        if(v0 != v1){
+                            adjacency[v0].push_back(v1);
+                        }
+                    }
+                }
+            }
+            for(std::size_t vi=0; vi<adjacency.size(); ++vi){
+                auto & adj = adjacency[vi];
+                std::sort(adj.begin(), adj.end());
+                adj.erase(std::unique(adj.begin(), adj.end()), adj.end());
+                m_offsets[vi + 1] = m_offsets[vi] + adj.size();
+            }
+            m_neighbours.reserve(m_offsets.back());
+            for(auto && adj : adjacency){
+                m_neighbours.insert(m_neighbours.end(), adj.begin(), adj.end());
+            }
+        }
+        std::size_t size()const{
+            return m_offsets.size() - 1;
+        }
+        std::size_t degree(const std::size_t vi)const{
+            return m_offsets[vi + 1] - m_offsets[vi];
+        }
+        const std::size_t * begin(const std::size_t vi)const{
+            return m_neighbours.data() + m_offsets[vi];
+        }
+        const std::size_t * end(const std::size_t vi)const{
+            return m_neighbours.data() + m_offsets[vi + 1];
+        }
+    private:
+        std::vector<std::size_t> m_offsets;
+        std::vector<std::size_t> m_neighbours;
+    };
+
+    // bfs from root, appends the visited variables to order.
+    // if by_degree is true, neighbours are visited with ascending degree
+    inline void bfs_visit(
+        const VariableAdjacency & adjacency,
+        const std::size_t root,
+        const bool by_degree,
+        std::vector<bool> & visited,
+        std::vector<std::size_t> & order
+    ){
+        std::size_t head = order.size();
+        order.push_back(root);
+        visited[root] = true;
+        while(head < order.size()){
+            const auto vi = order[head++];
+            const auto first_new = order.size();
+            for(auto n = adjacency.begin(vi); n != adjacency.end(vi); ++n){
+                if(!visited[*n]){
+                    visited[*n] = true;
+                    order.push_back(*n);
+                }
+            }
+            if(by_degree){
+                std::stable_sort(order.begin() + first_new, order.end(), [&](auto a, auto b){
+                    return adjacency.degree(a) < adjacency.degree(b);
+                });
+            }
+        }
+    }
+
+    // George-Liu heuristic: start with a min degree variable and
+    // move to a min degree variable of the last bfs level as long
+    // as the eccentricity grows.
+    // level must be filled with unvisited and is restored on return.
+    inline std::size_t pseudo_peripheral_variable(
+        const VariableAdjacency & adjacency,
+        const std::vector<std::size_t> & component,
+        std::vector<std::size_t> & level,
+        std::vector<std::size_t> & queue
+    ){
+        const auto unvisited = std::numeric_limits<std::size_t>::max();
+        auto reset = [&](){
+            for(auto vi : queue){
+                level[vi] = unvisited;
+            }
+        };
+
+        auto root = *std::min_element(component.begin(), component.end(), [&](auto a, auto b){
+            return adjacency.degree(a) < adjacency.degree(b);
+        });
+        std::size_t eccentricity = 0;
+        queue.clear();
+        for(;;){
+            reset();
+            queue.assign(1, root);
+            level[root] = 0;
+            for(std::size_t head=0; head<queue.size(); ++head){
+                const auto vi = queue[head];
+                for(auto n = adjacency.begin(vi); n != adjacency.end(vi); ++n){
+                    if(level[*n] == unvisited){
+                        level[*n] = level[vi] + 1;
+                        queue.push_back(*n);
+                    }
+                }
+            }
+            const auto max_level = level[queue.back()];
+            if(max_level <= eccentricity && eccentricity != 0){
+                reset();
+                return root;
+            }
+            eccentricity = max_level;
+            auto best = root;
+            auto best_degree = std::numeric_limits<std::size_t>::max();
+            for(auto vi : queue){
+                if(level[vi] == max_level && adjacency.degree(vi) < best_degree){
+                    best = vi;
+                    best_degree = adjacency.degree(vi);
+                }
+            }
+            if(best == root){
+                reset();
+                return root;
+            }
+            root = best;
+        }
+    }
+
+    // Skilling's transposed hilbert index, bits per axis times
+    // DIM must not exceed 64
+    template<std::size_t DIM>
+    std::uint64_t hilbert_index(std::array<std::uint64_t, DIM> x, const std::size_t bits){
+        const std::uint64_t m = std::uint64_t(1) << (bits - 1);
+        // inverse undo
+        for(std::uint64_t q = m; q > 1; q >>= 1){
+            const auto p = q - 1;
+            for(std::size_t i=0; i<DIM; ++i){
+                if(x[i] & q){
+                    x[0] ^= p;
+                }
+                else{
+                    const auto t = (x[0] ^ x[i]) & p;
+                    x[0] ^= t;
+                    x[i] ^= t;
+                }
+            }
+        }
+        // gray encode
+        for(std::size_t i=1; i<DIM; ++i){
+            x[i] ^= x[i-1];
+        }
+        std::uint64_t t = 0;
+        for(std::uint64_t q = m; q > 1; q >>= 1){
+            if(x[DIM-1] & q){
+                t ^= q - 1;
+            }
+        }
+        for(std::size_t i=0; i<DIM; ++i){
+            x[i] ^= t;
+        }
+        // interleave
+        std::uint64_t index = 0;
+        for(std::size_t b=bits; b-- > 0;){
+            for(std::size_t i=0; i<DIM; ++i){
+                index = (index << 1) | ((x[i] >> b) & 1);
+            }
+        }
+        return index;
+    }
+}
+
+    // variable order of a breadth first search, one component after another.
+    // order[new_vi] = old_vi
+    template<class GM>
+    std::vector<std::size_t> bfs_order(const GM & gm){
+        detail::VariableAdjacency adjacency(gm);
+        std::vector<bool> visited(adjacency.size(), false);
+        std::vector<std::size_t> order;
+        order.reserve(adjacency.size());
+        for(std::size_t vi=0; vi<adjacency.size(); ++vi){
+            if(!visited[vi]){
+                detail::bfs_visit(adjacency, vi, false, visited, order);
+            }
+        }
+        return order;
+    }
+
+    // bandwidth reducing reverse Cuthill-McKee order.
+    // order[new_vi] = old_vi
+    template<class GM>
+    std::vector<std::size_t> reverse_cuthill_mckee_order(const GM & gm){
+        detail::VariableAdjacency adjacency(gm);
+        std::vector<bool> visited(adjacency.size(), false);
+        std::vector<bool> in_component(adjacency.size(), false);
+        std::vector<std::size_t> order;
+        std::vector<std::size_t> component;
+        std::vector<std::size_t> level(adjacency.size(), std::numeric_limits<std::size_t>::max());
+        std::vector<std::size_t> queue;
+        order.reserve(adjacency.size());
+        for(std::size_t vi=0; vi<adjacency.size(); ++vi){
+            if(!in_component[vi]){
+                component.clear();
+                detail::bfs_visit(adjacency, vi, false, in_component, component);
+                const auto root = detail::pseudo_peripheral_variable(adjacency, component, level, queue);
+                detail::bfs_visit(adjacency, root, true, visited, order);
+            }
+        }
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
+
+    // order of the variables along a hilbert curve through the
+    // given coordinates (one std::array<T, DIM> per variable).
+    // order[new_vi] = old_vi
+    template<class COORDINATES>
+    std::vector<std::size_t> hilbert_order(const COORDINATES & coordinates){
+        using coordinate_type = std::decay_t<decltype(coordinates[0])>;
+        constexpr std::size_t dim = std::tuple_size<coordinate_type>::value;
+        static_assert(dim >= 1 && dim <= 8, "hilbert order is only implemented for 1 to 8 dimensions");
+        constexpr std::size_t bits = std::min(std::size_t(31), 64 / dim);
+
+        const std::size_t n = coordinates.size();
+        std::vector<std::size_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        if(n == 0){
+            return order;
+        }
+
+        // quantize on a 2^bits grid
+        std::array<double, dim> lo, hi;
+        for(std::size_t d=0; d<dim; ++d){
+            lo[d] = hi[d] = double(coordinates[0][d]);
+        }
+        for(std::size_t i=1; i<n; ++i){
+            for(std::size_t d=0; d<dim; ++d){
+                lo[d] = std::min(lo[d], double(coordinates[i][d]));
+                hi[d] = std::max(hi[d], double(coordinates[i][d]));
+            }
+        }
+        const auto max_cell = double((std::uint64_t(1) << bits) - 1);
+        std::vector<std::uint64_t> keys(n);
+        for(std::size_t i=0; i<n; ++i){
+            std::array<std::uint64_t, dim> cell;
+            for(std::size_t d=0; d<dim; ++d){
+                const auto extent = hi[d] - lo[d];
+                cell[d] = extent > 0 ? std::uint64_t((double(coordinates[i][d]) - lo[d]) / extent * max_cell) : 0;
+            }
+            keys[i] = detail::hilbert_index<dim>(cell, bits);
+        }
+        std::stable_sort(order.begin(), order.end(), [&](auto a, auto b){
+            return keys[a] < keys[b];
+        });
+        return order;
+    }
+
+
+    // A copy of a model with permuted variables.
+    // The factors are sorted by their smallest new variable index st.
+    // sweeps over factors and variables touch memory in a local way.
+    // Tensors shared between factors stay shared in the copy.
+    template<class GM>
+    class ReorderedGm{
+    public:
+        using value_type = typename GM::value_type;
+        using space_type = typename GM::space_type::subspace_type;
+        using gm_type = GraphicalModel<space_type, value_type>;
+
+        ReorderedGm(const GM & gm, const ReorderMethod method = ReorderMethod::reverse_cuthill_mckee)
+        :   ReorderedGm(gm, method == ReorderMethod::bfs ? bfs_order(gm) : reverse_cuthill_mckee_order(gm))
+        {
+        }
+
+        // new_to_old[new_vi] = old_vi, for instance from hilbert_order
+        ReorderedGm(const GM & gm, std::vector<std::size_t> new_to_old)
+        :   m_new_to_old(checked_permutation(gm, std::move(new_to_old))),
+            m_old_to_new(gm.num_variables()),
+            m_gm(gm.space().subspace(m_new_to_old.begin(), m_new_to_old.end()))
+        {
+            for(std::size_t new_vi=0; new_vi<m_new_to_old.size(); ++new_vi){
+                m_old_to_new[m_new_to_old[new_vi]] = new_vi;
+            }
+
+            // order the factors by their smallest new variable
+            const auto num_factors = gm.num_factors();
+            std::vector<std::size_t> factor_key(num_factors);
+            std::size_t num_index_entries = 0;
+            for(std::size_t fi=0; fi<num_factors; ++fi){
+                auto && variables = gm[fi].variables();
+                auto key = std::numeric_limits<std::size_t>::max();
+                for(auto vi : variables){
+                    key = std::min(key, m_old_to_new[vi]);
+                }
+                factor_key[fi] = key;
+                num_index_entries += variables.size();
+            }
+            m_new_to_old_factor.resize(num_factors);
+            std::iota(m_new_to_old_factor.begin(), m_new_to_old_factor.end(), 0);
+            std::stable_sort(m_new_to_old_factor.begin(), m_new_to_old_factor.end(), [&](auto a, auto b){
+                return factor_key[a] < factor_key[b];
+            });
+
+            // shared tensors are cloned once if the factors of the model
+            // are stable references, the tensor of a factor proxy (e.g.
+            // of GridGm) lives in the proxy and is cloned per factor
+            constexpr bool stable_tensors = std::is_reference<decltype(gm[std::size_t(0)])>::value;
+            m_gm.reserve(num_factors, num_index_entries, 0);
+            std::unordered_map<const TensorBase<value_type> *, std::size_t> tensor_ids;
+            std::vector<std::size_t> variables_buffer(gm.arity_upper_bound());
+            for(auto old_fi : m_new_to_old_factor){
+                auto && factor = gm[old_fi];
+                const auto tensor = factor.tensor();
+                std::size_t tid;
+                if constexpr(stable_tensors){
+                    auto iter = tensor_ids.find(tensor);
+                    if(iter == tensor_ids.end()){
+                        iter = tensor_ids.emplace(tensor, m_gm.add_tensor(tensor->clone())).first;
+                    }
+                    tid = iter->second;
+                }
+                else{
+                    tid = m_gm.add_tensor(tensor->clone());
+                }
+                auto && variables = factor.variables();
+                std::size_t i = 0;
+                for(auto vi : variables){
+                    variables_buffer[i++] = m_old_to_new[vi];
+                }
+                m_gm.add_factor(tid, variables_buffer.begin(), variables_buffer.begin() + i);
+            }
+        }
+
+        const gm_type & gm()const{
+            return m_gm;
+        }
+        // new_to_old()[new_vi] = old_vi
+        const std::vector<std::size_t> & new_to_old()const{
+            return m_new_to_old;
+        }
+        // old_to_new()[old_vi] = new_vi
+        const std::vector<std::size_t> & old_to_new()const{
+            return m_old_to_new;
+        }
+        // new_to_old_factor()[new_fi] = old_fi
+        const std::vector<std::size_t> & new_to_old_factor()const{
+            return m_new_to_old_factor;
+        }
+
+        // map a labeling of the reordered model to the original model
+        template<class LABELS_IN, class LABELS_OUT>
+        void to_original_labels(const LABELS_IN & reordered_labels, LABELS_OUT & labels)const{
+            for(std::size_t new_vi=0; new_vi<m_new_to_old.size(); ++new_vi){
+                labels[m_new_to_old[new_vi]] = reordered_labels[new_vi];
+            }
+        }
+        // map a labeling of the original model to the reordered model
+        template<class LABELS_IN, class LABELS_OUT>
+        void to_reordered_labels(const LABELS_IN & labels, LABELS_OUT & reordered_labels)const{
+            for(std::size_t new_vi=0; new_vi<m_new_to_old.size(); ++new_vi){
+                reordered_labels[new_vi] = labels[m_new_to_old[new_vi]];
+            }
+        }
+
+    private:
+        // throws unless new_to_old contains each variable of gm exactly once,
+        // runs before the subspace is built from it
+        static std::vector<std::size_t> checked_permutation(const GM & gm, std::vector<std::size_t> new_to_old){
+            if(new_to_old.size() != gm.num_variables()){
+                throw std::runtime_error("new_to_old must contain each variable exactly once");
+            }
+            std::vector<bool> seen(gm.num_variables(), false);
+            for(auto old_vi : new_to_old){
+                if(old_vi >= seen.size() || seen[old_vi]){
+                    throw std::runtime_error("new_to_old must contain each variable exactly once");
+                }
+                seen[old_vi] = true;
+            }
+            return new_to_old;
+        }
+
+        std::vector<std::size_t> m_new_to_old;
+        std::vector<std::size_t> m_old_to_new;
+        std::vector<std::size_t> m_new_to_old_factor;
+        gm_type m_gm;
+    };
+
+}
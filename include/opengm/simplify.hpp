@@ -0,0 +1,330 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include "opengm/graphical_model.hpp"
+#include "opengm/tensors.hpp"
+#include "opengm/utils.hpp"
+
+namespace opengm{
+
+
+namespace detail{
+
+    // sum of analytic tensors of the same type and parameters,
+    // nullptr if the tensors cannot be merged analytically
+    template<class T>
+    std::unique_ptr<TensorBase<T>> merge_analytic(const std::vector<const TensorBase<T> *> & tensors){
+        auto merge = [&](auto * first, auto && compatible, auto && make) -> std::unique_ptr<TensorBase<T>>{
+            using tensor_type = std::decay_t<decltype(*first)>;
+            auto beta = T(0);
+            for(auto tensor : tensors){
+                auto typed_tensor = dynamic_cast<const tensor_type *>(tensor);
+                if(typed_tensor == nullptr || !compatible(*first, *typed_tensor)){
+                    return nullptr;
+                }
+                beta += typed_tensor->beta();
+            }
+            return make(*first, beta);
+        };
+        const auto same_num_labels = [](auto && a, auto && b){
+            return a.num_labels() == b.num_labels();
+        };
+        if(auto potts = dynamic_cast<const Potts2Tensor<T> *>(tensors.front())){
+            return merge(potts, same_num_labels, [](auto && t, auto beta){
+                return std::make_unique<Potts2Tensor<T>>(t.num_labels(), beta);
+            });
+        }
+        if(auto l1 = dynamic_cast<const L1Tensor<T> *>(tensors.front())){
+            return merge(l1, same_num_labels, [](auto && t, auto beta){
+                return std::make_unique<L1Tensor<T>>(t.num_labels(), beta);
+            });
+        }
+        if(auto tl1 = dynamic_cast<const TruncatedL1Tensor<T> *>(tensors.front())){
+            return merge(tl1, [](auto && a, auto && b){
+                return a.num_labels() == b.num_labels() && a.truncation() == b.truncation();
+            }, [](auto && t, auto beta){
+                return std::make_unique<TruncatedL1Tensor<T>>(t.num_labels(), beta, t.truncation());
+            });
+        }
+        return nullptr;
+    }
+
+    // true if the tensor is known to be zero everywhere
+    // without looking at its values
+    template<class T>
+    bool is_analytic_zero(const TensorBase<T> * tensor){
+        if(auto potts = dynamic_cast<const Potts2Tensor<T> *>(tensor)){
+            return potts->beta() == T(0);
+        }
+        if(auto l1 = dynamic_cast<const L1Tensor<T> *>(tensor)){
+            return l1->beta() == T(0);
+        }
+        if(auto tl1 = dynamic_cast<const TruncatedL1Tensor<T> *>(tensor)){
+            return tl1->beta() == T(0) || tl1->truncation() == T(0);
+        }
+        return false;
+    }
+
+    template<class T>
+    bool is_constant(const std::vector<T> & values){
+        return std::all_of(values.begin(), values.end(), [&](auto v){
+            return v == values.front();
+        });
+    }
+}
+
+
+    struct SimplifySettings{
+        // sum factors over the same set of variables into one factor
+        bool merge_parallel_factors{true};
+        // remove factors with a constant value and add it to the offset
+        bool remove_constant_factors{true};
+        // tensors with more states are never checked for being constant
+        // and never merged densely
+        std::size_t max_dense_size{1<<20};
+    };
+
+
+    // A simplified copy of a model:
+    // Factors over the same set of variables are summed into a single
+    // factor. Sums of Potts / L1 / truncated L1 tensors with matching
+    // parameters stay analytic, all other sums are stored densely.
+    // Constant factors are removed and their values are accumulated
+    // in offset() st. for all labelings:
+    //      gm.evaluate(labels) == simplified.gm().evaluate(labels) + simplified.offset()
+    // The variables are not changed.
+    template<class GM>
+    class SimplifiedGm{
+    public:
+        using value_type = typename GM::value_type;
+        using space_type = typename GM::space_type;
+        using gm_type = GraphicalModel<space_type, value_type>;
+        using settings_type = SimplifySettings;
+
+        // marks a factor which has been removed
+        static constexpr std::size_t removed = std::numeric_limits<std::size_t>::max();
+
+        SimplifiedGm(const GM & gm, const settings_type & settings = settings_type())
+        :   m_gm(space_type(gm.space())),
+            m_offset(0),
+            m_old_to_new_factor(gm.num_factors(), removed)
+        {
+            const auto num_factors = gm.num_factors();
+
+            // group the factors by their sorted scope
+            std::vector<std::size_t> scope_offsets(num_factors + 1, 0);
+            std::vector<std::size_t> scopes;
+            for(std::size_t fi=0; fi<num_factors; ++fi){
+                auto && variables = gm[fi].variables();
+                scopes.insert(scopes.end(), variables.begin(), variables.end());
+                std::sort(scopes.begin() + scope_offsets[fi], scopes.end());
+                scope_offsets[fi + 1] = scopes.size();
+            }
+            auto scope_less = [&](auto a, auto b){
+                return std::lexicographical_compare(
+                    scopes.begin() + scope_offsets[a], scopes.begin() + scope_offsets[a + 1],
+                    scopes.begin() + scope_offsets[b], scopes.begin() + scope_offsets[b + 1]
+                );
+            };
+            std::vector<std::size_t> order(num_factors);
+            std::iota(order.begin(), order.end(), 0);
+            if(settings.merge_parallel_factors){
+                std::stable_sort(order.begin(), order.end(), scope_less);
+            }
+
+            // groups as [begin, end) into order, kept in the order
+            // of their first factor st. the factor order is preserved
+            std::vector<std::pair<std::size_t, std::size_t>> groups;
+            for(std::size_t i=0; i<num_factors;){
+                auto j = i + 1;
+                while(settings.merge_parallel_factors && j < num_factors &&
+                    !scope_less(order[i], order[j]) && !scope_less(order[j], order[i]))
+                {
+                    ++j;
+                }
+                groups.emplace_back(i, j);
+                i = j;
+            }
+            std::sort(groups.begin(), groups.end(), [&](auto && a, auto && b){
+                return order[a.first] < order[b.first];
+            });
+
+            // shared tensors are cloned once if the factors of the model
+            // are stable references. The tensor of a factor proxy (e.g. of
+            // GridGm) lives in the proxy: it is cloned per factor and the
+            // proxies of a group are kept alive while it is merged.
+            constexpr bool stable_tensors = std::is_reference<decltype(gm[std::size_t(0)])>::value;
+            using proxy_type = std::conditional_t<stable_tensors, char, std::decay_t<decltype(gm[std::size_t(0)])>>;
+            std::vector<proxy_type> proxies;
+            std::unordered_map<const TensorBase<value_type> *, std::size_t> tensor_ids;
+            std::vector<const TensorBase<value_type> *> tensors;
+            std::vector<value_type> values;
+            std::vector<std::size_t> labels;
+            std::vector<std::size_t> factor_labels;
+            std::vector<std::size_t> position;
+
+            // add a (merged) factor unless it is constant
+            auto add_factor = [&](
+                const TensorBase<value_type> * tensor,
+                std::unique_ptr<TensorBase<value_type>> owned_tensor,
+                bool has_values,
+                const std::size_t group_begin,
+                const std::size_t group_end
+            ){
+                const auto old_fi = order[group_begin];
+                if(settings.remove_constant_factors){
+                    auto constant = detail::is_analytic_zero(tensor);
+                    auto constant_value = value_type(0);
+                    if(!constant && !has_values){
+                        std::size_t size = 1;
+                        for(std::size_t a=0; a<tensor->arity(); ++a){
+                            size *= tensor->shape(a);
+                        }
+                        if(size <= settings.max_dense_size){
+                            values.assign(size, value_type(0));
+                            tensor->add_values(values.data());
+                            has_values = true;
+                        }
+                    }
+                    if(!constant && has_values && detail::is_constant(values)){
+                        constant = true;
+                        constant_value = values.front();
+                    }
+                    if(constant){
+                        m_offset += constant_value;
+                        return;
+                    }
+                }
+
+                std::size_t tid;
+                if(owned_tensor){
+                    tid = m_gm.add_tensor(std::move(owned_tensor));
+                }
+                else if constexpr(!stable_tensors){
+                    tid = m_gm.add_tensor(tensor->clone());
+                }
+                else{
+                    auto iter = tensor_ids.find(tensor);
+                    if(iter == tensor_ids.end()){
+                        iter = tensor_ids.emplace(tensor, m_gm.add_tensor(tensor->clone())).first;
+                    }
+                    tid = iter->second;
+                }
+                auto && variables = gm[old_fi].variables();
+                const auto new_fi = m_gm.add_factor(tid, variables.begin(), variables.end());
+                for(auto i=group_begin; i<group_end; ++i){
+                    m_old_to_new_factor[order[i]] = new_fi;
+                }
+            };
+
+            for(auto && [begin, end] : groups){
+                auto && first = gm[order[begin]];
+                auto && variables = first.variables();
+                const auto arity = first.arity();
+
+                if(end - begin == 1){
+                    add_factor(first.tensor(), nullptr, false, begin, end);
+                    continue;
+                }
+
+                tensors.clear();
+                if constexpr(stable_tensors){
+                    for(auto i=begin; i<end; ++i){
+                        tensors.push_back(gm[order[i]].tensor());
+                    }
+                }
+                else{
+                    proxies.clear();
+                    for(auto i=begin; i<end; ++i){
+                        proxies.push_back(gm[order[i]]);
+                    }
+                    for(auto && proxy : proxies){
+                        tensors.push_back(proxy.tensor());
+                    }
+                }
+                if(auto merged = detail::merge_analytic<value_type>(tensors)){
+                    const auto tensor = merged.get();
+                    add_factor(tensor, std::move(merged), false, begin, end);
+                    continue;
+                }
+
+                const auto shape = first.tensor()->shape();
+                const auto size = std::accumulate(shape.begin(), shape.end(), std::size_t(1), std::multiplies<std::size_t>());
+                if(size > settings.max_dense_size){
+                    // too large to be merged
+                    for(auto i=begin; i<end; ++i){
+                        add_factor(tensors[i - begin], nullptr, false, i, i + 1);
+                    }
+                    continue;
+                }
+
+                // dense sum in the variable order of the first factor
+                values.assign(size, value_type(0));
+                first.add_values(values.data());
+                labels.resize(arity);
+                factor_labels.resize(arity);
+                position.resize(arity);
+                for(auto i=begin + 1; i<end; ++i){
+                    auto && factor = gm[order[i]];
+                    auto && factor_variables = factor.variables();
+                    if(std::equal(variables.begin(), variables.end(), factor_variables.begin())){
+                        factor.add_values(values.data());
+                        continue;
+                    }
+                    for(std::size_t a=0; a<arity; ++a){
+                        position[a] = std::distance(variables.begin(),
+                            std::find(variables.begin(), variables.end(), factor_variables[a]));
+                    }
+                    std::size_t state = 0;
+                    detail::for_each_state(arity, shape, labels, [&](auto && labels){
+                        for(std::size_t a=0; a<arity; ++a){
+                            factor_labels[a] = labels[position[a]];
+                        }
+                        values[state] += factor[factor_labels.data()];
+                        ++state;
+                    });
+                }
+
+                std::unique_ptr<TensorBase<value_type>> merged;
+                if(arity == 1){
+                    merged = std::make_unique<UnaryTensor<value_type>>(values.begin(), values.end());
+                }
+                else{
+                    using xshape_type = typename XArrayTensor<value_type>::xshape_type;
+                    auto dense_tensor = std::make_unique<XArrayTensor<value_type>>(xshape_type(shape.begin(), shape.end()));
+                    std::copy(values.begin(), values.end(), dense_tensor->xexpression().begin());
+                    merged = std::move(dense_tensor);
+                }
+                const auto tensor = merged.get();
+                add_factor(tensor, std::move(merged), true, begin, end);
+            }
+        }
+
+        const gm_type & gm()const{
+            return m_gm;
+        }
+        // energy of the removed constant factors
+        value_type offset()const{
+            return m_offset;
+        }
+        // old_to_new_factor()[old_fi] is the factor of the simplified
+        // model which contains old_fi or removed
+        const std::vector<std::size_t> & old_to_new_factor()const{
+            return m_old_to_new_factor;
+        }
+
+    private:
+        gm_type m_gm;
+        value_type m_offset;
+        std::vector<std::size_t> m_old_to_new_factor;
+    };
+
+}
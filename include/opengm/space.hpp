@@ -43,6 +43,11 @@ namespace opengm {
             return true;
         }
 
+        // bytes used by the space
+        std::size_t memory_usage()const{
+            return sizeof(derived_t);
+        }
+
 
         template<class LABELS, class F>
         void for_each_state(
@@ -183,12 +188,17 @@ namespace opengm {
             self_type ret(std::distance(begin, end));
             auto i=0;
             while(begin != end){
-                ret.m_space[i] = *begin;
+                ret.m_space[i] = m_space[*begin];
                 ++begin;
+                ++i;
             }
             return ret;
         }
 
+        std::size_t memory_usage()const{
+            return sizeof(self_type) + m_space.capacity() * sizeof(std::size_t);
+        }
+
     private:
         std::vector<std::size_t> m_space;
     };
@@ -202,6 +212,56 @@ namespace opengm {
 
 
 
+    // non-owning space viewing an external array
+    // with the number of labels of each variable
+    template<class label_type>
+    class SpanSpace : public SpaceBase<SpanSpace<label_type>>{
+    public:
+        using self_type = SpanSpace<label_type>;
+        using subspace_type = ExplicitSpace<label_type>;
+
+        SpanSpace(const std::size_t * num_labels = nullptr, const std::size_t num_var = 0, const label_type max_num_labels = 0)
+        :   m_num_labels(num_labels),
+            m_num_var(num_var),
+            m_max_num_labels(max_num_labels)
+        {
+        }
+
+        auto operator[](const std::size_t var)const{
+            return label_type(m_num_labels[var]);
+        }
+        auto size()const{
+            return m_num_var;
+        }
+        auto max_num_labels()const{
+            return m_max_num_labels;
+        }
+
+        template<class VI_ITER>
+        subspace_type subspace(VI_ITER begin, VI_ITER end)const{
+            std::vector<std::size_t> num_labels;
+            num_labels.reserve(std::distance(begin, end));
+            for(; begin != end; ++begin){
+                num_labels.push_back(m_num_labels[*begin]);
+            }
+            return subspace_type(num_labels.begin(), num_labels.end());
+        }
+
+    private:
+        const std::size_t * m_num_labels;
+        std::size_t m_num_var;
+        label_type m_max_num_labels;
+    };
+
+    template<class label_type_t>
+    class SpaceTraits< SpanSpace<label_type_t>>{
+    public:
+        using label_type = label_type_t;
+        using subspace_type = ExplicitSpace<label_type_t>;
+    };
+
+
+
     template<class label_type,label_type num_labels>
     class StaticNumLabelsSpace : public SpaceBase<StaticNumLabelsSpace<label_type, num_labels>>{
     public:
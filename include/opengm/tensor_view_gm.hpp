@@ -4,6 +4,8 @@
 #include <vector>
 #include <memory>
 #include <utility>
+#include <iterator>
+#include <algorithm>
 
 
 #include "opengm/meta.hpp"
@@ -43,33 +45,108 @@ namespace opengm{
         template<class ... ARGS>
         TensorViewGm(ARGS && ... args)
         :   m_space(std::forward<ARGS>(args)...),
-            m_factors()
+            m_factors(),
+            m_variable_indices(),
+            m_factors_of_arity()
         {
 
         }
 
         TensorViewGm(space_type && space)
         :   m_space(space),
-            m_factors()
+            m_factors(),
+            m_variable_indices(),
+            m_factors_of_arity()
         {
 
         }
 
-        template<class ITER>
-        auto add_factor(tensor_type * tensor, ITER var_begin, ITER var_end){
-            const auto fid = m_factors.size();
-            m_factors.emplace_back(tensor, var_begin, var_end);
-            return fid;
+        // the factors point into m_variable_indices
+        // and need to be rebased on copy
+        TensorViewGm(const TensorViewGm & other)
+        :   m_space(other.m_space),
+            m_factors(other.m_factors),
+            m_variable_indices(other.m_variable_indices),
+            m_factors_of_arity(other.m_factors_of_arity)
+        {
+            this->rebase();
+        }
+        TensorViewGm(TensorViewGm && other) = default;
+
+        TensorViewGm & operator=(const TensorViewGm & other){
+            m_space = other.m_space;
+            m_factors = other.m_factors;
+            m_variable_indices = other.m_variable_indices;
+            m_factors_of_arity = other.m_factors_of_arity;
+            this->rebase();
+            return *this;
         }
+        TensorViewGm & operator=(TensorViewGm && other) = default;
 
+        // reserve storage for num_factors factors with
+        // num_index_entries variable indices in total
+        void reserve(const std::size_t num_factors, const std::size_t num_index_entries){
+            m_factors.reserve(num_factors);
+            this->reserve_variable_indices(num_index_entries);
+        }
+
+        std::size_t num_index_entries()const{
+            return m_variable_indices.size();
+        }
 
         template<class ITER>
         auto add_factor(const tensor_type * tensor, ITER var_begin, ITER var_end){
             const auto fid = m_factors.size();
-            m_factors.emplace_back(tensor, var_begin, var_end);
+            const auto offset = m_variable_indices.size();
+            const auto num_variables = std::size_t(std::distance(var_begin, var_end));
+            if(m_variable_indices.capacity() < offset + num_variables){
+                this->reserve_variable_indices(std::max(offset + num_variables, 2 * m_variable_indices.capacity()));
+            }
+            m_variable_indices.insert(m_variable_indices.end(), var_begin, var_end);
+            m_factors.emplace_back(tensor, m_variable_indices.data() + offset, num_variables);
+            if(m_factors_of_arity.size() <= num_variables){
+                m_factors_of_arity.resize(num_variables + 1);
+            }
+            m_factors_of_arity[num_variables].push_back(fid);
             return fid;
         }
 
+        // ids of all factors of the given arity in ascending order
+        gsl::span<const std::size_t> factors_of_arity(const std::size_t arity)const{
+            if(arity >= m_factors_of_arity.size()){
+                return gsl::span<const std::size_t>();
+            }
+            auto && factors = m_factors_of_arity[arity];
+            return gsl::span<const std::size_t>(factors.data(), factors.size());
+        }
+
+        // only the factors of arity ARITY are visited, the
+        // factor passed to f still has a runtime arity
+        template<std::size_t ARITY, class F>
+        void for_each_factor_of_arity(F && f)const{
+            for(auto fi : this->factors_of_arity(ARITY)){
+                f(fi, m_factors[fi]);
+            }
+        }
+
+        // the factors are visited ordered by arity
+        template<std::size_t MIN_ARITY, class F>
+        void for_each_factor_of_min_arity(F && f)const{
+            for(auto arity=MIN_ARITY; arity<m_factors_of_arity.size(); ++arity){
+                for(auto fi : m_factors_of_arity[arity]){
+                    f(fi, m_factors[fi]);
+                }
+            }
+        }
+
+        std::size_t max_arity()const{
+            auto arity = m_factors_of_arity.size();
+            while(arity > 0 && m_factors_of_arity[arity - 1].empty()){
+                --arity;
+            }
+            return arity == 0 ? 0 : arity - 1;
+        }
+
         auto cbegin() const{
             return m_factors.cbegin();
         }
@@ -95,12 +172,51 @@ namespace opengm{
         const auto & operator[](const std::size_t fi)const{
             return m_factors[fi];
         }
+        // the tensors are not owned and therefore not counted
+        MemoryStats memory_stats()const{
+            MemoryStats stats;
+            stats.factors = detail::heap_bytes(m_factors) + detail::heap_bytes(m_factors_of_arity);
+            stats.variable_indices = detail::heap_bytes(m_variable_indices);
+            stats.space = m_space.memory_usage();
+            return stats;
+        }
+
         void clear(){
             m_factors.clear();
+            m_variable_indices.clear();
+            // keep the capacity of the buckets for reuse
+            for(auto & factors : m_factors_of_arity){
+                factors.clear();
+            }
         }
     private:
 
+        void reserve_variable_indices(const std::size_t num_index_entries){
+            if(num_index_entries > m_variable_indices.capacity()){
+                m_variable_indices.reserve(num_index_entries);
+                this->rebase();
+            }
+        }
+
+        // point the factors into m_variable_indices. The indices of
+        // the factors are stored consecutively in factor order, the
+        // offsets are therefore recomputed from the arities and never
+        // from pointers into a buffer which may already be freed
+        void rebase(){
+            const auto data = m_variable_indices.data();
+            std::size_t offset = 0;
+            for(auto & factor : m_factors){
+                const auto arity = factor.variables().size();
+                factor = VFactor<T>(factor.tensor(), data + offset, arity);
+                offset += arity;
+            }
+        }
+
         space_type m_space;
         std::vector<VFactor<T>> m_factors;
+        // variable indices of all factors, stored consecutively
+        std::vector<std::size_t> m_variable_indices;
+        // factor ids grouped by arity
+        std::vector<std::vector<std::size_t>> m_factors_of_arity;
     };
 }
\ No newline at end of file
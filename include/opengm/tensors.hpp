@@ -1,7 +1,9 @@
 #pragma once
 
+#include <string>
 #include <vector>
 #include <numeric>
+#include <functional>
 #include <cmath>
 #include <mutex>
 
@@ -95,7 +97,7 @@ namespace detail{
         {
             for(auto l1=0; l1 < nl_1; ++l1)
             {
-                const value_type facVal = vt->eval(l0, l1);
+                const value_type facVal = vt->operator()(l0, l1);
                 out_messages[0][l0] = std::min(out_messages[0][l0], facVal + in_messages[1][l1]);
                 out_messages[1][l1] = std::min(out_messages[1][l1], facVal + in_messages[0][l0]);
             }
@@ -113,19 +115,19 @@ namespace detail{
     ){
         using value_type = typename VT::value_type;
         if(beta>=0){
-            std::copy(in_messages[1], in_messages[1]+nl, out_messages[1]);
-            std::copy(in_messages[0], in_messages[0]+nl, out_messages[0]);
+            // the message to variable 0 is the distance transform
+            // of the incoming message of variable 1 and vice versa
+            std::copy(in_messages[1], in_messages[1]+nl, out_messages[0]);
+            std::copy(in_messages[0], in_messages[0]+nl, out_messages[1]);
             // "forward pass"
             for(label_type l=1; l<nl; ++l){
                 out_messages[0][l] = std::min(out_messages[0][l], out_messages[0][l-1] + beta);
                 out_messages[1][l] = std::min(out_messages[1][l], out_messages[1][l-1] + beta);
             }
             // backward pass
-            for(label_type l = nl-2; l>=0; --l){
+            for(label_type l = nl-1; l-- > 0;){
                 out_messages[0][l] = std::min(out_messages[0][l], out_messages[0][l+1] + beta);
                 out_messages[1][l] = std::min(out_messages[1][l], out_messages[1][l+1] + beta);
-                if(l == 0)
-                    break;
             }
         }
         else{
@@ -133,6 +135,36 @@ namespace detail{
         }
     }
 
+    template<class VT>
+    inline void truncated_l1_factor_to_variable_messages(
+        const VT * vt,
+        const label_type nl,
+        const typename VT::value_type beta,
+        const typename VT::value_type truncation,
+        const typename VT::value_type ** in_messages,
+        typename VT::value_type ** out_messages
+    ){
+        if(beta>=0){
+            // distance transform of the untruncated l1 function
+            l1_factor_to_variable_messages(vt, nl, beta, in_messages, out_messages);
+
+            // the truncation caps the messages at min(in) + beta * truncation
+            const auto cap_0 = *std::min_element(in_messages[1], in_messages[1] + nl) + beta * truncation;
+            const auto cap_1 = *std::min_element(in_messages[0], in_messages[0] + nl) + beta * truncation;
+            for(label_type l=0; l<nl; ++l){
+                out_messages[0][l] = std::min(out_messages[0][l], cap_0);
+                out_messages[1][l] = std::min(out_messages[1][l], cap_1);
+            }
+        }
+        else{
+            generic_second_order_factor_to_variable_messages(vt, nl, nl, in_messages, out_messages);
+        }
+    }
+
+    template<class L>
+    inline L abs_diff(const L a, const L b){
+        return a > b ? a - b : b - a;
+    }
 
 }
 
@@ -164,6 +196,15 @@ namespace detail{
         virtual void copy_corder(value_type * out)const = 0;
         virtual void add_values(value_type * out)const = 0;
 
+        // evaluate the tensor for a batch of labelings
+        // stored as row-major (num_labelings x arity) matrix
+        // and add the values to out
+        virtual void batch_add_values(
+            const label_type * labels,
+            const std::size_t num_labelings,
+            value_type * out
+        )const = 0;
+
         virtual std::unique_ptr<TensorBase<T>> clone()const = 0;
 
         virtual void factor_to_variable_messages(
@@ -185,6 +226,12 @@ namespace detail{
         // arity.
         // undefined for tensors which are already binary
         virtual std::unique_ptr<TensorBase<T>> binarize()const = 0;
+
+        // name of the tensor type
+        virtual std::string name()const = 0;
+
+        // bytes used by the tensor including its heap storage
+        virtual std::size_t memory_usage()const = 0;
     };
 
 
@@ -297,9 +344,30 @@ namespace detail{
             });
         }
 
+        void batch_add_values(
+            const label_type * labels,
+            const std::size_t num_labelings,
+            value_type * out
+        )const override
+        {
+            const auto & self = this->derived_cast();
+            const auto arity = self.arity();
+            for(std::size_t n=0; n<num_labelings; ++n)
+            {
+                // qualified call st. the virtual dispatch is
+                // resolved once per batch and not once per labeling
+                out[n] += self.DERIVED::operator[](labels + n * arity);
+            }
+        }
+
         std::unique_ptr<TensorBase<T>> clone() const override{
             return std::make_unique<DERIVED>(this->derived_cast());
         }
+
+        // analytic tensors have no heap storage
+        std::size_t memory_usage()const override{
+            return sizeof(DERIVED);
+        }
         std::unique_ptr<TensorBase<T>> bind(
             gsl::span<const std::size_t> positions,
             gsl::span<const label_type> labels
@@ -386,6 +454,10 @@ namespace detail{
         using label_type = typename base_type::label_type;
         using base_type::shape;
 
+        std::string name()const override{
+            return "BinaryMultilinearTensor";
+        }
+
         BinaryMultilinearTensor(const value_type beta)
         :
         m_beta(beta){
@@ -424,6 +496,10 @@ namespace detail{
         using label_type = typename base_type::label_type;
         using base_type::shape;
 
+        std::string name()const override{
+            return "PottsNTensor";
+        }
+
         PottsNTensor(const std::size_t num_labels,const value_type beta)
         :   m_num_labels(num_labels),
             m_beta(beta){
@@ -464,6 +540,10 @@ namespace detail{
         using label_type = typename base_type::label_type;
         using base_type::shape;
 
+        std::string name()const override{
+            return "Potts2Tensor";
+        }
+
         Potts2Tensor(const std::size_t num_labels = 0,const value_type beta = value_type(0))
         :   m_num_labels(num_labels),
             m_beta(beta){
@@ -482,12 +562,28 @@ namespace detail{
         }
 
 
+        void batch_add_values(
+            const label_type * labels,
+            const std::size_t num_labelings,
+            value_type * out
+        )const override{
+            for(std::size_t n=0; n<num_labelings; ++n){
+                out[n] += labels[2*n] == labels[2*n + 1] ? value_type(0) : m_beta;
+            }
+        }
+
         void factor_to_variable_messages(
             const value_type ** in_messages,
             value_type ** out_messages
         )const override{
             detail::potts2_factor_to_variable_messages(m_num_labels, m_beta, in_messages, out_messages);
         }
+        std::size_t num_labels()const{
+            return m_num_labels;
+        }
+        value_type beta()const{
+            return m_beta;
+        }
     private:
         std::size_t m_num_labels;
         value_type m_beta;
@@ -505,6 +601,10 @@ namespace detail{
         using label_type = typename base_type::label_type;
         using base_type::shape;
 
+        std::string name()const override{
+            return "L1Tensor";
+        }
+
         L1Tensor(const std::size_t num_labels = 0,const value_type beta = value_type(0))
         :   m_num_labels(num_labels),
             m_beta(beta){
@@ -513,7 +613,7 @@ namespace detail{
             return 2 * m_num_labels;
         }
         T operator[](const label_type * labels)const override{
-            return m_beta * std::abs(labels[0] - labels[1]);
+            return m_beta * value_type(detail::abs_diff(labels[0], labels[1]));
         }
         std::size_t arity()const override{
             return 2;
@@ -525,7 +625,13 @@ namespace detail{
             const value_type ** in_messages,
             value_type ** out_messages
         )const override{
-            l1_factor_to_variable_messages(this, m_num_labels, m_beta, in_messages, out_messages);
+            detail::l1_factor_to_variable_messages(this, m_num_labels, m_beta, in_messages, out_messages);
+        }
+        std::size_t num_labels()const{
+            return m_num_labels;
+        }
+        value_type beta()const{
+            return m_beta;
         }
     private:
         std::size_t m_num_labels;
@@ -533,6 +639,63 @@ namespace detail{
     };
 
 
+    // f(l0, l1) = beta * min(|l0 - l1|, truncation)
+    template<class T>
+    class TruncatedL1Tensor : public TensorCrtpBase<T, TruncatedL1Tensor<T>>
+    {
+    public:
+        using base_type = TensorCrtpBase<T, TruncatedL1Tensor<T>>;
+        using value_type = typename base_type::value_type;
+        using label_type = typename base_type::label_type;
+        using base_type::shape;
+
+        std::string name()const override{
+            return "TruncatedL1Tensor";
+        }
+
+        TruncatedL1Tensor(
+            const std::size_t num_labels = 0,
+            const value_type beta = value_type(0),
+            const value_type truncation = value_type(1)
+        )
+        :   m_num_labels(num_labels),
+            m_beta(beta),
+            m_truncation(truncation){
+        }
+        std::size_t sum_of_shape()const override{
+            return 2 * m_num_labels;
+        }
+        T operator[](const label_type * labels)const override{
+            return m_beta * std::min(value_type(detail::abs_diff(labels[0], labels[1])), m_truncation);
+        }
+        std::size_t arity()const override{
+            return 2;
+        }
+        std::size_t shape(const std::size_t) const override{
+            return m_num_labels;
+        }
+        void factor_to_variable_messages(
+            const value_type ** in_messages,
+            value_type ** out_messages
+        )const override{
+            detail::truncated_l1_factor_to_variable_messages(this, m_num_labels, m_beta, m_truncation, in_messages, out_messages);
+        }
+        std::size_t num_labels()const{
+            return m_num_labels;
+        }
+        value_type beta()const{
+            return m_beta;
+        }
+        value_type truncation()const{
+            return m_truncation;
+        }
+    private:
+        std::size_t m_num_labels;
+        value_type m_beta;
+        value_type m_truncation;
+    };
+
+
 
 
 
@@ -601,6 +764,10 @@ namespace detail{
         using label_type = typename base_type::label_type;
         using base_type::shape;
 
+        std::string name()const override{
+            return "DeltaUnary";
+        }
+
         DeltaUnary(const std::size_t num_labels=0, const  std::size_t label=0, value_type beta=0)
         :   m_num_labels(num_labels),
             m_label(label),
@@ -643,6 +810,10 @@ namespace detail{
         using label_type = typename base_type::label_type;
         using base_type::shape;
 
+        std::string name()const override{
+            return "OptimizedBinaryUnary";
+        }
+
         OptimizedBinaryUnary(value_type val0 = value_type(0), value_type val1 = value_type(0))
         :   m_val0(val0-val1){
         }
@@ -687,6 +858,13 @@ namespace detail{
 
         using base_type::shape;
 
+        std::string name()const override{
+            return "UnaryTensor";
+        }
+        std::size_t memory_usage()const override{
+            return sizeof(UnaryTensor<T>) + m_values.capacity() * sizeof(T);
+        }
+
         template<class ITER>
         UnaryTensor(ITER values_begin, ITER values_end)
         :   m_values(values_begin, values_end)
@@ -739,15 +917,172 @@ namespace detail{
         {
             std::copy(m_values.begin(), m_values.end(), out);
         }
+
+        void batch_add_values(
+            const label_type * labels,
+            const std::size_t num_labelings,
+            value_type * out
+        )const override{
+            for(std::size_t n=0; n<num_labelings; ++n){
+                out[n] += m_values[labels[n]];
+            }
+        }
     private:
         std::vector<T> m_values;
     };
 
 
+    // non-owning unary tensor viewing
+    // a contiguous row of values
+    template<class T>
+    class UnaryViewTensor : public TensorCrtpBase<T, UnaryViewTensor<T>>
+    {
+    public:
+        using base_type = TensorCrtpBase<T, UnaryViewTensor<T>>;
+        using value_type = typename base_type::value_type;
+        using label_type = typename base_type::label_type;
+
+        using base_type::shape;
+
+        std::string name()const override{
+            return "UnaryViewTensor";
+        }
+
+        UnaryViewTensor(const value_type * values = nullptr, const label_type num_labels = 0)
+        :   m_values(values),
+            m_num_labels(num_labels)
+        {
+        }
+        std::size_t sum_of_shape()const override{
+            return m_num_labels;
+        }
+        T operator[](const label_type * labels)const override{
+            return m_values[labels[0]];
+        }
+        T operator[](label_type index)const{
+            return m_values[index];
+        }
+        auto data() const{
+            return m_values;
+        }
+        std::size_t arity()const override{
+            return 1;
+        }
+        std::size_t shape(const std::size_t) const override{
+            return m_num_labels;
+        }
+
+        void add_values(value_type * out)const override
+        {
+            for(label_type l=0; l<m_num_labels; ++l)
+            {
+                out[l] += m_values[l];
+            }
+        }
+
+        void copy_corder(value_type * out)const override
+        {
+            std::copy(m_values, m_values + m_num_labels, out);
+        }
+
+        // the clone owns a copy of the viewed values
+        std::unique_ptr<TensorBase<T>> clone()const override{
+            return std::make_unique<UnaryTensor<T>>(m_values, m_values + m_num_labels);
+        }
+
+        void batch_add_values(
+            const label_type * labels,
+            const std::size_t num_labelings,
+            value_type * out
+        )const override{
+            for(std::size_t n=0; n<num_labelings; ++n){
+                out[n] += m_values[labels[n]];
+            }
+        }
+    private:
+        const value_type * m_values;
+        label_type m_num_labels;
+    };
+
+
 
 
 
 
+    // non-owning tensor viewing a dense
+    // c-order array of values with the given shape
+    template<class T>
+    class ExplicitViewTensor : public TensorCrtpBase<T, ExplicitViewTensor<T>>
+    {
+    public:
+        using base_type = TensorCrtpBase<T, ExplicitViewTensor<T>>;
+        using value_type = typename base_type::value_type;
+        using label_type = typename base_type::label_type;
+
+        using base_type::shape;
+
+        std::string name()const override{
+            return "ExplicitViewTensor";
+        }
+
+        ExplicitViewTensor(const value_type * values = nullptr, const std::size_t * shape = nullptr, const std::size_t arity = 0)
+        :   m_values(values),
+            m_shape(shape),
+            m_arity(arity)
+        {
+        }
+        std::size_t sum_of_shape()const override{
+            return std::accumulate(m_shape, m_shape + m_arity, std::size_t(0));
+        }
+        T operator[](const label_type * labels)const override{
+            std::size_t index = 0;
+            for(std::size_t d=0; d<m_arity; ++d){
+                index = index * m_shape[d] + labels[d];
+            }
+            return m_values[index];
+        }
+        auto data() const{
+            return m_values;
+        }
+        std::size_t size()const{
+            return std::accumulate(m_shape, m_shape + m_arity, std::size_t(1), std::multiplies<std::size_t>());
+        }
+        std::size_t arity()const override{
+            return m_arity;
+        }
+        std::size_t shape(const std::size_t d) const override{
+            return m_shape[d];
+        }
+
+        void add_values(value_type * out)const override
+        {
+            const auto size = this->size();
+            for(std::size_t i=0; i<size; ++i)
+            {
+                out[i] += m_values[i];
+            }
+        }
+
+        void copy_corder(value_type * out)const override
+        {
+            std::copy(m_values, m_values + this->size(), out);
+        }
+
+        // the clone owns a copy of the viewed values
+        std::unique_ptr<TensorBase<T>> clone()const override{
+            using xshape_type = typename XArrayTensor<T>::xshape_type;
+            auto tensor = std::make_unique<XArrayTensor<T>>(xshape_type(m_shape, m_shape + m_arity));
+            this->copy_corder(&*tensor->xexpression().begin());
+            return tensor;
+        }
+    private:
+        const value_type * m_values;
+        const std::size_t * m_shape;
+        std::size_t m_arity;
+    };
+
+
+
     template<class T, std::size_t NUM_LABELS>
     class StaticNumLabelTensor : public TensorCrtpBase<T, StaticNumLabelTensor<T, NUM_LABELS>>
     {
@@ -759,6 +1094,13 @@ namespace detail{
 
         using base_type::shape;
 
+        std::string name()const override{
+            return "StaticNumLabelTensor";
+        }
+        std::size_t memory_usage()const override{
+            return sizeof(StaticNumLabelTensor<T, NUM_LABELS>) + detail::ipow(NUM_LABELS, m_arity) * sizeof(T);
+        }
+
         StaticNumLabelTensor(const std::size_t arity)
         :   m_arity(arity),
             m_values(nullptr)
@@ -828,6 +1170,13 @@ namespace detail{
 
         using base_type::shape;
 
+        std::string name()const override{
+            return "XArrayTensor";
+        }
+        std::size_t memory_usage()const override{
+            return sizeof(XArrayTensor<T>) + m_xarray.size() * sizeof(T);
+        }
+
 
         XArrayTensor()
         : m_xarray(){
@@ -856,7 +1205,7 @@ namespace detail{
         }
         void add_values(value_type * out)const override{
             std::for_each(m_xarray.begin(), m_xarray.end(),[&](auto val){
-                *out = val;
+                *out += val;
                 ++out;
             });
         }
@@ -887,6 +1236,13 @@ namespace detail{
 
         using base_type::shape;
 
+        std::string name()const override{
+            return "XTensorTensor";
+        }
+        std::size_t memory_usage()const override{
+            return sizeof(XTensorTensor<T, ARITY>) + m_xtensor.size() * sizeof(T);
+        }
+
 
         XTensorTensor()
         : m_xtensor(){
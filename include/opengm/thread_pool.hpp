@@ -0,0 +1,188 @@
+#pragma once
+
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace opengm{
+
+
+    // number of threads to use when the user asked for 0 threads
+    inline std::size_t default_num_threads(){
+        return std::max(std::size_t(1), std::size_t(std::thread::hardware_concurrency()));
+    }
+
+
+    // A fixed size pool of worker threads.
+    // Tasks are started in the order in which they are enqueued.
+    // wait() blocks until all enqueued tasks are finished and
+    // rethrows the first exception thrown by any task.
+    class ThreadPool{
+    public:
+        explicit ThreadPool(const std::size_t num_threads = 0)
+        :   m_threads(),
+            m_tasks(),
+            m_mutex(),
+            m_task_available(),
+            m_all_done(),
+            m_num_unfinished(0),
+            m_stop(false),
+            m_exception()
+        {
+            const auto n = num_threads == 0 ? default_num_threads() : num_threads;
+            m_threads.reserve(n);
+            for(std::size_t i=0; i<n; ++i){
+                m_threads.emplace_back([this](){
+                    this->work();
+                });
+            }
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool & operator=(const ThreadPool &) = delete;
+
+        ~ThreadPool(){
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_task_available.notify_all();
+            for(auto & thread : m_threads){
+                thread.join();
+            }
+        }
+
+        std::size_t num_threads()const{
+            return m_threads.size();
+        }
+
+        template<class F>
+        void enqueue(F && f){
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_tasks.emplace(std::forward<F>(f));
+                ++m_num_unfinished;
+            }
+            m_task_available.notify_one();
+        }
+
+        void wait(){
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_all_done.wait(lock, [this](){
+                return m_num_unfinished == 0;
+            });
+            if(m_exception){
+                auto exception = m_exception;
+                m_exception = nullptr;
+                std::rethrow_exception(exception);
+            }
+        }
+
+    private:
+
+        void work(){
+            while(true){
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_task_available.wait(lock, [this](){
+                        return m_stop || !m_tasks.empty();
+                    });
+                    if(m_tasks.empty()){
+                        return;
+                    }
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop();
+                }
+                std::exception_ptr exception;
+                try{
+                    task();
+                }
+                catch(...){
+                    exception = std::current_exception();
+                }
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    if(exception && !m_exception){
+                        m_exception = exception;
+                    }
+                    if(--m_num_unfinished == 0){
+                        m_all_done.notify_all();
+                    }
+                }
+            }
+        }
+
+        std::vector<std::thread> m_threads;
+        std::queue<std::function<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_task_available;
+        std::condition_variable m_all_done;
+        // queued and running tasks
+        std::size_t m_num_unfinished;
+        bool m_stop;
+        std::exception_ptr m_exception;
+    };
+
+
+    // calls f(begin, end) for disjoint blocks of [0, size) on up to
+    // num_threads threads (0 means one thread per core) and waits for
+    // all blocks. Blocks have at least min_block_size elements,
+    // ranges which are too small run on the calling thread.
+    template<class F>
+    void parallel_for(const std::size_t size, const std::size_t num_threads, const std::size_t min_block_size, F && f){
+        const auto max_num_threads = num_threads == 0 ? default_num_threads() : num_threads;
+        const auto n = std::min(max_num_threads, size / std::max(std::size_t(1), min_block_size));
+        if(n <= 1){
+            if(size > 0){
+                f(std::size_t(0), size);
+            }
+            return;
+        }
+        // a few blocks per thread for load balancing
+        const auto num_blocks = std::min(size, 4 * n);
+        const auto block_size = (size + num_blocks - 1) / num_blocks;
+        ThreadPool pool(n);
+        for(std::size_t begin=0; begin<size; begin+=block_size){
+            const auto end = std::min(size, begin + block_size);
+            pool.enqueue([&f, begin, end](){
+                f(begin, end);
+            });
+        }
+        pool.wait();
+    }
+
+    // static schedule on an existing pool for loops which run many
+    // times, e.g. once per iteration of a solver: [0, size) is split into
+    // at most pool.num_threads() contiguous blocks of at least
+    // min_block_size elements and f(block, begin, end) is called for
+    // each of them. The blocks are the same for equal arguments, the
+    // block index can select per thread buffers. Returns the number of blocks.
+    template<class F>
+    std::size_t parallel_for_static(ThreadPool & pool, const std::size_t size, const std::size_t min_block_size, F && f){
+        const auto n = std::min(pool.num_threads(), size / std::max(std::size_t(1), min_block_size));
+        if(n <= 1){
+            if(size > 0){
+                f(std::size_t(0), std::size_t(0), size);
+            }
+            return size > 0 ? 1 : 0;
+        }
+        const auto block_size = (size + n - 1) / n;
+        std::size_t num_blocks = 0;
+        for(std::size_t begin=0; begin<size; begin+=block_size, ++num_blocks){
+            const auto end = std::min(size, begin + block_size);
+            pool.enqueue([&f, num_blocks, begin, end](){
+                f(num_blocks, begin, end);
+            });
+        }
+        pool.wait();
+        return num_blocks;
+    }
+
+}
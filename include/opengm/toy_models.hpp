@@ -1,14 +1,19 @@
 #pragma once
 
-#include <random>
+#include <array>
+#include <limits>
+#include <numeric>
+#include <cmath>
+#include <cstdint>
 #include <algorithm>
 #include <string>
 
-#include <xtensor/xrandom.hpp>
+#include <xtensor/xarray.hpp>
 
 #include "opengm/graphical_model.hpp"
 #include "opengm/tensors.hpp"
 #include "opengm/space.hpp"
+#include "opengm/thread_pool.hpp"
 
 
 #include <iostream>
@@ -18,6 +23,88 @@ namespace opengm{
 
 namespace detail{
 
+    // generators run on a single thread below this number of variables
+    constexpr std::size_t toy_model_min_block_size = 1 << 14;
+
+    // the pairwise weights of random potts grids take this many
+    // values st. all pairwise factors share a few Potts2Tensors
+    constexpr std::size_t random_potts_weight_levels = 256;
+
+}
+
+    // Counter based random number generator: the i-th number of
+    // stream s only depends on (seed, s, i). Generators which give each
+    // variable and each factor its own stream produce bit identical
+    // models independent of the order of generation and the number of threads.
+    class CounterRng{
+    public:
+        using result_type = std::uint64_t;
+
+        CounterRng(const std::uint64_t seed, const std::uint64_t stream)
+        :   m_key(mix(mix(seed) + stream)),
+            m_counter(0){
+        }
+
+        static constexpr result_type min(){
+            return 0;
+        }
+        static constexpr result_type max(){
+            return std::numeric_limits<result_type>::max();
+        }
+
+        result_type operator()(){
+            ++m_counter;
+            return mix(m_key + m_counter * 0x9E3779B97F4A7C15ull);
+        }
+
+        // uniform in [low, high)
+        template<class T>
+        T uniform(const T low, const T high){
+            // the top bits are exactly representable in T
+            constexpr int digits = std::min(std::numeric_limits<T>::digits, 53);
+            const auto bits = (*this)() >> (64 - digits);
+            return low + (high - low) * (T(bits) / T(std::uint64_t(1) << digits));
+        }
+
+        // uniform in [low, high]
+        std::size_t uniform_int(const std::size_t low, const std::size_t high){
+            return low + std::size_t((*this)() % (high - low + 1));
+        }
+
+    private:
+        // splitmix64 finalizer
+        static constexpr std::uint64_t mix(std::uint64_t z){
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        std::uint64_t m_key;
+        std::uint64_t m_counter;
+    };
+
+namespace detail{
+
+    // add the dense unary block to gm and fill the
+    // row of each variable with f(vi, row) in parallel
+    template<class GM, class F>
+    void generate_dense_unaries(GM & gm, const std::size_t num_threads, F && f){
+        gm.add_dense_unaries();
+        const auto stride = gm.dense_unaries().stride;
+        auto data = gm.dense_unaries_block().data();
+        parallel_for(gm.num_variables(), num_threads, toy_model_min_block_size, [&](auto begin, auto end){
+            for(auto vi=begin; vi<end; ++vi){
+                f(vi, data + vi * stride);
+            }
+        });
+    }
+
+    // Random potts grids are generated row block wise in parallel.
+    // Each variable has its own random stream for its unary
+    // and the weights of its edges to the right and below.
+    // The unaries are stored in the dense unary block of the model,
+    // the weights are quantized to random_potts_weight_levels values
+    // in (0, 0.1) and each used weight gets one shared Potts2Tensor.
     class RandomPottsGridImpl{
 
     public:
@@ -26,14 +113,16 @@ namespace detail{
             std::size_t ny,
             std::size_t n_labels,
             bool make_tree,
-            std::size_t seed = 42
+            std::size_t seed = 42,
+            std::size_t num_threads = 0
         )
         :
         m_nx(nx),
         m_ny(ny),
         m_n_labels(n_labels),
         m_make_tree(make_tree),
-        m_seed(seed){
+        m_seed(seed),
+        m_num_threads(num_threads){
 
         }
 
@@ -45,50 +134,86 @@ namespace detail{
 
 
             using value_type = float;
-            using value_ilist = std::initializer_list<value_type>;
             using label_type = std::size_t;
             using space_type = opengm::UniformSpace<label_type>;
             using GmType = opengm::GraphicalModel<space_type, value_type>;
 
-            auto n_variables = m_nx*m_ny;
+            const auto model_seed = m_seed;
+            ++m_seed;
+
+            const std::size_t n_variables = m_nx*m_ny;
             auto get_vi = [&](auto x,auto y){
                 return x*m_ny + y;
             };
+            auto has_x_edge = [&](auto x, auto y){
+                return x+1 < m_nx && (!m_make_tree || y == 0);
+            };
             GmType gm(n_variables, m_n_labels);
-
-            std::uniform_real_distribution<value_type> distribution(0.0f, 1.0f);
-            std::default_random_engine generator(m_seed);
-            ++m_seed;
-
-            std::vector<value_type> data(m_n_labels);
-
-            for(auto vi=0; vi<n_variables; ++vi){
-                std::generate(data.begin(), data.end(), [&]() { return distribution(generator);});
-                auto tensor = std::make_unique<opengm::UnaryTensor<value_type>>(data.begin(), data.end());
-                gm.add_unary_factor(std::move(tensor), vi);
+            gm.add_dense_unaries();
+            if(n_variables == 0){
+                return gm;
             }
-            for(auto x=0; x<m_nx; ++x)
-            {
-                for(auto y=0; y<m_ny; ++y)
+            auto unaries = gm.dense_unaries_block().data();
+            const auto stride = gm.dense_unaries().stride;
+
+            // index of the first pairwise factor of each row
+            std::vector<std::size_t> row_offset(m_nx + 1, 0);
+            for(std::size_t x=0; x<m_nx; ++x){
+                const std::size_t n_x_edges = x+1 < m_nx ? (m_make_tree ? 1 : m_ny) : 0;
+                row_offset[x+1] = row_offset[x] + n_x_edges + m_ny - 1;
+            }
+            const auto n_pairwise = row_offset[m_nx];
+            const auto n_levels = detail::random_potts_weight_levels;
+            std::vector<std::uint8_t> levels(n_pairwise);
+            std::vector<std::array<std::size_t, 2>> edges(n_pairwise);
+            static_assert(detail::random_potts_weight_levels <= 256, "levels are stored as uint8");
+
+            const auto min_rows = std::max(std::size_t(1), detail::toy_model_min_block_size / m_ny);
+            parallel_for(m_nx, m_num_threads, min_rows, [&](auto x_begin, auto x_end){
+                for(auto x=x_begin; x<x_end; ++x)
                 {
-                    auto vi = get_vi(x, y);
-                    if( x+1 < m_nx)
+                    auto fi = row_offset[x];
+                    for(std::size_t y=0; y<m_ny; ++y)
                     {
-                        if(!m_make_tree || y == 0){
-                            auto tensor = std::make_unique<opengm::Potts2Tensor<value_type>>(m_n_labels, 0.1 * distribution(generator));
-                            gm.add_factor(std::move(tensor), {vi,  get_vi(x+1, y)});
+                        const auto vi = get_vi(x, y);
+                        CounterRng rng(model_seed, vi);
+                        auto unary = unaries + vi * stride;
+                        for(std::size_t l=0; l<m_n_labels; ++l){
+                            unary[l] = rng.uniform(0.0f, 1.0f);
+                        }
+                        if(has_x_edge(x, y))
+                        {
+                            levels[fi] = std::uint8_t(rng.uniform_int(0, n_levels - 1));
+                            edges[fi] = {vi, get_vi(x+1, y)};
+                            ++fi;
+                        }
+                        if(y+1 < m_ny)
+                        {
+                            levels[fi] = std::uint8_t(rng.uniform_int(0, n_levels - 1));
+                            edges[fi] = {vi, get_vi(x, y+1)};
+                            ++fi;
                         }
-
                     }
-                    if(y+1 < m_ny)
-                    {
-                        auto tensor = std::make_unique<opengm::Potts2Tensor<value_type>>(m_n_labels, 0.1 * distribution(generator));
-                        gm.add_factor(std::move(tensor), {vi,  get_vi(x, y+1)});
+                }
+            });
 
-                    }
+            // tensors of the used weights in increasing order
+            std::vector<bool> used(n_levels, false);
+            for(auto level : levels){
+                used[level] = true;
+            }
+            const auto n_used = std::size_t(std::count(used.begin(), used.end(), true));
+            gm.reserve(gm.num_factors() + n_pairwise, gm.num_index_entries() + 2 * n_pairwise, gm.num_tensors() + n_used);
+            std::vector<std::size_t> level_tids(n_levels, 0);
+            for(std::size_t level=0; level<n_levels; ++level){
+                if(used[level]){
+                    const auto beta = 0.1f * (value_type(level) + 0.5f) / value_type(n_levels);
+                    level_tids[level] = gm.add_tensor(std::make_unique<opengm::Potts2Tensor<value_type>>(m_n_labels, beta));
                 }
             }
-            //std::cout<<"seed "<<m_seed<<"\n";
+            for(std::size_t fi=0; fi<n_pairwise; ++fi){
+                gm.add_factor(level_tids[levels[fi]], edges[fi].begin(), edges[fi].end());
+            }
             return gm;
         }
 
@@ -101,6 +226,7 @@ namespace detail{
         std::size_t m_n_labels;
         bool m_make_tree;
         std::size_t m_seed;
+        std::size_t m_num_threads;
     };
 
 
@@ -112,8 +238,9 @@ namespace detail{
             std::size_t nx,
             std::size_t ny,
             std::size_t n_labels,
-            std::size_t seed = 42
-        ): detail::RandomPottsGridImpl(nx,ny,n_labels,false, seed){
+            std::size_t seed = 42,
+            std::size_t num_threads = 0
+        ): detail::RandomPottsGridImpl(nx,ny,n_labels,false, seed, num_threads){
 
         }
         std::string name()const{return "RandomPottsGrid";}
@@ -123,8 +250,9 @@ namespace detail{
         RandomPottsChain(
             std::size_t n_variables,
             std::size_t n_labels,
-            std::size_t seed = 42
-        ): detail::RandomPottsGridImpl(n_variables,1,n_labels,false, seed){
+            std::size_t seed = 42,
+            std::size_t num_threads = 0
+        ): detail::RandomPottsGridImpl(n_variables,1,n_labels,false, seed, num_threads){
 
         }
         std::string name()const{return "RandomPottsChain";}
@@ -135,14 +263,21 @@ namespace detail{
             std::size_t nx,
             std::size_t ny,
             std::size_t n_labels,
-            std::size_t seed = 42
-        ): detail::RandomPottsGridImpl(nx,ny,n_labels,true, seed){
+            std::size_t seed = 42,
+            std::size_t num_threads = 0
+        ): detail::RandomPottsGridImpl(nx,ny,n_labels,true, seed, num_threads){
 
         }
         std::string name()const{return "RandomPottsGridFan";}
     };
 
 
+    // Random higher order model. The number of labels of variable vi
+    // is drawn from stream 2*vi, the arity, variables and values of
+    // factor fi from stream 2*fi+1, the factors are generated in parallel.
+    // The values are random per factor and cannot be shared, instead
+    // all values are stored in one block owned by the model and each
+    // factor gets a lightweight ExplicitViewTensor.
     template<class T = float>
     class RandomModel{
 
@@ -153,6 +288,7 @@ namespace detail{
         using label_type = std::size_t;
         using space_type = opengm::ExplicitSpace<label_type>;
         using GmType = opengm::GraphicalModel<space_type, value_type>;
+        using unique_tensor_ptr = typename GmType::unique_tensor_ptr;
 
 
         RandomModel(
@@ -162,15 +298,17 @@ namespace detail{
             std::size_t max_num_labels,
             std::size_t min_arity,
             std::size_t max_arity,
-            std::size_t seed = 42
+            std::size_t seed = 42,
+            std::size_t num_threads = 0
         )
         :   m_n_var(n_var),
             m_n_factors(n_factors),
             m_min_num_labels(min_num_labels),
             m_max_num_labels(max_num_labels),
             m_min_arity(min_arity),
-            m_max_arity(max_arity),
-            m_seed(seed)
+            m_max_arity(std::min(max_arity, n_var)),
+            m_seed(seed),
+            m_num_threads(num_threads)
         {
 
         }
@@ -180,61 +318,485 @@ namespace detail{
         }
         auto operator()(){
 
-            std::uniform_int_distribution<std::size_t> arity_distribution(m_min_arity, m_max_arity);
-            std::uniform_int_distribution<std::size_t> num_labels_distribution(m_min_num_labels, m_max_num_labels);
-            std::uniform_real_distribution<value_type> value_distribution(0.0f, 1.0f);
-            std::default_random_engine generator(m_seed);
+            const auto model_seed = m_seed;
             ++m_seed;
 
-
             // space
             std::vector<label_type> spacevec(m_n_var);
-            std::generate(spacevec.begin(), spacevec.end(), [&]() { return num_labels_distribution(generator);});
+            parallel_for(m_n_var, m_num_threads, detail::toy_model_min_block_size, [&](auto begin, auto end){
+                for(auto vi=begin; vi<end; ++vi){
+                    CounterRng rng(model_seed, 2*vi);
+                    spacevec[vi] = rng.uniform_int(m_min_num_labels, m_max_num_labels);
+                }
+            });
 
             // gm
             GmType gm(spacevec.begin(), spacevec.end());
 
-            // all indices
-            std::vector<std::size_t> vis(m_n_var);
-            std::iota(vis.begin(), vis.end(), 0);
+            // random arity and distinct variables of each factor,
+            // its values follow in the same stream
+            std::vector<CounterRng> rngs(m_n_factors, CounterRng(0, 0));
+            std::vector<std::size_t> arities(m_n_factors);
+            std::vector<std::size_t> sizes(m_n_factors);
+            std::vector<std::size_t> factor_vis(m_n_factors * m_max_arity);
+            parallel_for(m_n_factors, m_num_threads, detail::toy_model_min_block_size, [&](auto begin, auto end){
+                for(auto fi=begin; fi<end; ++fi)
+                {
+                    CounterRng rng(model_seed, 2*fi + 1);
+                    const auto arity = rng.uniform_int(m_min_arity, m_max_arity);
+                    auto vis = factor_vis.begin() + fi * m_max_arity;
+                    std::size_t size = 1;
+                    for(std::size_t d=0; d<arity; ++d)
+                    {
+                        // rejection sampling, the arity is small
+                        do{
+                            vis[d] = rng.uniform_int(0, m_n_var - 1);
+                        } while(std::find(vis, vis + d, vis[d]) != vis + d);
+                        size *= gm.num_labels(vis[d]);
+                    }
+                    arities[fi] = arity;
+                    sizes[fi] = size;
+                    rngs[fi] = rng;
+                }
+            });
+
+            // the shapes and values of all factors are pooled in two
+            // blocks owned by the model, the tensors only view them
+            std::vector<std::size_t> shape_offsets(m_n_factors + 1, 0);
+            std::vector<std::size_t> value_offsets(m_n_factors + 1, 0);
+            std::partial_sum(arities.begin(), arities.end(), shape_offsets.begin() + 1);
+            std::partial_sum(sizes.begin(), sizes.end(), value_offsets.begin() + 1);
+            std::vector<std::size_t> shapes(shape_offsets.back());
+            std::vector<value_type> values(value_offsets.back());
+            parallel_for(m_n_factors, m_num_threads, detail::toy_model_min_block_size, [&](auto begin, auto end){
+                for(auto fi=begin; fi<end; ++fi)
+                {
+                    auto vis = factor_vis.begin() + fi * m_max_arity;
+                    for(std::size_t d=0; d<arities[fi]; ++d){
+                        shapes[shape_offsets[fi] + d] = gm.num_labels(vis[d]);
+                    }
+                    auto & rng = rngs[fi];
+                    for(auto i=value_offsets[fi]; i<value_offsets[fi + 1]; ++i){
+                        values[i] = rng.uniform(value_type(-1), value_type(1));
+                    }
+                }
+            });
+            const auto shapes_data = gm.add_storage(std::move(shapes));
+            const auto values_data = gm.add_storage(std::move(values));
 
             // add factors
-            for(auto i=0; i<m_n_factors; ++i)
+            gm.reserve(m_n_factors, shape_offsets.back(), m_n_factors);
+            for(std::size_t fi=0; fi<m_n_factors; ++fi)
             {
-                // random arity of this factor
-                const auto arity = arity_distribution(generator);
+                auto vis = factor_vis.begin() + fi * m_max_arity;
+                gm.add_factor(std::make_unique<ExplicitViewTensor<value_type>>(
+                    values_data + value_offsets[fi], shapes_data + shape_offsets[fi], arities[fi]), vis, vis + arities[fi]);
+            }
 
-                // build random indices
-                std::shuffle(vis.begin(), vis.end(), generator);
+            return gm;
+        }
 
-                // tensor shape
-                std::vector<label_type> factor_shape(arity);
-                for(auto d=0; d<arity; ++d)
-                {
-                    factor_shape[d] = gm.num_labels(vis[d]);
+        std::size_t m_n_var;
+        std::size_t m_n_factors;
+        std::size_t m_min_num_labels;
+        std::size_t m_max_num_labels;
+        std::size_t m_min_arity;
+        std::size_t m_max_arity;
+        std::size_t m_seed;
+        std::size_t m_num_threads;
+    };
+
+
+
+    // Benchmark models which resemble real workloads.
+    // All of them are seeded, parameterized by their size and
+    // generated with counter based random streams, st. they are
+    // bit identical for any number of threads.
+    // The ground truth of stereo, segmentation and denoising models
+    // is piecewise constant in blocks of block_size variables,
+    // block b draws from stream num_variables + b.
+
+
+    // Stereo like grid with many labels: the unaries are the noisy,
+    // truncated absolute difference to a piecewise constant disparity
+    // map and the smoothness is truncated L1, weaker across
+    // disparity discontinuities. All pairwise factors share two tensors.
+    class StereoGrid{
+    public:
+        using value_type = float;
+        using label_type = std::size_t;
+        using space_type = opengm::UniformSpace<label_type>;
+        using GmType = opengm::GraphicalModel<space_type, value_type>;
+
+        StereoGrid(
+            std::size_t nx,
+            std::size_t ny,
+            std::size_t n_labels = 64,
+            value_type truncation = 4,
+            std::size_t seed = 42,
+            std::size_t num_threads = 0
+        )
+        :   m_nx(nx),
+            m_ny(ny),
+            m_n_labels(n_labels),
+            m_truncation(truncation),
+            m_seed(seed),
+            m_num_threads(num_threads)
+        {
+        }
+
+        auto seed(){
+            return m_seed;
+        }
+        auto operator()(){
+            constexpr std::size_t block_size = 16;
+            const auto model_seed = m_seed;
+            ++m_seed;
+
+            const auto n_variables = m_nx * m_ny;
+            const auto n_blocks_y = (m_ny + block_size - 1) / block_size;
+            auto disparity = [&](auto x, auto y){
+                CounterRng rng(model_seed, n_variables + (x / block_size) * n_blocks_y + y / block_size);
+                return rng.uniform_int(0, m_n_labels - 1);
+            };
+
+            GmType gm(n_variables, m_n_labels);
+            detail::generate_dense_unaries(gm, m_num_threads, [&](auto vi, auto unary){
+                const auto d = disparity(vi / m_ny, vi % m_ny);
+                CounterRng rng(model_seed, vi);
+                for(std::size_t l=0; l<m_n_labels; ++l){
+                    const auto cost = value_type(detail::abs_diff(l, d)) + rng.uniform(value_type(-2), value_type(2));
+                    unary[l] = std::min(std::max(cost, value_type(0)), value_type(8));
                 }
+            });
+
+            const auto smooth = gm.add_tensor(std::make_unique<TruncatedL1Tensor<value_type>>(m_n_labels, value_type(1), m_truncation));
+            const auto edge = gm.add_tensor(std::make_unique<TruncatedL1Tensor<value_type>>(m_n_labels, value_type(0.25), m_truncation));
+            gm.reserve(gm.num_factors() + 2 * n_variables, gm.num_index_entries() + 4 * n_variables, gm.num_tensors());
+            for(std::size_t x=0; x<m_nx; ++x){
+                for(std::size_t y=0; y<m_ny; ++y){
+                    const auto vi = x * m_ny + y;
+                    if(x+1 < m_nx){
+                        gm.add_factor(disparity(x, y) == disparity(x+1, y) ? smooth : edge, {vi, vi + m_ny});
+                    }
+                    if(y+1 < m_ny){
+                        gm.add_factor(disparity(x, y) == disparity(x, y+1) ? smooth : edge, {vi, vi + 1});
+                    }
+                }
+            }
+            return gm;
+        }
 
-                // tensor with random values
-                auto tensor =  std::make_unique<XArrayTensor<value_type>>(
-                    xt::random::rand(factor_shape, -1.0, 1.0)
-                );
+        std::string name()const{return "StereoGrid";}
+    private:
+        std::size_t m_nx;
+        std::size_t m_ny;
+        std::size_t m_n_labels;
+        value_type m_truncation;
+        std::size_t m_seed;
+        std::size_t m_num_threads;
+    };
+
+
+    // 3D 6-connected segmentation like volume: the unaries prefer
+    // a piecewise constant ground truth labeling with noise and
+    // all pairwise factors share one potts tensor.
+    class PottsVolume{
+    public:
+        using value_type = float;
+        using label_type = std::size_t;
+        using space_type = opengm::UniformSpace<label_type>;
+        using GmType = opengm::GraphicalModel<space_type, value_type>;
+
+        PottsVolume(
+            std::size_t nx,
+            std::size_t ny,
+            std::size_t nz,
+            std::size_t n_labels = 4,
+            value_type beta = 0.5,
+            std::size_t seed = 42,
+            std::size_t num_threads = 0
+        )
+        :   m_nx(nx),
+            m_ny(ny),
+            m_nz(nz),
+            m_n_labels(n_labels),
+            m_beta(beta),
+            m_seed(seed),
+            m_num_threads(num_threads)
+        {
+        }
 
-                gm.add_factor(std::move(tensor), vis.begin(), vis.begin() + arity);
+        auto seed(){
+            return m_seed;
+        }
+        auto operator()(){
+            constexpr std::size_t block_size = 8;
+            const auto model_seed = m_seed;
+            ++m_seed;
+
+            const auto n_variables = m_nx * m_ny * m_nz;
+            const auto n_blocks_y = (m_ny + block_size - 1) / block_size;
+            const auto n_blocks_z = (m_nz + block_size - 1) / block_size;
+            auto get_vi = [&](auto x, auto y, auto z){
+                return (x * m_ny + y) * m_nz + z;
+            };
+
+            GmType gm(n_variables, m_n_labels);
+            detail::generate_dense_unaries(gm, m_num_threads, [&](auto vi, auto unary){
+                const auto z = vi % m_nz;
+                const auto y = (vi / m_nz) % m_ny;
+                const auto x = vi / (m_nz * m_ny);
+                const auto block = ((x / block_size) * n_blocks_y + y / block_size) * n_blocks_z + z / block_size;
+                const auto truth = CounterRng(model_seed, n_variables + block).uniform_int(0, m_n_labels - 1);
+                CounterRng rng(model_seed, vi);
+                for(std::size_t l=0; l<m_n_labels; ++l){
+                    unary[l] = (l == truth ? value_type(0) : value_type(1)) + rng.uniform(value_type(0), value_type(1.5));
+                }
+            });
+
+            const auto potts = gm.add_tensor(std::make_unique<Potts2Tensor<value_type>>(m_n_labels, m_beta));
+            gm.reserve(gm.num_factors() + 3 * n_variables, gm.num_index_entries() + 6 * n_variables, gm.num_tensors());
+            for(std::size_t x=0; x<m_nx; ++x){
+                for(std::size_t y=0; y<m_ny; ++y){
+                    for(std::size_t z=0; z<m_nz; ++z){
+                        const auto vi = get_vi(x, y, z);
+                        if(x+1 < m_nx){
+                            gm.add_factor(potts, {vi, get_vi(x+1, y, z)});
+                        }
+                        if(y+1 < m_ny){
+                            gm.add_factor(potts, {vi, get_vi(x, y+1, z)});
+                        }
+                        if(z+1 < m_nz){
+                            gm.add_factor(potts, {vi, get_vi(x, y, z+1)});
+                        }
+                    }
+                }
             }
+            return gm;
+        }
+
+        std::string name()const{return "PottsVolume";}
+    private:
+        std::size_t m_nx;
+        std::size_t m_ny;
+        std::size_t m_nz;
+        std::size_t m_n_labels;
+        value_type m_beta;
+        std::size_t m_seed;
+        std::size_t m_num_threads;
+    };
+
+
+    // Sparse higher order model: random unaries and a pattern
+    // potential on each 2x2 patch of a grid. A few random label
+    // patterns of a patch cost nothing, all other labelings cost beta.
+    // Patch p draws its patterns from stream num_variables + p.
+    class PatternGrid{
+    public:
+        using value_type = float;
+        using label_type = std::size_t;
+        using space_type = opengm::UniformSpace<label_type>;
+        using GmType = opengm::GraphicalModel<space_type, value_type>;
+        using unique_tensor_ptr = typename GmType::unique_tensor_ptr;
 
+        PatternGrid(
+            std::size_t nx,
+            std::size_t ny,
+            std::size_t n_labels = 3,
+            std::size_t n_patterns = 4,
+            value_type beta = 1,
+            std::size_t seed = 42,
+            std::size_t num_threads = 0
+        )
+        :   m_nx(nx),
+            m_ny(ny),
+            m_n_labels(n_labels),
+            m_n_patterns(n_patterns),
+            m_beta(beta),
+            m_seed(seed),
+            m_num_threads(num_threads)
+        {
+        }
 
+        auto seed(){
+            return m_seed;
+        }
+        auto operator()(){
+            const auto model_seed = m_seed;
+            ++m_seed;
 
+            const auto n_variables = m_nx * m_ny;
+            GmType gm(n_variables, m_n_labels);
+            detail::generate_dense_unaries(gm, m_num_threads, [&](auto vi, auto unary){
+                CounterRng rng(model_seed, vi);
+                for(std::size_t l=0; l<m_n_labels; ++l){
+                    unary[l] = rng.uniform(value_type(0), value_type(1));
+                }
+            });
+            if(m_nx < 2 || m_ny < 2){
+                return gm;
+            }
+
+            // patch p has the upper left corner (p / (ny-1), p % (ny-1))
+            const auto n_patches = (m_nx - 1) * (m_ny - 1);
+            std::vector<unique_tensor_ptr> tensors(n_patches);
+            parallel_for(n_patches, m_num_threads, detail::toy_model_min_block_size, [&](auto begin, auto end){
+                const std::array<std::size_t, 4> shape{m_n_labels, m_n_labels, m_n_labels, m_n_labels};
+                for(auto p=begin; p<end; ++p){
+                    CounterRng rng(model_seed, n_variables + p);
+                    auto values = xt::xarray<value_type>::from_shape(shape);
+                    std::fill(values.begin(), values.end(), m_beta);
+                    for(std::size_t i=0; i<m_n_patterns; ++i){
+                        std::array<std::size_t, 4> pattern;
+                        for(auto & l : pattern){
+                            l = rng.uniform_int(0, m_n_labels - 1);
+                        }
+                        values[pattern] = value_type(0);
+                    }
+                    tensors[p] = std::make_unique<XArrayTensor<value_type>>(std::move(values));
+                }
+            });
+
+            gm.reserve(gm.num_factors() + n_patches, gm.num_index_entries() + 4 * n_patches, gm.num_tensors() + n_patches);
+            for(std::size_t p=0; p<n_patches; ++p){
+                const auto vi = (p / (m_ny - 1)) * m_ny + p % (m_ny - 1);
+                const std::array<std::size_t, 4> vis{vi, vi + 1, vi + m_ny, vi + m_ny + 1};
+                gm.add_factor(std::move(tensors[p]), vis.begin(), vis.end());
+            }
             return gm;
         }
 
-        std::size_t m_n_var;
-        std::size_t m_n_factors;
-        std::size_t m_min_num_labels;
-        std::size_t m_max_num_labels;
-        std::size_t m_min_arity;
-        std::size_t m_max_arity;
+        std::string name()const{return "PatternGrid";}
+    private:
+        std::size_t m_nx;
+        std::size_t m_ny;
+        std::size_t m_n_labels;
+        std::size_t m_n_patterns;
+        value_type m_beta;
         std::size_t m_seed;
+        std::size_t m_num_threads;
     };
 
 
-}
\ No newline at end of file
+    // Small fully connected model with random unaries and
+    // a random pairwise tensor for each pair of variables.
+    // Pair (i, j) draws from stream num_variables + i * num_variables + j.
+    class DenseRandomModel{
+    public:
+        using value_type = float;
+        using label_type = std::size_t;
+        using space_type = opengm::UniformSpace<label_type>;
+        using GmType = opengm::GraphicalModel<space_type, value_type>;
+
+        DenseRandomModel(
+            std::size_t n_variables,
+            std::size_t n_labels,
+            std::size_t seed = 42
+        )
+        :   m_n_variables(n_variables),
+            m_n_labels(n_labels),
+            m_seed(seed)
+        {
+        }
+
+        auto seed(){
+            return m_seed;
+        }
+        auto operator()(){
+            const auto model_seed = m_seed;
+            ++m_seed;
+
+            GmType gm(m_n_variables, m_n_labels);
+            detail::generate_dense_unaries(gm, 1, [&](auto vi, auto unary){
+                CounterRng rng(model_seed, vi);
+                for(std::size_t l=0; l<m_n_labels; ++l){
+                    unary[l] = rng.uniform(value_type(0), value_type(1));
+                }
+            });
+
+            const std::size_t n_pairs = m_n_variables > 1 ? m_n_variables * (m_n_variables - 1) / 2 : 0;
+            gm.reserve(gm.num_factors() + n_pairs, gm.num_index_entries() + 2 * n_pairs, gm.num_tensors() + n_pairs);
+            const std::array<std::size_t, 2> shape{m_n_labels, m_n_labels};
+            for(std::size_t i=0; i<m_n_variables; ++i){
+                for(std::size_t j=i+1; j<m_n_variables; ++j){
+                    CounterRng rng(model_seed, m_n_variables + i * m_n_variables + j);
+                    auto values = xt::xarray<value_type>::from_shape(shape);
+                    for(auto & value : values){
+                        value = rng.uniform(value_type(-1), value_type(1));
+                    }
+                    gm.add_factor(std::make_unique<XArrayTensor<value_type>>(std::move(values)), {i, j});
+                }
+            }
+            return gm;
+        }
+
+        std::string name()const{return "DenseRandomModel";}
+    private:
+        std::size_t m_n_variables;
+        std::size_t m_n_labels;
+        std::size_t m_seed;
+    };
+
+
+    // Denoising of a long 1D signal: the unaries are the truncated
+    // absolute difference to a noisy piecewise constant signal and
+    // the smoothness is truncated L1, all pairwise factors share one tensor.
+    class DenoisingChain{
+    public:
+        using value_type = float;
+        using label_type = std::size_t;
+        using space_type = opengm::UniformSpace<label_type>;
+        using GmType = opengm::GraphicalModel<space_type, value_type>;
+
+        DenoisingChain(
+            std::size_t n_variables,
+            std::size_t n_labels = 32,
+            value_type truncation = 8,
+            std::size_t seed = 42,
+            std::size_t num_threads = 0
+        )
+        :   m_n_variables(n_variables),
+            m_n_labels(n_labels),
+            m_truncation(truncation),
+            m_seed(seed),
+            m_num_threads(num_threads)
+        {
+        }
+
+        auto seed(){
+            return m_seed;
+        }
+        auto operator()(){
+            constexpr std::size_t block_size = 64;
+            const auto model_seed = m_seed;
+            ++m_seed;
+
+            GmType gm(m_n_variables, m_n_labels);
+            detail::generate_dense_unaries(gm, m_num_threads, [&](auto vi, auto unary){
+                const auto truth = CounterRng(model_seed, m_n_variables + vi / block_size).uniform_int(0, m_n_labels - 1);
+                CounterRng rng(model_seed, vi);
+                const auto observed = value_type(truth) + rng.uniform(value_type(-3), value_type(3));
+                for(std::size_t l=0; l<m_n_labels; ++l){
+                    unary[l] = std::min(std::abs(value_type(l) - observed), value_type(2) * m_truncation);
+                }
+            });
+
+            const auto smooth = gm.add_tensor(std::make_unique<TruncatedL1Tensor<value_type>>(m_n_labels, value_type(1), m_truncation));
+            gm.reserve(gm.num_factors() + m_n_variables, gm.num_index_entries() + 2 * m_n_variables, gm.num_tensors());
+            for(std::size_t vi=0; vi+1<m_n_variables; ++vi){
+                gm.add_factor(smooth, {vi, vi + 1});
+            }
+            return gm;
+        }
+
+        std::string name()const{return "DenoisingChain";}
+    private:
+        std::size_t m_n_variables;
+        std::size_t m_n_labels;
+        value_type m_truncation;
+        std::size_t m_seed;
+        std::size_t m_num_threads;
+    };
+
+}
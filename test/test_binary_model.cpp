@@ -0,0 +1,500 @@
+#include <doctest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <string>
+#include <cstdio>
+#include <fstream>
+#include <filesystem>
+
+#include "utils.hpp"
+
+#include "opengm/graphical_model.hpp"
+#include "opengm/grid_gm.hpp"
+#include "opengm/toy_models.hpp"
+#include "opengm/mmap_gm.hpp"
+#include "opengm/paged_gm.hpp"
+#include "opengm/io/binary_model.hpp"
+#include "opengm/io/binary_model_stream_writer.hpp"
+#include "opengm/io/uai.hpp"
+#include "opengm/io/npy.hpp"
+#include "opengm/minimizer/bp.hpp"
+#include "opengm/minimizer/icm.hpp"
+#include "opengm/minimizer/factor_icm.hpp"
+#include "opengm/minimizer/dynamic_programming.hpp"
+
+TEST_SUITE_BEGIN("io");
+
+namespace{
+
+    std::string temp_model_path(const std::string & name){
+        return (std::filesystem::temp_directory_path() / ("opengm_test_" + name + ".ogmb")).string();
+    }
+
+    template<class GM_A, class GM_B>
+    void check_same_energies(const GM_A & gm_a, const GM_B & gm_b, const std::size_t num_labelings = 20){
+        REQUIRE_EQ(gm_a.num_variables(), gm_b.num_variables());
+        REQUIRE_EQ(gm_a.num_factors(), gm_b.num_factors());
+        for(std::size_t vi=0; vi<gm_a.num_variables(); ++vi){
+            REQUIRE_EQ(gm_a.num_labels(vi), gm_b.num_labels(vi));
+        }
+        std::mt19937 gen(0);
+        std::vector<std::size_t> labels(gm_a.num_variables());
+        for(std::size_t i=0; i<num_labelings; ++i){
+            for(std::size_t vi=0; vi<labels.size(); ++vi){
+                labels[vi] = std::uniform_int_distribution<std::size_t>(0, gm_a.num_labels(vi) - 1)(gen);
+            }
+            CHECK_EQ(gm_a.evaluate(labels), gm_b.evaluate(labels));
+        }
+    }
+}
+
+TEST_CASE("binary_model"){
+    using value_type = float;
+    using mmap_gm_type = opengm::MmapGm<value_type>;
+
+    SUBCASE("GraphicalModel"){
+        auto gm = opengm::RandomModel<value_type>(30, 60, 2, 4, 1, 3)();
+        // analytic tensors shared by several factors
+        gm.add_dense_unaries();
+        const auto potts = gm.add_tensor(std::make_unique<opengm::Potts2Tensor<value_type>>(2, 0.5f));
+        const auto l1 = gm.add_tensor(std::make_unique<opengm::TruncatedL1Tensor<value_type>>(2, 0.25f, 1.0f));
+        std::size_t num_shared = 0;
+        for(std::size_t vi=0; vi+1<gm.num_variables(); ++vi){
+            if(gm.num_labels(vi) == 2 && gm.num_labels(vi+1) == 2){
+                gm.add_factor(num_shared % 2 == 0 ? potts : l1, {vi, vi + 1});
+                ++num_shared;
+            }
+        }
+        std::mt19937 gen(1);
+        for(std::size_t vi=0; vi<gm.num_variables(); ++vi){
+            auto row = gm.dense_unaries_block(vi);
+            for(auto & v : row){
+                v = std::uniform_real_distribution<value_type>(0, 1)(gen);
+            }
+        }
+
+        const auto path = temp_model_path("graphical_model");
+        opengm::io::write_binary_model(gm, path);
+        mmap_gm_type mgm(path);
+
+        CHECK_EQ(mgm.num_tensors(), gm.num_tensors() - (num_shared > 0 ? 0 : 2));
+        CHECK_EQ(mgm.max_arity(), gm.max_arity());
+        CHECK_EQ(mgm.num_index_entries(), gm.num_index_entries());
+        for(std::size_t fi=0; fi<gm.num_factors(); ++fi){
+            auto && variables = gm[fi].variables();
+            auto && mvariables = mgm[fi].variables();
+            REQUIRE(std::equal(variables.begin(), variables.end(), mvariables.begin(), mvariables.end()));
+        }
+        check_same_energies(gm, mgm);
+        std::remove(path.c_str());
+    }
+
+    SUBCASE("GridGm"){
+        using grid_type = opengm::GridGm<value_type, 2>;
+        grid_type grid({5, 6}, 3, 4, opengm::GridPairwiseKind::truncated_l1, 2.0f);
+        std::mt19937 gen(2);
+        for(auto & v : grid.unaries()){
+            v = std::uniform_real_distribution<value_type>(0, 1)(gen);
+        }
+        for(auto & w : grid.weights()){
+            w = std::uniform_real_distribution<value_type>(0, 1)(gen);
+        }
+
+        const auto path = temp_model_path("grid");
+        opengm::io::write_binary_model(grid, path);
+        const mmap_gm_type mgm(path);
+        CHECK_EQ(mgm.num_tensors(), grid.num_factors());
+        check_same_energies(grid, mgm);
+
+        // solvers run directly on the mapping
+        using bp_type = opengm::BeliefPropergation<grid_type>;
+        using mmap_bp_type = opengm::BeliefPropergation<mmap_gm_type>;
+        typename bp_type::settings_type settings;
+        settings.num_iterations = 5;
+        typename mmap_bp_type::settings_type mmap_settings;
+        mmap_settings.num_iterations = 5;
+        bp_type bp(grid, settings);
+        mmap_bp_type mmap_bp(mgm, mmap_settings);
+        bp.minimize();
+        mmap_bp.minimize();
+        CHECK_EQ(bp.best_energy(), doctest::Approx(mmap_bp.best_energy()));
+        std::remove(path.c_str());
+    }
+
+    SUBCASE("stream"){
+        auto gm = opengm::RandomModel<value_type>(40, 80, 1, 3, 1, 4)();
+        const auto path = temp_model_path("stream");
+        {
+            // small buffers st. the spill files are flushed several times
+            opengm::io::BinaryModelStreamWriter<value_type> writer(path, 64);
+            for(std::size_t vi=0; vi<gm.num_variables(); ++vi){
+                CHECK_EQ(writer.add_variables(1, gm.num_labels(vi)), vi);
+            }
+            const auto potts = writer.add_tensor(opengm::Potts2Tensor<value_type>(2, 0.5f));
+            std::size_t fi = 0;
+            for(auto && factor : gm){
+                const auto tid = writer.add_tensor(*factor.tensor());
+                auto && variables = factor.variables();
+                writer.add_factor(tid, variables.begin(), variables.end());
+                // rejected factors in the middle of the stream leave no trace
+                if(++fi == gm.num_factors() / 2){
+                    CHECK_THROWS(writer.add_factor(potts, {std::size_t(0), gm.num_variables()}));
+                    CHECK_THROWS(writer.add_factor(potts, {std::size_t(0)}));
+                    CHECK_THROWS(writer.add_factor(potts, {std::size_t(0), std::size_t(1), std::size_t(2)}));
+                    // shape of the tensor does not match the number of labels
+                    const auto too_wide = writer.add_tensor(opengm::Potts2Tensor<value_type>(gm.space().max_num_labels() + 1, 0.5f));
+                    CHECK_THROWS(writer.add_factor(too_wide, {std::size_t(0), std::size_t(1)}));
+                }
+            }
+            CHECK_EQ(writer.num_factors(), gm.num_factors());
+            writer.close();
+            CHECK_THROWS(writer.add_variables(1, 2));
+        }
+        CHECK_FALSE(std::filesystem::exists(path + ".indices.tmp"));
+        mmap_gm_type mgm(path);
+        CHECK_EQ(mgm.num_tensors(), gm.num_factors() + 2);
+        CHECK_EQ(mgm.max_arity(), gm.max_arity());
+        check_same_energies(gm, mgm);
+        std::remove(path.c_str());
+    }
+
+    SUBCASE("invalid"){
+        auto gm = opengm::RandomPottsChain(10, 3)();
+        const auto path = temp_model_path("invalid");
+        opengm::io::write_binary_model(gm, path);
+        // wrong value type
+        CHECK_THROWS(opengm::MmapGm<double>{path});
+        // truncated
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+        CHECK_THROWS(mmap_gm_type{path});
+        // not a model
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out<<std::string(256, 'x');
+        }
+        CHECK_THROWS(mmap_gm_type{path});
+
+        // corrupted fields, header sizes which overflow when multiplied
+        // throw on opening, the factors throw on access
+        using header_type = opengm::io::BinaryModelHeader;
+        using record_type = opengm::io::BinaryTensorRecord;
+        auto write = [&](){
+            opengm::io::write_binary_model(gm, path);
+            header_type header;
+            std::ifstream in(path, std::ios::binary);
+            in.read(reinterpret_cast<char *>(&header), sizeof(header));
+            return header;
+        };
+        auto corrupt = [&](const std::uint64_t position, const std::uint64_t value){
+            write();
+            std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+            out.seekp(position);
+            out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        };
+        auto access_all = [](const mmap_gm_type & mgm){
+            for(std::size_t fi=0; fi<mgm.num_factors(); ++fi){
+                mgm[fi];
+                mgm.tensor_pool_range(fi);
+            }
+        };
+        const auto header = write();
+        access_all(mmap_gm_type{path});
+        corrupt(offsetof(header_type, num_variables), std::uint64_t(1) << 61);
+        CHECK_THROWS(mmap_gm_type{path});
+        corrupt(offsetof(header_type, num_tensors), std::uint64_t(1) << 62);
+        CHECK_THROWS(mmap_gm_type{path});
+        corrupt(header.factor_offsets_offset + 8, header.num_index_entries + 1);
+        CHECK_THROWS(access_all(mmap_gm_type{path}));
+        corrupt(header.indices_offset, header.num_variables);
+        CHECK_THROWS(access_all(mmap_gm_type{path}));
+        corrupt(header.factor_tensors_offset, header.num_tensors);
+        CHECK_THROWS(access_all(mmap_gm_type{path}));
+        corrupt(header.tensor_table_offset + offsetof(record_type, offset), header.tensor_pool_size);
+        CHECK_THROWS(access_all(mmap_gm_type{path}));
+        corrupt(header.tensor_pool_offset, std::uint64_t(1) << 40);
+        CHECK_THROWS(access_all(mmap_gm_type{path}));
+        // label counts which do not match the space
+        corrupt(header.space_offset, 0);
+        CHECK_THROWS(mmap_gm_type{path});
+        corrupt(header.space_offset, header.max_num_labels + 1);
+        CHECK_THROWS(mmap_gm_type{path});
+        corrupt(header.tensor_pool_offset, 2);
+        CHECK_THROWS(access_all(mmap_gm_type{path}));
+        // a header which understates the arity of the factors
+        corrupt(offsetof(header_type, max_arity), 1);
+        CHECK_THROWS(access_all(mmap_gm_type{path}));
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("paged_gm"){
+    using value_type = float;
+    using paged_gm_type = opengm::PagedGm<value_type>;
+    const std::size_t page = opengm::io::MappedFile::page_size();
+
+    // chain with an explicit tensor per factor st. the pool spans many pages
+    const std::size_t n_variables = 300;
+    const std::size_t n_labels = 8;
+    opengm::GraphicalModel<opengm::ExplicitSpace<std::size_t>, value_type> gm(opengm::ExplicitSpace<std::size_t>(n_variables, n_labels));
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<value_type> dist(-1, 1);
+    for(std::size_t vi=0; vi<n_variables; ++vi){
+        std::vector<value_type> unary(n_labels);
+        for(auto & value : unary){
+            value = dist(gen);
+        }
+        gm.add_factor(std::make_unique<opengm::UnaryTensor<value_type>>(unary.begin(), unary.end()), {vi});
+        if(vi + 1 < n_variables){
+            auto values = xt::xarray<value_type>::from_shape(std::array<std::size_t, 2>{n_labels, n_labels});
+            for(auto & value : values){
+                value = dist(gen);
+            }
+            gm.add_factor(std::make_unique<opengm::XArrayTensor<value_type>>(std::move(values)), {vi, vi + 1});
+        }
+    }
+    const auto path = temp_model_path("paged");
+    opengm::io::write_binary_model(gm, path);
+
+    opengm::io::ResidencySettings settings;
+    settings.chunk_bytes = page;
+    settings.budget_bytes = 4 * page;
+    settings.readahead_chunks = 2;
+
+    auto check_residency = [&](const paged_gm_type & pgm){
+        const auto stats = pgm.residency_stats();
+        CHECK_GT(stats.misses, 0);
+        CHECK_GT(stats.evictions, 0);
+        CHECK_LE(stats.resident_bytes, settings.budget_bytes);
+        CHECK_LE(stats.peak_resident_bytes, settings.budget_bytes + (settings.readahead_chunks + 1) * page);
+    };
+
+    SUBCASE("energies"){
+        paged_gm_type pgm(path, settings);
+        CHECK_GT(pgm.residency().num_chunks(), 4);
+        check_same_energies(gm, pgm);
+        check_residency(pgm);
+    }
+    SUBCASE("Icm"){
+        paged_gm_type pgm(path, settings);
+        opengm::Icm<decltype(gm)> icm(gm);
+        opengm::Icm<paged_gm_type> paged_icm(pgm);
+        icm.minimize();
+        paged_icm.minimize();
+        CHECK_EQ(icm.best_labels(), paged_icm.best_labels());
+        check_residency(pgm);
+    }
+    SUBCASE("FactorIcm"){
+        paged_gm_type pgm(path, settings);
+        opengm::FactorIcm<decltype(gm)> icm(gm);
+        opengm::FactorIcm<paged_gm_type> paged_icm(pgm);
+        icm.minimize();
+        paged_icm.minimize();
+        CHECK_EQ(icm.best_labels(), paged_icm.best_labels());
+        check_residency(pgm);
+    }
+    SUBCASE("DynamicProgramming"){
+        paged_gm_type pgm(path, settings);
+        opengm::DynamicProgramming<decltype(gm)> dp(gm);
+        opengm::DynamicProgramming<paged_gm_type> paged_dp(pgm);
+        dp.minimize();
+        paged_dp.minimize();
+        CHECK_EQ(dp.best_labels(), paged_dp.best_labels());
+        CHECK_EQ(paged_dp.best_energy(), doctest::Approx(dp.best_energy()));
+        // the backward sweep runs along the chain, all
+        // chunks after the first are read ahead or prefetched
+        CHECK_GT(pgm.residency_stats().prefetches, pgm.residency_stats().misses);
+        check_residency(pgm);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("uai"){
+    using value_type = double;
+
+    SUBCASE("model"){
+        auto gm = opengm::RandomModel<value_type>(500, 20000, 2, 3, 1, 3)();
+        const auto path = temp_model_path("uai");
+        opengm::io::write_uai(gm, path);
+
+        opengm::io::UaiReadSettings settings;
+        settings.num_threads = 1;
+        const auto gm_sequential = opengm::io::read_uai<value_type>(path, settings);
+        settings.num_threads = 4;
+        const auto gm_parallel = opengm::io::read_uai<value_type>(path, settings);
+        CHECK_EQ(gm_parallel.num_factors(), gm.num_factors());
+        check_same_energies(gm_sequential, gm_parallel);
+
+        std::vector<std::size_t> labels(gm.num_variables(), 1);
+        CHECK_EQ(gm_parallel.evaluate(labels), doctest::Approx(gm.evaluate(labels)).epsilon(1e-6));
+        std::remove(path.c_str());
+    }
+
+    SUBCASE("energies"){
+        auto gm = opengm::RandomPottsGrid(4, 3, 3)();
+        const auto path = temp_model_path("uai_energies");
+        opengm::io::write_uai(gm, path, opengm::io::UaiValues::energies);
+        opengm::io::UaiReadSettings settings;
+        settings.values = opengm::io::UaiValues::energies;
+        const auto read_gm = opengm::io::read_uai<float>(path, settings);
+        std::vector<std::size_t> labels(gm.num_variables(), 2);
+        CHECK_EQ(read_gm.evaluate(labels), doctest::Approx(gm.evaluate(labels)));
+        std::remove(path.c_str());
+    }
+
+    SUBCASE("malformed"){
+        const auto path = temp_model_path("uai_malformed");
+        {
+            std::ofstream out(path);
+            out<<"MARKOV\n2\n2 2\n1\n2 0 1\n4\n0.1 0.2 0.3\n";
+        }
+        CHECK_THROWS(opengm::io::read_uai<float>(path));
+        // 2^32 x 2^32 entries wrap to a table size of 0
+        {
+            std::ofstream out(path);
+            out<<"MARKOV\n2\n4294967296 4294967296\n1\n2 0 1\n0\n";
+        }
+        CHECK_THROWS_WITH(opengm::io::read_uai<float>(path), "UAI table too large");
+        // a factor count which wraps the offsets and one which overflows
+        {
+            std::ofstream out(path);
+            out<<"MARKOV\n1\n2\n18446744073709551615\n";
+        }
+        CHECK_THROWS_WITH(opengm::io::read_uai<float>(path), "too many factors in UAI file");
+        {
+            std::ofstream out(path);
+            out<<"MARKOV\n1\n2\n18446744073709551617\n";
+        }
+        CHECK_THROWS(opengm::io::read_uai<float>(path));
+        std::remove(path.c_str());
+    }
+
+    SUBCASE("evidence_and_solution"){
+        const auto path = temp_model_path("uai_evidence");
+        const std::vector<std::pair<std::size_t, std::size_t>> evidence{{3, 1}, {0, 2}};
+        opengm::io::write_uai_evidence(path, evidence);
+        CHECK(opengm::io::read_uai_evidence(path) == evidence);
+
+        const std::vector<std::size_t> labels{0, 2, 1, 1};
+        opengm::io::write_uai_solution(path, labels);
+        CHECK(opengm::io::read_uai_solution(path) == labels);
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("npy"){
+    using value_type = float;
+    const auto path = temp_model_path("npy");
+
+    SUBCASE("roundtrip"){
+        std::vector<value_type> values(2 * 3 * 4);
+        std::iota(values.begin(), values.end(), value_type(0));
+        opengm::io::write_npy(path, values.data(), {2, 3, 4});
+        auto array = opengm::io::read_npy<value_type>(path);
+        CHECK_EQ(array.shape(), std::vector<std::size_t>({2, 3, 4}));
+        CHECK_EQ(array.data()[23], 23.0f);
+        // the values are viewed in the mapping
+        CHECK_EQ(reinterpret_cast<const char *>(array.data()), array.file()->data() + 128);
+        CHECK_THROWS(opengm::io::read_npy<double>(path));
+    }
+    SUBCASE("numpy_header"){
+        // header as written by numpy.save, including a 1 tuple shape
+        std::string dict = "{'descr': '<f8', 'fortran_order': False, 'shape': (3,), }";
+        dict.resize(118 - 1, ' ');
+        dict += '\n';
+        const std::uint16_t len = std::uint16_t(dict.size());
+        const double values[3] = {0.5, 1.5, 2.5};
+        {
+            std::ofstream out(path, std::ios::binary);
+            out.write("\x93NUMPY\x01\x00", 8);
+            out.write(reinterpret_cast<const char *>(&len), 2);
+            out<<dict;
+            out.write(reinterpret_cast<const char *>(values), sizeof(values));
+        }
+        auto array = opengm::io::read_npy<double>(path);
+        CHECK_EQ(array.shape(), std::vector<std::size_t>({3}));
+        CHECK_EQ(array[2], 2.5);
+    }
+    SUBCASE("malformed_header"){
+        // the header ends right after the colon of a key
+        // or has a shape whose number of values overflows
+        for(const std::string dict : {"{'descr':", "{'descr':   ",
+            "{'descr': '<f4', 'fortran_order': False, 'shape': (4611686018427387904, 4), }",
+            "{'descr': '<f4', 'fortran_order': False, 'shape': (18446744073709551616,), }"})
+        {
+            std::string bytes("\x93NUMPY\x01\x00", 8);
+            const std::uint16_t len = std::uint16_t(dict.size());
+            bytes.append(reinterpret_cast<const char *>(&len), 2);
+            bytes += dict;
+            CHECK_THROWS_WITH(opengm::io::parse_npy_header(bytes.data(), bytes.size()), "malformed .npy header");
+        }
+    }
+    SUBCASE("model"){
+        // unaries and a shared pairwise table as exported by python tools
+        const std::size_t n_variables = 6;
+        const std::size_t n_labels = 3;
+        std::mt19937 gen(3);
+        std::uniform_real_distribution<value_type> dist(-1, 1);
+        std::vector<value_type> unaries(n_variables * n_labels), pairwise(n_labels * n_labels);
+        for(auto & value : unaries){
+            value = dist(gen);
+        }
+        for(auto & value : pairwise){
+            value = dist(gen);
+        }
+        const auto unaries_path = temp_model_path("npy_unaries");
+        opengm::io::write_npy(unaries_path, unaries.data(), {n_variables, n_labels});
+        opengm::io::write_npy(path, pairwise.data(), {n_labels, n_labels});
+
+        using gm_type = opengm::GraphicalModel<opengm::ExplicitSpace<std::size_t>, value_type>;
+        gm_type expected(opengm::ExplicitSpace<std::size_t>(n_variables, n_labels));
+        gm_type gm(opengm::ExplicitSpace<std::size_t>(n_variables, n_labels));
+        {
+            auto unary_array = opengm::io::read_npy<value_type>(unaries_path);
+            opengm::io::add_npy_unaries(gm, unary_array);
+            const auto tid = opengm::io::add_npy_tensor(gm, opengm::io::read_npy<value_type>(path));
+            CHECK_EQ(gm.dense_unaries().data, unary_array.data());
+            for(std::size_t vi=0; vi<n_variables; ++vi){
+                expected.add_factor(std::make_unique<opengm::UnaryTensor<value_type>>(
+                    unaries.begin() + vi * n_labels, unaries.begin() + (vi + 1) * n_labels), {vi});
+            }
+            for(std::size_t vi=0; vi<n_variables; ++vi){
+                if(vi + 1 < n_variables){
+                    gm.add_factor(tid, {vi, vi + 1});
+                    auto table = xt::xarray<value_type>::from_shape(std::array<std::size_t, 2>{n_labels, n_labels});
+                    std::copy(pairwise.begin(), pairwise.end(), table.begin());
+                    expected.add_factor(std::make_unique<opengm::XArrayTensor<value_type>>(std::move(table)), {vi, vi + 1});
+                }
+            }
+        }
+        // the arrays are gone, the model keeps the mappings alive
+        check_same_energies(expected, gm);
+
+        typename opengm::BeliefPropergation<gm_type>::settings_type settings;
+        settings.num_iterations = 20;
+        opengm::BeliefPropergation<gm_type> bp(gm, settings);
+        bp.minimize();
+        opengm::io::write_npy_labels(path, bp.best_labels());
+        CHECK_EQ(opengm::io::read_npy_labels(path), bp.best_labels());
+        const std::vector<std::int32_t> negative_labels{0, -1, 2};
+        opengm::io::write_npy(path, negative_labels.data(), {negative_labels.size()});
+        CHECK_THROWS(opengm::io::read_npy_labels(path));
+
+        opengm::io::write_npy_beliefs(path, bp);
+        auto beliefs = opengm::io::read_npy<value_type>(path);
+        REQUIRE_EQ(beliefs.shape(), std::vector<std::size_t>({n_variables, n_labels}));
+        for(std::size_t vi=0; vi<n_variables; ++vi){
+            const auto row = beliefs.data() + vi * n_labels;
+            const auto argmin = std::size_t(std::min_element(row, row + n_labels) - row);
+            CHECK_EQ(argmin, bp.current_labels()[vi]);
+            CHECK_EQ(row[argmin], 0.0f);
+        }
+        std::remove(unaries_path.c_str());
+    }
+    std::remove(path.c_str());
+}
+
+TEST_SUITE_END(); // end of testsuite io
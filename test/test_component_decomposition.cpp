@@ -0,0 +1,117 @@
+#include <doctest.h>
+
+#include <random>
+
+#include "utils.hpp"
+
+#include "opengm/graphical_model.hpp"
+#include "opengm/grid_gm.hpp"
+#include "opengm/minimizer/dynamic_programming.hpp"
+#include "opengm/minimizer/icm.hpp"
+#include "opengm/minimizer/component_decomposition.hpp"
+
+TEST_SUITE_BEGIN("gm");
+
+TEST_CASE("ComponentDecomposition"){
+    using value_type = double;
+    using space_type = opengm::UniformSpace<std::size_t>;
+    using gm_type = opengm::GraphicalModel<space_type, value_type>;
+    using minimizer_type = opengm::ComponentDecomposition<gm_type>;
+    using sub_gm_type = typename minimizer_type::sub_gm_type;
+
+    const std::size_t n_labels = 4;
+    const std::vector<std::size_t> chain_lengths{7, 1, 30, 3, 12, 2};
+    // one extra variable without any factor
+    const auto num_variables = std::accumulate(chain_lengths.begin(), chain_lengths.end(), std::size_t(1));
+    gm_type gm(space_type(num_variables, n_labels));
+
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<value_type> dis(-1.0, 1.0);
+    const auto potts = gm.add_tensor(std::make_unique<opengm::Potts2Tensor<value_type>>(n_labels, 0.3));
+
+    // interleave the chains st. components are not contiguous
+    std::vector<std::size_t> variables(num_variables - 1);
+    std::iota(variables.begin(), variables.end(), 0);
+    std::shuffle(variables.begin(), variables.end(), gen);
+    std::size_t offset = 0;
+    for(auto length : chain_lengths){
+        for(std::size_t i=0; i<length; ++i){
+            std::vector<value_type> values(n_labels);
+            for(auto & v : values){
+                v = dis(gen);
+            }
+            gm.add_unary_factor(std::make_unique<opengm::UnaryTensor<value_type>>(values.begin(), values.end()), variables[offset + i]);
+            if(i > 0){
+                gm.add_factor(potts, {variables[offset + i - 1], variables[offset + i]});
+            }
+        }
+        offset += length;
+    }
+
+    opengm::DynamicProgramming<gm_type> dp(gm);
+    dp.minimize();
+
+    for(auto num_threads : {1, 3}){
+        typename minimizer_type::settings_type settings;
+        settings.num_threads = num_threads;
+        settings.minimizer_factory = opengm::make_shared_factory<opengm::DynamicProgramming<sub_gm_type>>();
+        minimizer_type minimizer(gm, settings);
+
+        REQUIRE_EQ(minimizer.num_components(), chain_lengths.size());
+        std::size_t num_component_variables = 0;
+        for(std::size_t ci=0; ci<minimizer.num_components(); ++ci){
+            num_component_variables += minimizer.component_variables(ci).size();
+            CHECK_EQ(minimizer.component_gm(ci).num_variables(), minimizer.component_variables(ci).size());
+        }
+        CHECK_EQ(num_component_variables, num_variables - 1);
+
+        minimizer.minimize();
+        CHECK_EQ(minimizer.best_energy(), doctest::Approx(dp.best_energy()));
+        CHECK_EQ(minimizer.best_energy(), doctest::Approx(gm.evaluate(minimizer.best_labels())));
+
+        auto && energies = minimizer.component_energies();
+        CHECK_EQ(std::accumulate(energies.begin(), energies.end(), value_type(0)), doctest::Approx(minimizer.best_energy()));
+    }
+}
+
+TEST_CASE("ComponentDecomposition GridGm"){
+    // the factors of a GridGm are proxies, the
+    // submodel has to keep clones of their tensors
+    using gm_type = opengm::GridGm<double, 2>;
+    using minimizer_type = opengm::ComponentDecomposition<gm_type>;
+    using sub_gm_type = typename minimizer_type::sub_gm_type;
+
+    gm_type gm({6,7}, 3, 8, opengm::GridPairwiseKind::truncated_l1, 1.5);
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> dis(-1.0, 1.0);
+    for(auto & v : gm.unaries()){
+        v = dis(gen);
+    }
+    for(auto & w : gm.weights()){
+        w = dis(gen);
+    }
+
+    typename minimizer_type::settings_type settings;
+    settings.num_threads = 1;
+    settings.minimizer_factory = opengm::make_shared_factory<opengm::Icm<sub_gm_type>>();
+    minimizer_type minimizer(gm, settings);
+    REQUIRE_EQ(minimizer.num_components(), 1);
+
+    std::uniform_int_distribution<std::size_t> label_dis(0, 2);
+    std::vector<std::size_t> labels(gm.num_variables());
+    for(std::size_t i=0; i<5; ++i){
+        for(auto & l : labels){
+            l = label_dis(gen);
+        }
+        CHECK_EQ(minimizer.component_gm(0).evaluate(labels), doctest::Approx(gm.evaluate(labels)));
+    }
+
+    // the overload taking a labels vector is not hidden
+    minimizer.set_starting_point(labels);
+    CHECK(std::equal(labels.begin(), labels.end(), minimizer.best_labels().begin()));
+
+    minimizer.minimize();
+    CHECK_EQ(minimizer.best_energy(), doctest::Approx(gm.evaluate(minimizer.best_labels())));
+}
+
+TEST_SUITE_END(); // end of testsuite gm
@@ -3,6 +3,7 @@
 #include "utils.hpp"
 #include "opengm/minimizer/utils/conditioned_submodel.hpp"
 #include "opengm/toy_models.hpp"
+#include "opengm/grid_gm.hpp"
 
 
 
@@ -46,5 +47,105 @@ TEST_CASE("ConditionedSubmodel"){
 }
 
 
+TEST_CASE("ConditionedSubmodelPrepareCommit"){
+
+    auto gm = opengm::RandomPottsGrid(6/*nx*/,5/*ny*/,3/*n_labels*/)();
+    using gm_type = std::decay_t<decltype(gm)>;
+    using labels_vector_type = typename gm_type::labels_vector_type;
+    using builder_type = opengm::detail::ConditionedSubmodelBuilder<gm_type>;
+    using factors_of_variables_type = typename builder_type::factors_of_variables_type;
+
+    auto factors_of_variables = std::make_shared<const factors_of_variables_type>(gm);
+    builder_type builder(gm, factors_of_variables);
+
+    labels_vector_type labels(gm.num_variables(), 1);
+
+    // the energy of the submodel differs from the energy of
+    // the model only by the constant of the fixed variables
+    auto check_block = [&](std::initializer_list<std::size_t> block){
+        auto && sub_gm = builder.prepare(block, labels);
+        REQUIRE_EQ(sub_gm.num_variables(), block.size());
+        CHECK_EQ(builder.sub_gm_to_gm().size(), block.size());
+
+        labels_vector_type sub_labels(block.size(), 0);
+        labels_vector_type full_labels = labels;
+        builder.commit(sub_labels, full_labels);
+        const auto offset = gm.evaluate(full_labels) - sub_gm.evaluate(sub_labels);
+
+        for(std::size_t i=0; i<sub_labels.size(); ++i){
+            sub_labels[i] = (i*7 + 1) % 3;
+        }
+        builder.commit(sub_labels, full_labels);
+        CHECK_EQ(gm.evaluate(full_labels) - sub_gm.evaluate(sub_labels), doctest::Approx(offset));
+        for(std::size_t i=0; i<sub_labels.size(); ++i){
+            CHECK_EQ(full_labels[builder.sub_gm_to_gm()[i]], sub_labels[i]);
+        }
+    };
+
+    // the submodel and its buffers are reused
+    check_block({0, 1, 2});
+    check_block({7, 8, 13, 14});
+    check_block({29, 3});
+}
+
+TEST_CASE("ConditionedSubmodelHigherOrder"){
+    // factors of arity 3 with two free variables are bound
+    auto gm = opengm::RandomModel<float>(12, 30, 2, 3, 1, 3)();
+    using gm_type = std::decay_t<decltype(gm)>;
+    using labels_vector_type = typename gm_type::labels_vector_type;
+    opengm::detail::ConditionedSubmodelBuilder<gm_type> builder(gm);
+
+    labels_vector_type labels(gm.num_variables(), 0);
+    auto check_block = [&](std::initializer_list<std::size_t> block){
+        auto && sub_gm = builder.prepare(block, labels);
+        REQUIRE_EQ(sub_gm.num_variables(), block.size());
+
+        labels_vector_type full_labels = labels;
+        labels_vector_type sub_labels(block.size(), 0);
+        const auto offset = gm.evaluate(full_labels) - sub_gm.evaluate(sub_labels);
+        sub_gm.space().for_each_state(sub_labels, [&](auto && sub_labels){
+            builder.commit(sub_labels, full_labels);
+            CHECK_EQ(gm.evaluate(full_labels) - sub_gm.evaluate(sub_labels), doctest::Approx(offset));
+        });
+    };
+    check_block({0, 1, 2, 3});
+    check_block({4, 5, 6});
+    check_block({2, 7, 9, 11});
+}
+
+TEST_CASE("ConditionedSubmodel GridGm"){
+    // the factors of a GridGm are proxies, factors with only
+    // free variables must not point into the proxies
+    using gm_type = opengm::GridGm<double, 2>;
+    using labels_vector_type = typename gm_type::labels_vector_type;
+    gm_type gm({4,5}, 2, 8, opengm::GridPairwiseKind::l1);
+    std::size_t i = 0;
+    for(auto & v : gm.unaries()){
+        v = double((i++ * 7) % 5) / 5.0;
+    }
+    for(auto & w : gm.weights()){
+        w = double((i++ * 3) % 4) / 4.0 - 0.3;
+    }
+    opengm::detail::ConditionedSubmodelBuilder<gm_type> builder(gm);
+
+    labels_vector_type labels(gm.num_variables(), 1);
+    auto check_block = [&](std::initializer_list<std::size_t> block){
+        auto && sub_gm = builder.prepare(block, labels);
+        REQUIRE_EQ(sub_gm.num_variables(), block.size());
+
+        labels_vector_type full_labels = labels;
+        labels_vector_type sub_labels(block.size(), 0);
+        builder.commit(sub_labels, full_labels);
+        const auto offset = gm.evaluate(full_labels) - sub_gm.evaluate(sub_labels);
+        sub_gm.space().for_each_state(sub_labels, [&](auto && sub_labels){
+            builder.commit(sub_labels, full_labels);
+            CHECK_EQ(gm.evaluate(full_labels) - sub_gm.evaluate(sub_labels), doctest::Approx(offset));
+        });
+    };
+    check_block({0, 1, 4, 5});
+    check_block({6, 7, 10, 11, 15});
+}
+
+
 
 TEST_SUITE_END(); // end of testsuite gm
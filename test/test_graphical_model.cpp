@@ -1,5 +1,8 @@
 #include <doctest.h>
 
+#include <random>
+#include <thread>
+
 #include "opengm/opengm.hpp"
 #include "opengm/opengm_config.hpp"
 
@@ -8,6 +11,15 @@
 #include "opengm/space.hpp"
 #include "opengm/opengm_config.hpp"
 #include "opengm/graphical_model.hpp"
+#include "opengm/graphical_model_builder.hpp"
+#include "opengm/grid_gm.hpp"
+#include "opengm/toy_models.hpp"
+#include "opengm/minimizer/bp.hpp"
+#include "opengm/minimizer/icm.hpp"
+#include "opengm/minimizer/dynamic_programming.hpp"
+#include "opengm/minimizer/utils/label_fuser.hpp"
+
+#include <xtensor/xtensor.hpp>
 
 
 
@@ -63,4 +75,438 @@ TEST_CASE("vgm"){
 
 
 
+TEST_CASE("evaluate_many"){
+
+    auto check_evaluate_many = [](auto && gm){
+        using gm_type = std::decay_t<decltype(gm)>;
+        using labels_vector_type = typename gm_type::labels_vector_type;
+        using value_type = typename gm_type::value_type;
+
+        std::mt19937 gen(42);
+        std::vector<labels_vector_type> labelings(7, labels_vector_type(gm.num_variables()));
+        for(auto & labels : labelings){
+            for(std::size_t vi=0; vi<gm.num_variables(); ++vi){
+                labels[vi] = std::uniform_int_distribution<std::size_t>(0, gm.num_labels(vi)-1)(gen);
+            }
+        }
+
+        std::vector<value_type> energies(labelings.size());
+        gm.evaluate_many(labelings, energies);
+        for(std::size_t i=0; i<labelings.size(); ++i){
+            CHECK_EQ(energies[i], doctest::Approx(gm.evaluate(labelings[i])));
+        }
+    };
+
+    SUBCASE("RandomPottsGrid"){
+        check_evaluate_many(opengm::RandomPottsGrid(5, 4, 3)());
+    }
+    SUBCASE("RandomModel"){
+        check_evaluate_many(opengm::RandomModel<>(8, 20, 2, 4, 1, 3)());
+    }
+}
+
+TEST_CASE("GraphicalModelBuilder"){
+    using value_type = double;
+    using space_type = opengm::UniformSpace<std::size_t>;
+    using gm_type = opengm::GraphicalModel<space_type, value_type>;
+    using builder_type = opengm::GraphicalModelBuilder<value_type>;
+
+    const std::size_t nx = 13;
+    const std::size_t ny = 11;
+    const std::size_t num_labels = 3;
+    const std::size_t num_threads = 4;
+    auto vi = [&](auto x, auto y){return x*ny + y;};
+
+    // reference: one factor at a time
+    gm_type gm_ref(nx * ny, num_labels);
+    const auto tid_ref = gm_ref.add_tensor(std::make_unique<opengm::Potts2Tensor<value_type>>(num_labels, 1.0));
+    for(std::size_t x=0; x<nx; ++x){
+        for(std::size_t y=0; y<ny; ++y){
+            gm_ref.add_unary_factor(std::make_unique<opengm::UnaryTensor<value_type>>(
+                std::initializer_list<value_type>{value_type(x), value_type(y), 0.5}), vi(x,y));
+            if(y + 1 < ny){
+                gm_ref.add_factor(tid_ref, {vi(x,y), vi(x,y+1)});
+            }
+            if(x + 1 < nx){
+                gm_ref.add_factor(tid_ref, {vi(x,y), vi(x+1,y)});
+            }
+        }
+    }
+
+    // each thread builds the rows x % num_threads == t
+    // with bulk insertion and its own potts tensor
+    std::vector<builder_type> builders(num_threads);
+    std::vector<std::thread> threads;
+    for(std::size_t t=0; t<num_threads; ++t){
+        threads.emplace_back([&, t](){
+            auto & builder = builders[t];
+            builder.reserve(3 * ny * (nx / num_threads + 1), 5 * ny * (nx / num_threads + 1), ny * (nx / num_threads + 1) + 1);
+            const auto tid_potts = builder.add_tensor(std::make_unique<opengm::Potts2Tensor<value_type>>(num_labels, 1.0));
+            for(std::size_t x=t; x<nx; x+=num_threads){
+                for(std::size_t y=0; y<ny; ++y){
+                    const auto tid = builder.add_tensor(std::make_unique<opengm::UnaryTensor<value_type>>(
+                        std::initializer_list<value_type>{value_type(x), value_type(y), 0.5}));
+                    builder.add_factor(tid, {vi(x,y)});
+                    std::vector<std::size_t> vis;
+                    if(y + 1 < ny){
+                        vis.insert(vis.end(), {vi(x,y), vi(x,y+1)});
+                    }
+                    if(x + 1 < nx){
+                        vis.insert(vis.end(), {vi(x,y), vi(x+1,y)});
+                    }
+                    builder.add_factors(2, vis, tid_potts);
+                }
+            }
+        });
+    }
+    for(auto & thread : threads){
+        thread.join();
+    }
+
+    gm_type gm(nx * ny, num_labels);
+    opengm::merge_builders(gm, builders);
+    CHECK_EQ(gm.num_factors(), gm_ref.num_factors());
+    CHECK_EQ(gm.num_tensors(), nx * ny + num_threads);
+    CHECK_EQ(gm.num_index_entries(), gm_ref.num_index_entries());
+    for(auto && builder : builders){
+        CHECK_EQ(builder.num_factors(), 0);
+    }
+
+    // copies must not point into the index pool of the original
+    opengm::TensorViewGm<space_type, value_type> view(nx * ny, num_labels);
+    for(auto && factor : gm){
+        auto && variables = factor.variables();
+        view.add_factor(factor.tensor(), variables.begin(), variables.end());
+    }
+    const auto & const_view = view;
+    const auto view_copy = const_view;
+    CHECK(view_copy[0].variables().data() != view[0].variables().data());
+
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<std::size_t> dis(0, num_labels - 1);
+    std::vector<std::size_t> labels(nx * ny);
+    for(std::size_t i=0; i<10; ++i){
+        for(auto & l : labels){
+            l = dis(gen);
+        }
+        CHECK(gm.evaluate(labels) == doctest::Approx(gm_ref.evaluate(labels)));
+        CHECK(view_copy.evaluate(labels) == doctest::Approx(gm_ref.evaluate(labels)));
+    }
+}
+
+
+TEST_CASE("dense_unaries"){
+    using value_type = double;
+    using space_type = opengm::UniformSpace<std::size_t>;
+    using gm_type = opengm::GraphicalModel<space_type, value_type>;
+
+    const std::size_t num_variables = 12;
+    const std::size_t num_labels = 5;
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<value_type> dis(0.0, 1.0);
+    xt::xtensor<value_type, 2> unaries(typename xt::xtensor<value_type, 2>::shape_type{num_variables, num_labels});
+    for(auto & v : unaries){
+        v = dis(gen);
+    }
+
+    // a chain with classic unaries, a chain with an owned dense block
+    // and a chain viewing the xtensor
+    gm_type gm(num_variables, num_labels);
+    gm_type gm_owned(num_variables, num_labels);
+    gm_type gm_view(num_variables, num_labels);
+    gm_owned.add_factor(std::make_unique<opengm::Potts2Tensor<value_type>>(num_labels, 0.3), {0, 1});
+    const auto factor_begin = gm_owned.add_dense_unaries();
+    CHECK_EQ(factor_begin, 1);
+    CHECK_EQ(gm_view.add_dense_unaries_view(unaries), 0);
+    CHECK_EQ(gm_owned.dense_unaries().stride % (64 / sizeof(value_type)), 0);
+    CHECK_EQ(reinterpret_cast<std::uintptr_t>(gm_owned.dense_unaries().data) % 64, 0);
+    CHECK(gm_view.dense_unaries().data == unaries.data());
+
+    for(std::size_t vi=0; vi<num_variables; ++vi){
+        std::vector<value_type> row(unaries.data() + vi * num_labels, unaries.data() + (vi + 1) * num_labels);
+        gm.add_unary_factor(std::make_unique<opengm::UnaryTensor<value_type>>(row.begin(), row.end()), vi);
+        auto block_row = gm_owned.dense_unaries_block(vi);
+        std::copy(row.begin(), row.end(), block_row.begin());
+    }
+    gm.add_factor(std::make_unique<opengm::Potts2Tensor<value_type>>(num_labels, 0.3), {0, 1});
+    const auto tid = gm.add_tensor(std::make_unique<opengm::Potts2Tensor<value_type>>(num_labels, 0.4));
+    const auto tid_owned = gm_owned.add_tensor(std::make_unique<opengm::Potts2Tensor<value_type>>(num_labels, 0.4));
+    const auto tid_view = gm_view.add_tensor(std::make_unique<opengm::Potts2Tensor<value_type>>(num_labels, 0.4));
+    for(std::size_t vi=1; vi+1<num_variables; ++vi){
+        gm.add_factor(tid, {vi, vi+1});
+        gm_owned.add_factor(tid_owned, {vi, vi+1});
+        gm_view.add_factor(tid_view, {vi, vi+1});
+    }
+    gm_view.add_factor(std::make_unique<opengm::Potts2Tensor<value_type>>(num_labels, 0.3), {0, 1});
+
+    std::vector<std::size_t> labels(num_variables);
+    for(std::size_t i=0; i<5; ++i){
+        for(auto & l : labels){
+            l = std::uniform_int_distribution<std::size_t>(0, num_labels - 1)(gen);
+        }
+        CHECK(gm_owned.evaluate(labels) == doctest::Approx(gm.evaluate(labels)));
+        CHECK(gm_view.evaluate(labels) == doctest::Approx(gm.evaluate(labels)));
+    }
+
+    SUBCASE("DynamicProgramming"){
+        opengm::DynamicProgramming<gm_type> dp(gm);
+        opengm::DynamicProgramming<gm_type> dp_owned(gm_owned);
+        dp.minimize();
+        dp_owned.minimize();
+        CHECK(dp_owned.best_energy() == doctest::Approx(dp.best_energy()));
+        CHECK_EQ(dp_owned.best_labels(), dp.best_labels());
+    }
+    SUBCASE("BeliefPropergation"){
+        using minimizer_type = opengm::BeliefPropergation<gm_type>;
+        typename minimizer_type::settings_type settings;
+        settings.num_iterations = 20;
+        minimizer_type bp(gm, settings);
+        minimizer_type bp_owned(gm_owned, settings);
+        bp.minimize();
+        bp_owned.minimize();
+        CHECK(bp_owned.best_energy() == doctest::Approx(bp.best_energy()));
+    }
+    SUBCASE("LabelFuser"){
+        using label_fuser_type = opengm::LabelFuser<gm_type>;
+        typename label_fuser_type::settings_type settings;
+        label_fuser_type fuser(gm, settings);
+        label_fuser_type fuser_owned(gm_owned, settings);
+        std::vector<std::size_t> labels_a(num_variables), labels_b(num_variables);
+        std::vector<std::size_t> fused(num_variables), fused_owned(num_variables);
+        for(std::size_t vi=0; vi<num_variables; ++vi){
+            labels_a[vi] = std::uniform_int_distribution<std::size_t>(0, num_labels - 1)(gen);
+            labels_b[vi] = std::uniform_int_distribution<std::size_t>(0, num_labels - 1)(gen);
+        }
+        const auto e = fuser.fuse(labels_a, labels_b, fused);
+        const auto e_owned = fuser_owned.fuse(labels_a, labels_b, fused_owned);
+        CHECK(e_owned == doctest::Approx(e));
+        CHECK_EQ(fused_owned, fused);
+    }
+}
+
+TEST_CASE("factors_of_arity"){
+    using value_type = double;
+    using space_type = opengm::UniformSpace<std::size_t>;
+    using gm_type = opengm::GraphicalModel<space_type, value_type>;
+
+    gm_type gm(space_type(5, 2));
+    const auto unary = gm.add_tensor(std::make_unique<opengm::UnaryTensor<value_type>>(2));
+    const auto potts = gm.add_tensor(std::make_unique<opengm::Potts2Tensor<value_type>>(2, 1.0));
+    const auto potts3 = gm.add_tensor(std::make_unique<opengm::PottsNTensor<value_type, 3>>(2, 1.0));
+    gm.add_factor(potts, {0, 1});
+    gm.add_unary_factor(unary, 0);
+    gm.add_factor(potts3, {1, 2, 3});
+    gm.add_factor(potts, {3, 4});
+    gm.add_unary_factor(unary, 4);
+
+    auto collect = [](auto && gm, auto arity_constant, auto min_arity_constant){
+        std::vector<std::size_t> of_arity, of_min_arity;
+        gm.template for_each_factor_of_arity<decltype(arity_constant)::value>([&](auto fi, auto && factor){
+            CHECK_EQ(factor.arity(), decltype(arity_constant)::value);
+            of_arity.push_back(fi);
+        });
+        gm.template for_each_factor_of_min_arity<decltype(min_arity_constant)::value>([&](auto fi, auto &&){
+            of_min_arity.push_back(fi);
+        });
+        return std::make_pair(of_arity, of_min_arity);
+    };
+    using c1 = std::integral_constant<std::size_t, 1>;
+    using c2 = std::integral_constant<std::size_t, 2>;
+    using c3 = std::integral_constant<std::size_t, 3>;
+    using c4 = std::integral_constant<std::size_t, 4>;
+
+    CHECK_EQ(gm.max_arity(), 3);
+    CHECK_EQ(collect(gm, c1(), c2()), std::make_pair(std::vector<std::size_t>{1, 4}, std::vector<std::size_t>{0, 3, 2}));
+    CHECK_EQ(collect(gm, c2(), c3()), std::make_pair(std::vector<std::size_t>{0, 3}, std::vector<std::size_t>{2}));
+    CHECK_EQ(collect(gm, c4(), c4()), std::make_pair(std::vector<std::size_t>{}, std::vector<std::size_t>{}));
+    CHECK_EQ(gm.factors_of_arity(3).size(), 1);
+
+    // the GridGm layout: unaries first, then the edges
+    opengm::GridGm<double, 2> grid({2, 3}, 2, 4);
+    auto [unaries, edges] = collect(grid, c1(), c2());
+    CHECK_EQ(unaries.size(), 6);
+    CHECK_EQ(edges.size(), grid.num_edges());
+    CHECK_EQ(edges.front(), 6);
+}
+
+TEST_CASE("update_values"){
+    using value_type = double;
+    using space_type = opengm::UniformSpace<std::size_t>;
+    using gm_type = opengm::GraphicalModel<space_type, value_type>;
+
+    const std::size_t num_variables = 15;
+    const std::size_t num_labels = 4;
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<value_type> dis(0.0, 1.0);
+
+    // a chain where the unaries change from frame to frame
+    gm_type gm(num_variables, num_labels);
+    gm.add_dense_unaries();
+    const auto bias = gm.add_tensor(std::make_unique<opengm::UnaryTensor<value_type>>(std::initializer_list<value_type>{0.0, 0.2, 0.4, 0.6}));
+    gm.add_unary_factor(bias, 0);
+    const auto pairwise = gm.add_tensor(std::make_unique<opengm::Potts2Tensor<value_type>>(num_labels, 0.3));
+    for(std::size_t vi=0; vi+1<num_variables; ++vi){
+        gm.add_factor(pairwise, {vi, vi+1});
+    }
+
+    opengm::DynamicProgramming<gm_type> dp(gm);
+    opengm::Icm<gm_type> icm(gm);
+    dp.minimize();
+    icm.minimize();
+
+    std::vector<value_type> row(num_labels);
+    for(std::size_t frame=0; frame<3; ++frame){
+        const auto version = gm.version();
+        const std::vector<std::size_t> changed{frame, 7, num_variables - 1};
+        for(auto vi : changed){
+            for(auto & v : row){
+                v = dis(gen);
+            }
+            gm.update_dense_unaries(vi, row.begin());
+        }
+        gm.update_tensor<opengm::UnaryTensor<value_type>>(bias, [&](auto & tensor){
+            tensor[frame] += 0.5;
+        });
+        CHECK_EQ(gm.version(), version + changed.size() + 1);
+
+        dp.model_changed();
+        dp.minimize();
+        opengm::DynamicProgramming<gm_type> fresh_dp(gm);
+        fresh_dp.minimize();
+        CHECK_EQ(dp.best_energy(), doctest::Approx(fresh_dp.best_energy()));
+
+        // only the changed variables and variable 0 are revisited
+        auto icm_changed = changed;
+        icm_changed.push_back(0);
+        icm.model_changed(icm_changed);
+        icm.minimize();
+        CHECK_EQ(icm.best_energy(), doctest::Approx(gm.evaluate(icm.best_labels())));
+        // the result is a local optimum of the new model
+        opengm::Icm<gm_type> fresh_icm(gm);
+        fresh_icm.set_starting_point(icm.best_labels().data());
+        fresh_icm.minimize();
+        CHECK_EQ(fresh_icm.best_labels(), icm.best_labels());
+    }
+    CHECK_THROWS(gm.update_tensor<opengm::Potts2Tensor<value_type>>(bias, [](auto &){}));
+}
+
+TEST_CASE("icm_model_changed_neighbours"){
+    using value_type = double;
+    using space_type = opengm::UniformSpace<std::size_t>;
+    using gm_type = opengm::GraphicalModel<space_type, value_type>;
+    using xshape_type = typename opengm::XArrayTensor<value_type>::xshape_type;
+
+    // variable 0 is fixed by its unary, the pairwise factor
+    // decides the label of variable 1
+    gm_type gm(2, 2);
+    gm.add_unary_factor(std::make_unique<opengm::UnaryTensor<value_type>>(std::initializer_list<value_type>{0.0, 10.0}), 0);
+    gm.add_unary_factor(std::make_unique<opengm::UnaryTensor<value_type>>(std::initializer_list<value_type>{0.0, 0.5}), 1);
+    const auto pairwise = gm.add_tensor(std::make_unique<opengm::XArrayTensor<value_type>>(xshape_type{2, 2}));
+    gm.add_factor(pairwise, {0, 1});
+
+    opengm::Icm<gm_type> icm(gm);
+    icm.minimize();
+    CHECK_EQ(icm.best_labels(), std::vector<std::size_t>{0, 0});
+
+    // the change is reported for variable 0 only, but variable 1 flips
+    gm.update_tensor<opengm::XArrayTensor<value_type>>(pairwise, [](auto & tensor){
+        tensor.xexpression()(0, 0) = 2.0;
+    });
+    const std::vector<std::size_t> changed{0};
+    icm.model_changed(changed);
+    icm.minimize();
+    CHECK_EQ(icm.best_labels(), std::vector<std::size_t>{0, 1});
+    CHECK_EQ(icm.best_energy(), doctest::Approx(0.5));
+}
+
+TEST_CASE("memory_stats"){
+    using value_type = float;
+    using space_type = opengm::UniformSpace<std::size_t>;
+    using gm_type = opengm::GraphicalModel<space_type, value_type>;
+
+    const std::size_t n_labels = 3;
+    gm_type gm(space_type(4, n_labels));
+    gm.add_unary_factor(std::make_unique<opengm::UnaryTensor<value_type>>(n_labels), 0);
+    gm.add_unary_factor(std::make_unique<opengm::UnaryTensor<value_type>>(n_labels), 1);
+    const auto potts = gm.add_tensor(std::make_unique<opengm::Potts2Tensor<value_type>>(n_labels, 1.0f));
+    gm.add_factor(potts, {0, 1});
+    gm.add_factor(potts, {1, 2});
+    gm.add_factor(potts, {2, 3});
+
+    const auto stats = gm.memory_stats();
+    REQUIRE_EQ(stats.tensors.size(), 2);
+    CHECK_GE(stats.tensors.at("UnaryTensor"), 2 * n_labels * sizeof(value_type));
+    CHECK_EQ(stats.tensors.at("Potts2Tensor"), sizeof(opengm::Potts2Tensor<value_type>));
+    CHECK_GE(stats.variable_indices, 8 * sizeof(std::size_t));
+    CHECK_EQ(stats.space, sizeof(space_type));
+    CHECK(stats.buffers.empty());
+
+    // the prediction of the message storage is exact
+    using bp_type = opengm::BeliefPropergation<gm_type>;
+    bp_type bp(gm);
+    const auto bp_stats = bp.memory_stats();
+    const auto estimated = bp_type::estimate_memory(opengm::model_statistics(gm));
+    CHECK_EQ(bp_stats.model_bytes(), stats.model_bytes());
+    CHECK_EQ(bp_stats.buffers.at("messages"), 2 * 3 * 2 * opengm::packed_row_size<value_type>(n_labels) * sizeof(value_type));
+    for(auto name : {"messages", "message_indices", "message_offsets", "labels", "belief_buffer"}){
+        CHECK_EQ(estimated.buffers.at(name), bp_stats.buffers.at(name));
+    }
+    CHECK_LE(estimated.buffers.at("factors_of_variables"), bp_stats.buffers.at("factors_of_variables"));
+}
+
+TEST_CASE("toy_models_deterministic"){
+
+    // bit identical for any number of threads
+    auto check_same = [](auto && gm_a, auto && gm_b){
+        REQUIRE_EQ(gm_a.num_variables(), gm_b.num_variables());
+        REQUIRE_EQ(gm_a.num_factors(), gm_b.num_factors());
+        std::vector<float> values_a, values_b;
+        for(std::size_t fi=0; fi<gm_a.num_factors(); ++fi){
+            auto && fa = gm_a[fi];
+            auto && fb = gm_b[fi];
+            REQUIRE(std::equal(fa.variables().begin(), fa.variables().end(), fb.variables().begin(), fb.variables().end()));
+            auto shape = fa.tensor()->shape();
+            const auto size = std::accumulate(shape.begin(), shape.end(), std::size_t(1), std::multiplies<std::size_t>());
+            values_a.resize(size);
+            values_b.resize(size);
+            fa.copy_corder(values_a.data());
+            fb.copy_corder(values_b.data());
+            REQUIRE(values_a == values_b);
+        }
+    };
+
+    SUBCASE("RandomPottsGrid"){
+        check_same(opengm::RandomPottsGrid(400, 100, 3, 7, 1)(), opengm::RandomPottsGrid(400, 100, 3, 7, 4)());
+    }
+    SUBCASE("RandomPottsGridFan"){
+        check_same(opengm::RandomPottsGridFan(400, 100, 3, 7, 1)(), opengm::RandomPottsGridFan(400, 100, 3, 7, 3)());
+    }
+    SUBCASE("RandomModel"){
+        check_same(opengm::RandomModel<>(1000, 40000, 2, 3, 1, 3, 7, 1)(), opengm::RandomModel<>(1000, 40000, 2, 3, 1, 3, 7, 4)());
+    }
+    SUBCASE("StereoGrid"){
+        check_same(opengm::StereoGrid(400, 100, 16, 4, 7, 1)(), opengm::StereoGrid(400, 100, 16, 4, 7, 4)());
+    }
+    SUBCASE("PottsVolume"){
+        auto gm = opengm::PottsVolume(40, 40, 25, 4, 0.5, 7, 4)();
+        CHECK_EQ(gm.num_factors(), 40*40*25 + 39*40*25 + 40*39*25 + 40*40*24);
+        check_same(gm, opengm::PottsVolume(40, 40, 25, 4, 0.5, 7, 1)());
+    }
+    SUBCASE("PatternGrid"){
+        auto gm = opengm::PatternGrid(400, 100, 2, 3, 1.0, 7, 4)();
+        CHECK_EQ(gm.num_factors(), 400*100 + 399*99);
+        CHECK_EQ(gm.max_arity(), 4);
+        check_same(gm, opengm::PatternGrid(400, 100, 2, 3, 1.0, 7, 1)());
+    }
+    SUBCASE("DenoisingChain"){
+        check_same(opengm::DenoisingChain(40000, 8, 2, 7, 1)(), opengm::DenoisingChain(40000, 8, 2, 7, 4)());
+    }
+    SUBCASE("DenseRandomModel"){
+        auto gm = opengm::DenseRandomModel(10, 3)();
+        CHECK_EQ(gm.num_factors(), 10 + 45);
+        check_same(gm, opengm::DenseRandomModel(10, 3)());
+    }
+}
+
 TEST_SUITE_END(); // end of testsuite gm
@@ -0,0 +1,193 @@
+#include <doctest.h>
+
+#include <random>
+
+#include "utils.hpp"
+
+#include "opengm/grid_gm.hpp"
+#include "opengm/graphical_model.hpp"
+#include "opengm/minimizer/icm.hpp"
+#include "opengm/minimizer/bp.hpp"
+#include "opengm/minimizer/trws.hpp"
+
+TEST_SUITE_BEGIN("gm");
+
+namespace cond = opengm::condition;
+
+namespace{
+
+    template<class GM>
+    void fill_random(GM & gm, std::size_t seed){
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<> dis(0.0, 1.0);
+        for(auto & v : gm.unaries()){
+            v = dis(gen);
+        }
+        for(auto & w : gm.weights()){
+            w = dis(gen) - 0.2;
+        }
+    }
+
+    template<class GM>
+    auto random_labels(const GM & gm, std::size_t seed){
+        std::mt19937 gen(seed);
+        std::uniform_int_distribution<std::size_t> dis(0, gm.space().max_num_labels() - 1);
+        std::vector<std::size_t> labels(gm.num_variables());
+        for(auto & l : labels){
+            l = dis(gen);
+        }
+        return labels;
+    }
+
+    // explicit copy with the same factor order, BP on it
+    // takes the generic path through the factors of variables
+    template<class GM>
+    auto explicit_copy(const GM & gm){
+        using value_type = typename GM::value_type;
+        opengm::GraphicalModel<opengm::UniformSpace<std::size_t>, value_type> copy(gm.num_variables(), gm.space().max_num_labels());
+        for(auto && factor : gm){
+            auto && variables = factor.variables();
+            copy.add_factor(factor.tensor()->clone(), variables.begin(), variables.end());
+        }
+        return copy;
+    }
+
+    // reference energy via the factor proxies
+    template<class GM, class LABELS>
+    auto evaluate_factorwise(const GM & gm, const LABELS & labels){
+        double energy = 0;
+        std::vector<std::size_t> factor_labels(2);
+        for(auto && factor : gm){
+            factor.from_gm(labels, factor_labels);
+            energy += factor[factor_labels.data()];
+        }
+        return energy;
+    }
+}
+
+TEST_CASE("GridGm"){
+
+    SUBCASE("num_factors"){
+        using gm_type = opengm::GridGm<double, 2>;
+        CHECK_EQ(gm_type({3,4}, 2, 4).num_edges(), 17);
+        CHECK_EQ(gm_type({3,4}, 2, 8).num_edges(), 29);
+        CHECK_EQ(gm_type({3,4}, 2, 8).num_factors(), 12 + 29);
+        CHECK_EQ(opengm::GridGm<double, 3>({2,3,4}, 2, 6).num_edges(), 46);
+        CHECK_THROWS(gm_type({3,4}, 2, 6));
+    }
+
+    SUBCASE("factors"){
+        opengm::GridGm<double, 2> gm({3,4}, 3, 8, opengm::GridPairwiseKind::truncated_l1, 1.5);
+        fill_random(gm, 0);
+        opengm::FactorsOfVariables<opengm::GridGm<double, 2>> factors_of_variables(gm);
+        for(std::size_t fi=0; fi<gm.num_factors(); ++fi){
+            auto && factor = gm[fi];
+            for(auto vi : factor.variables()){
+                auto && factors = factors_of_variables[vi];
+                CHECK(std::find(factors.begin(), factors.end(), fi) != factors.end());
+            }
+        }
+    }
+
+    SUBCASE("evaluate"){
+        const auto kinds = {
+            opengm::GridPairwiseKind::potts,
+            opengm::GridPairwiseKind::l1,
+            opengm::GridPairwiseKind::truncated_l1
+        };
+        for(auto kind : kinds){
+            opengm::GridGm<double, 2> gm2({5,7}, 4, 8, kind, 2.0);
+            fill_random(gm2, 1);
+            opengm::GridGm<double, 3> gm3({3,4,5}, 4, 26, kind, 2.0);
+            fill_random(gm3, 2);
+            for(std::size_t i=0; i<5; ++i){
+                const auto labels2 = random_labels(gm2, i);
+                CHECK(gm2.evaluate(labels2) == doctest::Approx(evaluate_factorwise(gm2, labels2)));
+                const auto labels3 = random_labels(gm3, i);
+                CHECK(gm3.evaluate(labels3) == doctest::Approx(evaluate_factorwise(gm3, labels3)));
+            }
+        }
+    }
+
+    SUBCASE("Icm"){
+        opengm::GridGm<double, 2> gm({10,10}, 4, 8, opengm::GridPairwiseKind::potts);
+        fill_random(gm, 3);
+        opengm::Icm<opengm::GridGm<double, 2>> minimizer(gm);
+        minimizer.minimize();
+        CHECK(minimizer.best_energy() == doctest::Approx(gm.evaluate(minimizer.best_labels())));
+        cond::KOptimal<1>()(minimizer);
+    }
+
+    SUBCASE("BeliefPropergation"){
+        opengm::GridGm<double, 3> gm({4,4,4}, 5, 6, opengm::GridPairwiseKind::truncated_l1, 2.0);
+        fill_random(gm, 4);
+        using minimizer_type = opengm::BeliefPropergation<opengm::GridGm<double, 3>>;
+        // the factors of variables of a grid are computed on the fly,
+        // every schedule walks them
+        const auto schedules = {
+            minimizer_type::Schedule::synchronous,
+            minimizer_type::Schedule::residual,
+            minimizer_type::Schedule::active_set
+        };
+        for(auto schedule : schedules){
+            typename minimizer_type::settings_type settings;
+            settings.num_iterations = 10;
+            settings.schedule = schedule;
+            minimizer_type minimizer(gm, settings);
+            minimizer.minimize();
+            CHECK(minimizer.best_energy() == doctest::Approx(gm.evaluate(minimizer.best_labels())));
+        }
+    }
+
+    SUBCASE("BeliefPropergation fast path"){
+        // the pairwise messages are computed from the weights
+        // directly and match the generic message path
+        const auto kinds = {
+            opengm::GridPairwiseKind::potts,
+            opengm::GridPairwiseKind::l1,
+            opengm::GridPairwiseKind::truncated_l1
+        };
+        for(auto kind : kinds){
+            using grid_type = opengm::GridGm<double, 2>;
+            grid_type gm({9,7}, 4, 8, kind, 2.0);
+            fill_random(gm, 6);
+            const auto copy = explicit_copy(gm);
+            static_assert(opengm::has_pairwise_tensors<grid_type>::value, "GridGm has pairwise tensors");
+            static_assert(!opengm::has_pairwise_tensors<std::decay_t<decltype(copy)>>::value, "GraphicalModel has no pairwise tensors");
+
+            auto run = [&](auto && model, const std::size_t num_threads, auto message_type){
+                using minimizer_type = opengm::BeliefPropergation<std::decay_t<decltype(model)>, decltype(message_type)>;
+                typename minimizer_type::settings_type settings;
+                settings.num_iterations = 20;
+                settings.num_threads = num_threads;
+                minimizer_type minimizer(model, settings);
+                minimizer.minimize();
+                return std::make_pair(minimizer.best_labels(), minimizer.best_energy());
+            };
+            const auto generic = run(copy, 1, double());
+            for(std::size_t num_threads : {1, 3}){
+                const auto grid = run(gm, num_threads, double());
+                CHECK_EQ(grid.first, generic.first);
+                CHECK(grid.second == doctest::Approx(generic.second));
+            }
+            const auto narrow_generic = run(copy, 1, float());
+            const auto narrow_grid = run(gm, 1, float());
+            CHECK_EQ(narrow_grid.first, narrow_generic.first);
+            CHECK(narrow_grid.second == doctest::Approx(narrow_generic.second));
+        }
+    }
+
+    SUBCASE("TrwS"){
+        opengm::GridGm<double, 2> gm({6,5}, 4, 8, opengm::GridPairwiseKind::potts);
+        fill_random(gm, 5);
+        using minimizer_type = opengm::TrwS<opengm::GridGm<double, 2>>;
+        typename minimizer_type::settings_type settings;
+        settings.num_iterations = 10;
+        minimizer_type minimizer(gm, settings);
+        minimizer.minimize();
+        CHECK(minimizer.best_energy() == doctest::Approx(gm.evaluate(minimizer.best_labels())));
+        CHECK_LE(minimizer.lower_bound(), minimizer.best_energy() + 1e-9);
+    }
+}
+
+TEST_SUITE_END(); // end of testsuite gm
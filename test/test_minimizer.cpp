@@ -1,5 +1,8 @@
 #include <doctest.h>
 
+#include <cstdio>
+#include <filesystem>
+
 #include "utils.hpp"
 
 #include "opengm/toy_models.hpp"
@@ -11,6 +14,7 @@
 #include "opengm/minimizer/bp.hpp"
 #include "opengm/minimizer/dynamic_programming.hpp"
 #include "opengm/minimizer/self_fusion.hpp"
+#include "opengm/minimizer/trws.hpp"
 #include "opengm/minimizer/block_icm.hpp"
 
 TEST_SUITE_BEGIN("gm");
@@ -144,6 +148,205 @@ TEST_CASE("BeliefPropergation"){
     }
 }
 
+TEST_CASE("BeliefPropergationParallel"){
+    auto check = [](auto && gm){
+        using gm_type = std::decay_t<decltype(gm)>;
+        using minimizer_type = opengm::BeliefPropergation<gm_type>;
+        typename minimizer_type::settings_type settings;
+        settings.damping = 0.5;
+        settings.num_iterations = 15;
+        minimizer_type sequential(gm, settings);
+        sequential.minimize();
+
+        settings.num_threads = 4;
+        minimizer_type parallel(gm, settings);
+        parallel.minimize();
+        CHECK_EQ(parallel.iteration(), sequential.iteration());
+        CHECK_EQ(parallel.best_labels(), sequential.best_labels());
+        CHECK_EQ(parallel.best_energy(), sequential.best_energy());
+        std::vector<typename gm_type::value_type> belief(gm.space().max_num_labels()), parallel_belief(belief.size());
+        for(std::size_t vi=0; vi<gm.num_variables(); ++vi){
+            sequential.belief(vi, belief.data());
+            parallel.belief(vi, parallel_belief.data());
+            REQUIRE(std::equal(belief.begin(), belief.begin() + gm.num_labels(vi), parallel_belief.begin()));
+        }
+
+        settings.deterministic = false;
+        minimizer_type unordered(gm, settings);
+        unordered.minimize();
+        CHECK_LE(unordered.best_energy(), gm.evaluate(std::vector<std::size_t>(gm.num_variables(), 0)));
+    };
+    check(opengm::RandomPottsGrid(40, 30, 4)());
+    check(opengm::RandomModel<float>(2000, 3000, 2, 4, 1, 3)());
+}
+
+TEST_CASE("ResidualBeliefPropergation"){
+    SUBCASE("chain"){
+        // exact on trees
+        auto gm = opengm::RandomPottsChain(30, 4)();
+        using gm_type = decltype(gm);
+        using minimizer_type = opengm::BeliefPropergation<gm_type>;
+        typename minimizer_type::settings_type settings;
+        settings.damping = 0;
+        settings.num_iterations = 1000;
+        settings.schedule = minimizer_type::Schedule::residual;
+        minimizer_type bp(gm, settings);
+        bp.minimize();
+        CHECK_LT(bp.iteration(), settings.num_iterations);
+
+        opengm::DynamicProgramming<gm_type> dp(gm);
+        dp.minimize();
+        CHECK_EQ(bp.best_energy(), doctest::Approx(dp.best_energy()));
+    }
+    SUBCASE("grid"){
+        auto gm = opengm::RandomPottsGrid(20, 20, 4)();
+        using gm_type = decltype(gm);
+        using minimizer_type = opengm::BeliefPropergation<gm_type>;
+        typename minimizer_type::settings_type settings;
+        settings.damping = 0.5;
+        settings.num_iterations = 50;
+        settings.schedule = minimizer_type::Schedule::residual;
+        minimizer_type bp(gm, settings);
+        bp.minimize();
+        CHECK_LE(bp.iteration(), settings.num_iterations);
+        CHECK_LE(bp.best_energy(), gm.evaluate(std::vector<std::size_t>(gm.num_variables(), 0)));
+        CHECK_EQ(bp.best_energy(), doctest::Approx(gm.evaluate(bp.best_labels())));
+    }
+}
+
+TEST_CASE("ActiveSetBeliefPropergation"){
+    auto gm = opengm::RandomPottsGrid(30, 30, 4)();
+    using gm_type = decltype(gm);
+    using minimizer_type = opengm::BeliefPropergation<gm_type>;
+    typename minimizer_type::settings_type settings;
+    settings.damping = 0.5;
+    settings.num_iterations = 200;
+    minimizer_type synchronous(gm, settings);
+    synchronous.minimize();
+
+    SUBCASE("exact"){
+        // without threshold only unchanged messages are skipped
+        settings.schedule = minimizer_type::Schedule::active_set;
+        settings.active_threshold = 0;
+        minimizer_type bp(gm, settings);
+        bp.minimize();
+        CHECK_EQ(bp.iteration(), synchronous.iteration());
+        CHECK_EQ(bp.best_labels(), synchronous.best_labels());
+        CHECK_EQ(bp.best_energy(), synchronous.best_energy());
+    }
+    SUBCASE("threshold"){
+        settings.schedule = minimizer_type::Schedule::active_set;
+        settings.active_threshold = 1e-3;
+        settings.convergence = 0;
+        std::size_t updates = 0;
+        struct Callback : public opengm::MinimizerCallbackBase<gm_type>{
+            std::size_t & updates;
+            Callback(std::size_t & u) : updates(u){}
+            void begin(opengm::MinimizerBase<gm_type> *) override{}
+            void end(opengm::MinimizerBase<gm_type> *) override{}
+            bool operator()(opengm::MinimizerBase<gm_type> * minimizer) override{
+                updates += static_cast<minimizer_type *>(minimizer)->num_active_factors();
+                return true;
+            }
+        } callback(updates);
+        minimizer_type bp(gm, settings);
+        bp.minimize(&callback);
+        CHECK_LT(bp.iteration(), settings.num_iterations);
+        CHECK_LT(updates, bp.iteration() * (gm.num_factors() - gm.num_variables()));
+        CHECK_LT(bp.num_active_factors(), gm.num_factors() - gm.num_variables());
+        CHECK_EQ(bp.best_energy(), doctest::Approx(synchronous.best_energy()).epsilon(0.01));
+        CHECK_EQ(bp.best_energy(), doctest::Approx(gm.evaluate(bp.best_labels())));
+    }
+}
+
+TEST_CASE("BeliefPropergationNarrowMessages"){
+    auto gm = opengm::RandomPottsGrid(20, 20, 4)();
+    using gm_type = decltype(gm);
+    auto run = [&](auto message_type, const bool residual){
+        using minimizer_type = opengm::BeliefPropergation<gm_type, decltype(message_type)>;
+        typename minimizer_type::settings_type settings;
+        settings.damping = 0.5;
+        settings.num_iterations = 50;
+        if(residual){
+            settings.schedule = minimizer_type::Schedule::residual;
+        }
+        minimizer_type bp(gm, settings);
+        bp.minimize();
+        CHECK_EQ(bp.best_energy(), doctest::Approx(gm.evaluate(bp.best_labels())));
+        return std::make_pair(bp.best_energy(), bp.memory_stats().buffers.at("messages"));
+    };
+    const auto full = run(float(), false);
+    const auto half = run(opengm::float16(), false);
+    const auto brain = run(opengm::bfloat16(), false);
+    CHECK_EQ(half.second * 2, full.second);
+    CHECK_EQ(brain.second * 2, full.second);
+    CHECK_EQ(half.first, doctest::Approx(full.first).epsilon(0.02));
+    CHECK_EQ(brain.first, doctest::Approx(full.first).epsilon(0.05));
+
+    const auto residual = run(opengm::float16(), true);
+    CHECK_LE(residual.first, gm.evaluate(std::vector<std::size_t>(gm.num_variables(), 0)));
+}
+
+TEST_CASE("TrwS"){
+    SUBCASE("chain"){
+        // the bound is tight on trees
+        auto gm = opengm::RandomPottsChain(30, 4)();
+        using gm_type = decltype(gm);
+        opengm::TrwS<gm_type> trws(gm);
+        trws.minimize();
+
+        opengm::DynamicProgramming<gm_type> dp(gm);
+        dp.minimize();
+        CHECK_EQ(trws.best_energy(), doctest::Approx(dp.best_energy()));
+        CHECK_EQ(trws.lower_bound(), doctest::Approx(dp.best_energy()));
+        CHECK_LT(trws.iteration(), 1000);
+    }
+    SUBCASE("grid"){
+        auto gm = opengm::RandomPottsGrid(20, 20, 4)();
+        using gm_type = decltype(gm);
+        using minimizer_type = opengm::TrwS<gm_type>;
+        typename minimizer_type::settings_type settings;
+        settings.num_iterations = 50;
+        minimizer_type trws(gm, settings);
+
+        // the bound never decreases
+        struct Callback : opengm::MinimizerCallbackBase<gm_type>{
+            void begin(opengm::MinimizerBase<gm_type> *) override{}
+            void end(opengm::MinimizerBase<gm_type> *) override{}
+            bool operator()(opengm::MinimizerBase<gm_type> * minimizer) override{
+                const auto bound = static_cast<minimizer_type *>(minimizer)->compute_lower_bound();
+                CHECK_GE(bound, doctest::Approx(previous_bound));
+                previous_bound = bound;
+                return true;
+            }
+            double previous_bound{-std::numeric_limits<double>::infinity()};
+        } callback;
+        trws.minimize(&callback);
+        CHECK_LE(trws.lower_bound(), trws.best_energy() + 1e-4);
+        CHECK_EQ(trws.best_energy(), doctest::Approx(gm.evaluate(trws.best_labels())));
+
+        // loose duality gap based termination
+        settings.num_iterations = 1000;
+        settings.relative_gap = 0.5;
+        minimizer_type early(gm, settings);
+        early.minimize();
+        CHECK_LE(early.duality_gap(), 0.5 * std::abs(early.best_energy()));
+        CHECK_LE(early.iteration(), trws.iteration());
+    }
+    SUBCASE("higher order"){
+        auto gm = opengm::RandomModel<float>(8, 12, 2, 3, 1, 3)();
+        using gm_type = decltype(gm);
+        opengm::TrwS<gm_type> trws(gm);
+        trws.minimize();
+        opengm::BruteForceNaive<gm_type> brute_force(gm);
+        brute_force.minimize();
+        CHECK_LE(trws.lower_bound(), brute_force.best_energy() + 1e-4);
+        CHECK_GE(trws.best_energy(), doctest::Approx(brute_force.best_energy()));
+        CHECK_GT(trws.lower_bound(), -std::numeric_limits<float>::infinity());
+    }
+}
+
+
 TEST_CASE("Icm"){
 
     // lambda as generic factory
@@ -220,4 +423,117 @@ TEST_CASE("FactorIcm"){
 }
 
 
+TEST_CASE("Checkpoint"){
+    auto gm = opengm::RandomPottsGrid(8, 8, 4)();
+    using gm_type = decltype(gm);
+    using bp_type = opengm::BeliefPropergation<gm_type>;
+    const auto path = (std::filesystem::temp_directory_path() / "opengm_test_checkpoint.snap").string();
+
+    typename bp_type::settings_type settings;
+    settings.damping = 0.5;
+    settings.convergence = 0;
+    settings.num_iterations = 30;
+    bp_type reference(gm, settings);
+    reference.minimize();
+
+    SUBCASE("BeliefPropergation"){
+        auto interrupted_settings = settings;
+        interrupted_settings.num_iterations = 12;
+        bp_type interrupted(gm, interrupted_settings);
+        interrupted.minimize();
+        interrupted.save_checkpoint(path);
+
+        bp_type resumed(gm, settings, opengm::ResumeFrom{path});
+        CHECK_EQ(resumed.iteration(), 12);
+        resumed.minimize();
+        CHECK_EQ(resumed.iteration(), 30);
+        CHECK_EQ(resumed.best_labels(), reference.best_labels());
+        CHECK_EQ(resumed.best_energy(), reference.best_energy());
+    }
+    SUBCASE("async"){
+        auto interrupted_settings = settings;
+        interrupted_settings.num_iterations = 20;
+        bp_type interrupted(gm, interrupted_settings);
+        interrupted.enable_checkpoints(opengm::CheckpointSettings{path, 1});
+        interrupted.minimize();
+        interrupted.disable_checkpoints();
+        const auto stats = interrupted.checkpoint_stats();
+        CHECK_GE(stats.written, 1);
+        CHECK_EQ(stats.written + stats.skipped, 20);
+
+        // any of the written snapshots continues the reference run
+        bp_type resumed(gm, settings, opengm::ResumeFrom{path});
+        CHECK_GE(resumed.iteration(), 1);
+        CHECK_LE(resumed.iteration(), 20);
+        resumed.minimize();
+        CHECK_EQ(resumed.best_labels(), reference.best_labels());
+    }
+    SUBCASE("SelfFusion"){
+        using self_fusion_type = opengm::SelfFusion<gm_type>;
+        using sub_gm_type = typename self_fusion_type::sub_gm_type;
+        typename self_fusion_type::settings_type sf_settings;
+        sf_settings.minimizer_factory = std::make_shared<opengm::MinimizerFactory<bp_type>>(settings);
+        sf_settings.fuse_minimizer_factory = opengm::make_shared_factory<opengm::FactorIcm<sub_gm_type>>();
+
+        self_fusion_type sf_reference(gm, sf_settings);
+        sf_reference.minimize();
+
+        self_fusion_type interrupted(gm, sf_settings);
+        interrupted.enable_checkpoints(opengm::CheckpointSettings{path, 7});
+        interrupted.minimize();
+        interrupted.disable_checkpoints();
+        CHECK_GE(interrupted.checkpoint_stats().written, 1);
+
+        self_fusion_type resumed(gm, sf_settings, opengm::ResumeFrom{path});
+        resumed.minimize();
+        CHECK_EQ(resumed.best_labels(), sf_reference.best_labels());
+        CHECK_EQ(resumed.best_energy(), doctest::Approx(sf_reference.best_energy()));
+    }
+    SUBCASE("SelfFusion without nested snapshot"){
+        // Icm cannot checkpoint, after a resume it starts from the fused labels
+        using self_fusion_type = opengm::SelfFusion<gm_type>;
+        using sub_gm_type = typename self_fusion_type::sub_gm_type;
+        typename self_fusion_type::settings_type sf_settings;
+        sf_settings.minimizer_factory = opengm::make_shared_factory<opengm::Icm<gm_type>>();
+        sf_settings.fuse_minimizer_factory = opengm::make_shared_factory<opengm::FactorIcm<sub_gm_type>>();
+
+        std::vector<std::size_t> starting_point(gm.num_variables());
+        for(std::size_t vi=0; vi<gm.num_variables(); ++vi){
+            starting_point[vi] = (vi * 5 + 3) % 4;
+        }
+        self_fusion_type interrupted(gm, sf_settings);
+        interrupted.set_starting_point(starting_point.data());
+        interrupted.minimize();
+        const auto num_fusions = interrupted.num_fusions();
+        CHECK_GE(num_fusions, 1);
+        interrupted.save_checkpoint(path);
+
+        // the resumed run continues like a run started from the fused labels
+        self_fusion_type from_fused(gm, sf_settings);
+        from_fused.set_starting_point(interrupted.best_labels().data());
+        from_fused.minimize();
+        self_fusion_type resumed(gm, sf_settings, opengm::ResumeFrom{path});
+        resumed.minimize();
+        CHECK_EQ(resumed.best_labels(), from_fused.best_labels());
+        CHECK_EQ(resumed.num_fusions(), num_fusions + from_fused.num_fusions());
+
+        // a fresh run counts its fusions from zero
+        self_fusion_type fresh(gm, sf_settings);
+        fresh.minimize();
+        const auto num_fresh_fusions = fresh.num_fusions();
+        fresh.minimize();
+        CHECK_EQ(fresh.num_fusions(), num_fresh_fusions);
+    }
+    SUBCASE("mismatch"){
+        reference.save_checkpoint(path);
+        auto other = opengm::RandomPottsGrid(8, 9, 4)();
+        CHECK_THROWS(opengm::BeliefPropergation<gm_type>(other, settings, opengm::ResumeFrom{path}));
+        opengm::Icm<gm_type> icm(gm);
+        CHECK_FALSE(icm.can_checkpoint());
+        CHECK_THROWS(icm.resume(path));
+    }
+    std::remove(path.c_str());
+}
+
+
 TEST_SUITE_END(); // end of testsuite gm
@@ -0,0 +1,146 @@
+#include <doctest.h>
+
+#include <random>
+#include <numeric>
+
+#include "utils.hpp"
+
+#include "opengm/reorder.hpp"
+#include "opengm/grid_gm.hpp"
+#include "opengm/toy_models.hpp"
+
+TEST_SUITE_BEGIN("gm");
+
+namespace{
+
+    template<class GM>
+    std::size_t bandwidth(const GM & gm){
+        std::size_t bw = 0;
+        for(auto && factor : gm){
+            auto && variables = factor.variables();
+            const auto [mn, mx] = std::minmax_element(variables.begin(), variables.end());
+            bw = std::max(bw, std::size_t(*mx - *mn));
+        }
+        return bw;
+    }
+
+    template<class GM>
+    void check_reordered(const GM & gm, const opengm::ReorderedGm<GM> & reordered){
+        const auto & rgm = reordered.gm();
+        CHECK_EQ(rgm.num_variables(), gm.num_variables());
+        CHECK_EQ(rgm.num_factors(), gm.num_factors());
+
+        std::mt19937 gen(0);
+        std::vector<std::size_t> labels(gm.num_variables());
+        std::vector<std::size_t> reordered_labels(gm.num_variables());
+        std::vector<std::size_t> back(gm.num_variables());
+        for(std::size_t i=0; i<5; ++i){
+            for(std::size_t vi=0; vi<gm.num_variables(); ++vi){
+                labels[vi] = std::uniform_int_distribution<std::size_t>(0, gm.num_labels(vi)-1)(gen);
+            }
+            reordered.to_reordered_labels(labels, reordered_labels);
+            reordered.to_original_labels(reordered_labels, back);
+            CHECK_EQ(back, labels);
+            CHECK(rgm.evaluate(reordered_labels) == doctest::Approx(gm.evaluate(labels)));
+        }
+    }
+}
+
+TEST_CASE("reorder"){
+
+    const std::size_t nx = 12;
+    const std::size_t ny = 9;
+    const auto gm = opengm::RandomPottsGrid(nx, ny, 3)();
+    using gm_type = std::decay_t<decltype(gm)>;
+
+    // shuffled model as input
+    std::vector<std::size_t> permutation(gm.num_variables());
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::shuffle(permutation.begin(), permutation.end(), std::mt19937(42));
+    const opengm::ReorderedGm<gm_type> shuffled(gm, permutation);
+    check_reordered(gm, shuffled);
+    const auto & sgm = shuffled.gm();
+    using sgm_type = std::decay_t<decltype(sgm)>;
+
+    SUBCASE("reverse_cuthill_mckee"){
+        const opengm::ReorderedGm<sgm_type> reordered(sgm, opengm::ReorderMethod::reverse_cuthill_mckee);
+        check_reordered(sgm, reordered);
+        CHECK_LE(bandwidth(reordered.gm()), 2 * ny);
+        CHECK_LT(bandwidth(reordered.gm()), bandwidth(sgm));
+
+        // factors are sorted by their first variable
+        std::size_t last = 0;
+        for(auto && factor : reordered.gm()){
+            auto && variables = factor.variables();
+            const auto first = *std::min_element(variables.begin(), variables.end());
+            CHECK_GE(first, last);
+            last = first;
+        }
+    }
+    SUBCASE("bfs"){
+        const opengm::ReorderedGm<sgm_type> reordered(sgm, opengm::ReorderMethod::bfs);
+        check_reordered(sgm, reordered);
+        CHECK_LT(bandwidth(reordered.gm()), bandwidth(sgm));
+    }
+    SUBCASE("invalid"){
+        // checked before the space of the copy is built
+        auto short_permutation = permutation;
+        short_permutation.pop_back();
+        CHECK_THROWS(opengm::ReorderedGm<gm_type>(gm, short_permutation));
+        auto out_of_range = permutation;
+        out_of_range[0] = gm.num_variables() + 1000;
+        CHECK_THROWS(opengm::ReorderedGm<gm_type>(gm, out_of_range));
+        auto duplicate = permutation;
+        duplicate[0] = duplicate[1];
+        CHECK_THROWS(opengm::ReorderedGm<gm_type>(gm, duplicate));
+    }
+    SUBCASE("hilbert"){
+        // 8x8 grid: consecutive points on the curve are grid neighbours
+        std::vector<std::array<double, 2>> coordinates;
+        for(std::size_t x=0; x<8; ++x){
+            for(std::size_t y=0; y<8; ++y){
+                coordinates.push_back({double(x), double(y)});
+            }
+        }
+        const auto order = opengm::hilbert_order(coordinates);
+        auto sorted = order;
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<std::size_t> iota(order.size());
+        std::iota(iota.begin(), iota.end(), 0);
+        CHECK_EQ(sorted, iota);
+        for(std::size_t i=1; i<order.size(); ++i){
+            const auto & a = coordinates[order[i-1]];
+            const auto & b = coordinates[order[i]];
+            CHECK_EQ(std::abs(a[0] - b[0]) + std::abs(a[1] - b[1]), 1.0);
+        }
+    }
+}
+
+TEST_CASE("reorder GridGm"){
+    // factor proxies: each factor has its own tensor
+    using grid_type = opengm::GridGm<float, 2>;
+    grid_type grid({4, 4}, 3, 4);
+    std::mt19937 gen(3);
+    for(auto & v : grid.unaries()){
+        v = std::uniform_real_distribution<float>(0, 1)(gen);
+    }
+    for(auto & w : grid.weights()){
+        w = std::uniform_real_distribution<float>(0, 2)(gen);
+    }
+    const opengm::ReorderedGm<grid_type> reordered(grid, opengm::ReorderMethod::bfs);
+    check_reordered(grid, reordered);
+
+    // the clones of the unary views do not point into the grid
+    std::vector<std::size_t> labels(grid.num_variables());
+    std::vector<std::size_t> reordered_labels(grid.num_variables());
+    std::uniform_int_distribution<std::size_t> label_dis(0, 2);
+    for(auto & l : labels){
+        l = label_dis(gen);
+    }
+    reordered.to_reordered_labels(labels, reordered_labels);
+    const auto energy = grid.evaluate(labels);
+    std::fill(grid.unaries().begin(), grid.unaries().end(), 0.0f);
+    CHECK(reordered.gm().evaluate(reordered_labels) == doctest::Approx(energy));
+}
+
+TEST_SUITE_END(); // end of testsuite gm
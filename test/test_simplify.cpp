@@ -0,0 +1,98 @@
+#include <doctest.h>
+
+#include <random>
+
+#include "utils.hpp"
+
+#include "opengm/simplify.hpp"
+#include "opengm/toy_models.hpp"
+#include "opengm/grid_gm.hpp"
+
+TEST_SUITE_BEGIN("gm");
+
+TEST_CASE("simplify"){
+    using value_type = double;
+    using space_type = opengm::ExplicitSpace<std::size_t>;
+    using gm_type = opengm::GraphicalModel<space_type, value_type>;
+    using xshape_type = typename opengm::XArrayTensor<value_type>::xshape_type;
+
+    gm_type gm(space_type{3, 3, 2, 3});
+
+    // 0: two unaries on variable 0
+    gm.add_unary_factor(std::make_unique<opengm::UnaryTensor<value_type>>(std::initializer_list<value_type>{1.0, 2.0, 3.0}), 0);
+    // 1, 2: two potts factors on {0,1} with different variable order
+    gm.add_factor(std::make_unique<opengm::Potts2Tensor<value_type>>(3, 1.0), {0, 1});
+    gm.add_factor(std::make_unique<opengm::Potts2Tensor<value_type>>(3, 2.0), {1, 0});
+    // 3: second unary on 0
+    gm.add_unary_factor(std::make_unique<opengm::UnaryTensor<value_type>>(std::initializer_list<value_type>{0.5, -1.0, 0.0}), 0);
+    // 4, 5: dense factors on {1, 2} with different variable order
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<value_type> dis(-1.0, 1.0);
+    auto t12 = std::make_unique<opengm::XArrayTensor<value_type>>(xshape_type{3, 2});
+    auto t21 = std::make_unique<opengm::XArrayTensor<value_type>>(xshape_type{2, 3});
+    for(auto & v : t12->xexpression()){
+        v = dis(gen);
+    }
+    for(auto & v : t21->xexpression()){
+        v = dis(gen);
+    }
+    gm.add_factor(std::move(t12), {1, 2});
+    gm.add_factor(std::move(t21), {2, 1});
+    // 6: zero potts
+    gm.add_factor(std::make_unique<opengm::Potts2Tensor<value_type>>(3, 0.0), {1, 3});
+    // 7: constant unary
+    gm.add_unary_factor(std::make_unique<opengm::UnaryTensor<value_type>>(std::initializer_list<value_type>{2.5, 2.5, 2.5}), 3);
+
+    const opengm::SimplifiedGm<gm_type> simplified(gm);
+    const auto & sgm = simplified.gm();
+
+    CHECK_EQ(sgm.num_factors(), 3);
+    CHECK_EQ(simplified.offset(), doctest::Approx(2.5));
+
+    const auto & old_to_new = simplified.old_to_new_factor();
+    const auto removed = opengm::SimplifiedGm<gm_type>::removed;
+    CHECK_EQ(old_to_new, std::vector<std::size_t>{0, 1, 1, 0, 2, 2, removed, removed});
+
+    // the sum of potts factors stays analytic
+    auto potts = dynamic_cast<const opengm::Potts2Tensor<value_type> *>(sgm[1].tensor());
+    REQUIRE(potts != nullptr);
+    CHECK_EQ(potts->beta(), doctest::Approx(3.0));
+
+    std::vector<std::size_t> labels(gm.num_variables());
+    gm.space().for_each_state(labels, [&](auto && labels){
+        CHECK(sgm.evaluate(labels) + simplified.offset() == doctest::Approx(gm.evaluate(labels)));
+    });
+}
+
+TEST_CASE("simplify GridGm"){
+    // factor proxies: each factor has its own tensor
+    using grid_type = opengm::GridGm<float, 2>;
+    grid_type grid({4, 4}, 3);
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for(auto & v : grid.unaries()){
+        v = dis(gen);
+    }
+    for(auto & w : grid.weights()){
+        w = dis(gen);
+    }
+    const opengm::SimplifiedGm<grid_type> simplified(grid);
+    const auto & sgm = simplified.gm();
+    CHECK_EQ(sgm.num_factors(), grid.num_factors());
+
+    std::vector<std::size_t> labels(grid.num_variables());
+    std::uniform_int_distribution<std::size_t> label_dis(0, 2);
+    for(std::size_t i=0; i<10; ++i){
+        for(auto & l : labels){
+            l = label_dis(gen);
+        }
+        CHECK(sgm.evaluate(labels) + simplified.offset() == doctest::Approx(grid.evaluate(labels)));
+    }
+
+    // the clones of the unary views do not point into the grid
+    const auto energy = grid.evaluate(labels);
+    std::fill(grid.unaries().begin(), grid.unaries().end(), 0.0f);
+    CHECK(sgm.evaluate(labels) + simplified.offset() == doctest::Approx(energy));
+}
+
+TEST_SUITE_END(); // end of testsuite gm
@@ -91,4 +91,14 @@ TEST_CASE("for_each_state"){
 
 
 
+TEST_CASE("explicit_subspace"){
+    opengm::ExplicitSpace<std::size_t> space{3, 4, 2, 5};
+    std::vector<std::size_t> vars({3, 0, 2});
+    auto subspace = space.subspace(vars.begin(), vars.end());
+    CHECK_EQ(subspace.size(), 3);
+    CHECK_EQ(subspace[0], 5);
+    CHECK_EQ(subspace[1], 3);
+    CHECK_EQ(subspace[2], 2);
+}
+
 TEST_SUITE_END(); // end of testsuite gm
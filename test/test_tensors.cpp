@@ -15,6 +15,28 @@ TEST_CASE("XArrayTensor"){
 }
 
 
+TEST_CASE("ViewTensorClone"){
+    // clones of view tensors own a copy of the values
+    std::vector<double> values{1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+    const std::size_t shape[2] = {2, 3};
+    const opengm::UnaryViewTensor<double> unary(values.data(), 3);
+    const opengm::ExplicitViewTensor<double> explicit_view(values.data(), shape, 2);
+    const auto unary_clone = unary.clone();
+    const auto explicit_clone = explicit_view.clone();
+    std::fill(values.begin(), values.end(), 0.0);
+
+    REQUIRE_EQ(unary_clone->arity(), 1);
+    REQUIRE_EQ(explicit_clone->arity(), 2);
+    CHECK_EQ(unary_clone->shape(0), 3);
+    CHECK_EQ(explicit_clone->shape(1), 3);
+    for(std::size_t l=0; l<3; ++l){
+        CHECK_EQ((*unary_clone)[&l], double(l + 1));
+    }
+    std::size_t labels[2] = {1, 2};
+    CHECK_EQ((*explicit_clone)[labels], 6.0);
+    labels[0] = 0;
+    CHECK_EQ((*explicit_clone)[labels], 3.0);
+}
 
 TEST_CASE("TestBind"){
 
@@ -1,8 +1,11 @@
 #include <doctest.h>
+
+#include <cmath>
 #include "utils.hpp"
 
 #include "opengm/space.hpp"
 #include "opengm/utils.hpp"
+#include "opengm/float16.hpp"
 #include "opengm/toy_models.hpp"
 
 
@@ -57,4 +60,26 @@ TEST_CASE("utils"){
 
 
 
+TEST_CASE("float16"){
+    SUBCASE("exact"){
+        for(float value : {0.0f, 1.0f, -2.5f, 0.125f, 1024.0f, 65504.0f, 5.9604645e-8f}){
+            CHECK_EQ(float(opengm::float16(value)), value);
+            CHECK_EQ(float(opengm::bfloat16(value)), doctest::Approx(value).epsilon(1e-2));
+        }
+    }
+    SUBCASE("rounding"){
+        // ties round to even
+        CHECK_EQ(float(opengm::float16(1.0f + 1.0f / 2048)), 1.0f);
+        CHECK_EQ(float(opengm::float16(1.0f + 3.0f / 2048)), 1.0f + 2.0f / 1024);
+        CHECK_EQ(float(opengm::bfloat16(1.0f + 1.0f / 256)), 1.0f);
+        CHECK_EQ(float(opengm::float16(0.1f)), doctest::Approx(0.1f).epsilon(1e-3));
+    }
+    SUBCASE("range"){
+        CHECK(std::isinf(float(opengm::float16(1e5f))));
+        CHECK(std::isnan(float(opengm::float16(std::nanf("")))));
+        CHECK(std::isnan(float(opengm::bfloat16(std::nanf("")))));
+        CHECK_EQ(float(opengm::bfloat16(1e30f)), doctest::Approx(1e30f).epsilon(1e-2));
+    }
+}
+
 TEST_SUITE_END(); // end of testsuite gm